@@ -0,0 +1,155 @@
+/**
+ * \file
+ * \author  d264
+ * \version $Rev$
+ *
+ * \section DESCRIPTION
+ *
+ * Micro-benchmark for the byte processing kernels of the GBee driver. Reports
+ * the throughput of checksum calculation, start delimiter search and escaping
+ * in GB/s. Build with DO_BENCHMARK enabled, pass the buffer size in bytes as
+ * optional argument.
+ *
+ * \section LICENSE
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <time.h>
+#include "gbee-kernel.h"
+
+/** Default size of the buffer to process (largest API frame). */
+#define BENCH_DEFAULT_LENGTH GBEE_MAX_FRAME_SIZE
+/** Total number of bytes to process per kernel. */
+#define BENCH_TOTAL_BYTES (1ULL << 30)
+
+/** Kernel under test. */
+enum benchKernel {
+	/** gbeeKernelSum(). */
+	BENCH_SUM,
+	/** gbeeKernelFindDelimiter(). */
+	BENCH_FIND_DELIMITER,
+	/** gbeeKernelEscape(). */
+	BENCH_ESCAPE
+};
+
+/** Prevents the compiler from dropping the kernel calls. */
+static volatile uint32_t benchSink;
+
+/**
+ * Returns a monotonic timestamp in seconds.
+ *
+ * \return The current time in seconds.
+ */
+static double benchNow(void)
+{
+	// Current time.
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/**
+ * Runs a kernel over the given buffer repeatedly and prints its throughput.
+ *
+ * \param[in] name is the name to print.
+ * \param[in] kernel selects the kernel to run.
+ * \param[in] data points to the data to process.
+ * \param[in] length is the number of bytes.
+ * \param[out] scratch has room for twice the given number of bytes.
+ */
+static void benchRun(const char *name, enum benchKernel kernel,
+		const uint8_t *data, uint32_t length, uint8_t *scratch)
+{
+	// Number of runs over the buffer.
+	uint64_t runs = BENCH_TOTAL_BYTES / length + 1;
+	// Index of the current run.
+	uint64_t run;
+	// Start time of the benchmark.
+	double start;
+	// Duration of the benchmark.
+	double duration;
+
+	start = benchNow();
+	for (run = 0; run < runs; run++)
+	{
+		switch (kernel)
+		{
+			case BENCH_SUM:
+				benchSink += gbeeKernelSum(data, length);
+				break;
+			case BENCH_FIND_DELIMITER:
+				benchSink += gbeeKernelFindDelimiter(data, length);
+				break;
+			case BENCH_ESCAPE:
+				benchSink += gbeeKernelEscape(data, length, scratch);
+				break;
+		}
+	}
+	duration = benchNow() - start;
+	printf("%-16s %8.3f GB/s\n", name, runs * length / duration * 1e-9);
+}
+
+/******************************************************************************/
+
+int main(int argc, char **argv)
+{
+	// Number of bytes per kernel call.
+	uint32_t length = BENCH_DEFAULT_LENGTH;
+	// Data to process.
+	uint8_t *data;
+	// Destination for escaped data.
+	uint8_t *scratch;
+	// Index of the current byte.
+	uint32_t index;
+
+	if (argc > 1)
+	{
+		length = strtoul(argv[1], NULL, 0);
+	}
+	if (length == 0)
+	{
+		fprintf(stderr, "usage: %s [length]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	data    = malloc(length);
+	scratch = malloc(2 * length);
+	if ((data == NULL) || (scratch == NULL))
+	{
+		fprintf(stderr, "out of memory\n");
+		return EXIT_FAILURE;
+	}
+
+	// Pseudo random payload without bytes to escape, the worst case for the
+	// search kernels.
+	srand(1);
+	for (index = 0; index < length; index++)
+	{
+		do
+		{
+			data[index] = rand();
+		} while (GBEE_KERNEL_NEEDS_ESCAPE(data[index]));
+	}
+
+	printf("kernel: %s, length: %u bytes\n", gbeeKernelName(), length);
+	benchRun("sum", BENCH_SUM, data, length, scratch);
+	benchRun("find-delimiter", BENCH_FIND_DELIMITER, data, length, scratch);
+	benchRun("escape", BENCH_ESCAPE, data, length, scratch);
+
+	free(data);
+	free(scratch);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,392 @@
+/**
+ * \file
+ * \author  d264
+ * \version $Rev$
+ *
+ * \section DESCRIPTION
+ *
+ * This file contains the implementation of the driver mode: the I/O thread
+ * and its lock-free transmit queue.
+ *
+ * The transmit queue is a bounded ring of slots. Each slot carries a sequence
+ * number: a slot at free-running index i is free for the producer claiming
+ * index i if its sequence equals i, and filled for the I/O thread if its
+ * sequence equals i + 1. Producers claim an index by advancing the tail with
+ * GBEE_PORT_ATOMIC_CAS, so they never wait for each other while copying.
+ *
+ * \section LICENSE
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "gbee-driver.h"
+
+#ifdef GBEE_PORT_THREAD_CREATE
+
+/** Slot of the transmit queue at the given free-running index. */
+#define GBEE_DRIVER_SLOT(self, index) \
+		(&(self)->slots[(index) & (GBEE_DRIVER_QUEUE_SIZE - 1)])
+
+/**
+ * Main function of the I/O thread.
+ *
+ * \param[in] argument points to the driver.
+ *
+ * \return Always NULL.
+ */
+static void *gbeeDriverRun(void *argument);
+
+/**
+ * Sends the frames from the transmit queue, as far as the transmit buffer of
+ * the GBee device takes them.
+ *
+ * \param[in,out] self is a pointer to the driver.
+ *
+ * \return GBEE_NO_ERROR if successful (even if frames are left in the queue),
+ * or GBEE_RS232_ERROR in case of a serial communication error.
+ */
+static GBeeError gbeeDriverFlushQueue(GBeeDriver *self);
+
+/**
+ * Tells if the slot at the head of the transmit queue is filled.
+ *
+ * \param[in] self is a pointer to the driver.
+ *
+ * \return true if there is a frame to send.
+ */
+static bool gbeeDriverQueuePending(const GBeeDriver *self);
+
+/**
+ * Frame handler of the GBee device, passes the frame to all consumers.
+ *
+ * \param[in] gbee is the GBee device.
+ * \param[in] frameData points to the frame data.
+ * \param[in] length is the length of the frame data.
+ * \param[in] context points to the driver.
+ */
+static void gbeeDriverOnFrame(GBee *gbee, const GBeeFrameData *frameData,
+		uint16_t length, void *context);
+
+/******************************************************************************/
+
+void gbeeDriverInit(GBeeDriver *self, GBee *gbee)
+{
+	// Index of the current slot.
+	uint32_t index;
+
+	for (index = 0; index < GBEE_DRIVER_QUEUE_SIZE; index++)
+	{
+		self->slots[index].sequence = index;
+		self->slots[index].length   = 0;
+	}
+	self->gbee          = gbee;
+	self->tail          = 0;
+	self->head          = 0;
+	self->waiting       = 0;
+	self->running       = 0;
+	self->fullCount     = 0;
+	self->error         = GBEE_NO_ERROR;
+	self->consumerCount = 0;
+	self->wakeup        = -1;
+}
+
+/******************************************************************************/
+
+bool gbeeDriverAddConsumer(GBeeDriver *self, GBeeFrameHandler handler,
+		void *context)
+{
+	if (self->consumerCount >= GBEE_DRIVER_MAX_CONSUMERS)
+	{
+		return false;
+	}
+	self->consumers[self->consumerCount].handler = handler;
+	self->consumers[self->consumerCount].context = context;
+	self->consumerCount++;
+	return true;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeDriverStart(GBeeDriver *self)
+{
+	self->wakeup = GBEE_PORT_WAKEUP_CREATE();
+	if (self->wakeup < 0)
+	{
+		GBEE_THROW(GBEE_RS232_ERROR);
+	}
+
+	// Hand the GBee device over to the I/O thread.
+	gbeeSetNonBlocking(self->gbee, true);
+	gbeeSetFrameHandler(self->gbee, gbeeDriverOnFrame, self);
+	self->error   = GBEE_NO_ERROR;
+	self->running = 1;
+	if (!GBEE_PORT_THREAD_CREATE(&self->thread, gbeeDriverRun, self))
+	{
+		self->running = 0;
+		gbeeSetFrameHandler(self->gbee, NULL, NULL);
+		gbeeSetNonBlocking(self->gbee, false);
+		GBEE_PORT_WAKEUP_DESTROY(self->wakeup);
+		self->wakeup = -1;
+		GBEE_THROW(GBEE_RS232_ERROR);
+	}
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeDriverStop(GBeeDriver *self)
+{
+	// Let the I/O thread send the queued frames and exit.
+	self->running = 0;
+	GBEE_PORT_WAKEUP_SIGNAL(self->wakeup);
+	GBEE_PORT_THREAD_JOIN(self->thread);
+
+	// Take the GBee device back.
+	GBEE_PORT_WAKEUP_DESTROY(self->wakeup);
+	self->wakeup = -1;
+	gbeeSetFrameHandler(self->gbee, NULL, NULL);
+	gbeeSetNonBlocking(self->gbee, false);
+	return self->error;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeDriverSend(GBeeDriver *self, const GBeeFrameData *frameData,
+		uint16_t length)
+{
+	// Free-running index of the slot to fill.
+	uint32_t index;
+	// Slot to fill.
+	GBeeDriverSlot *slot;
+	// Number of frames rejected so far.
+	uint32_t fullCount;
+
+	// Check some pre-conditions.
+	if (self->error != GBEE_NO_ERROR)
+	{
+		GBEE_THROW(GBEE_INHERITED_ERROR);
+	}
+	if (length > GBEE_MAX_FRAME_SIZE)
+	{
+		GBEE_THROW(GBEE_FRAME_SIZE_ERROR);
+	}
+
+	// Claim the slot at the tail, retry if another thread claimed it first.
+	while (1)
+	{
+		index = self->tail;
+		slot  = GBEE_DRIVER_SLOT(self, index);
+		if (slot->sequence == index)
+		{
+			if (GBEE_PORT_ATOMIC_CAS(&self->tail, index, index + 1))
+			{
+				break;
+			}
+		}
+		else if ((int32_t)(slot->sequence - index) < 0)
+		{
+			// The I/O thread has not sent the frame of the previous round yet.
+			do
+			{
+				fullCount = self->fullCount;
+			}
+			while (!GBEE_PORT_ATOMIC_CAS(&self->fullCount, fullCount,
+					fullCount + 1));
+			GBEE_THROW(GBEE_WOULD_BLOCK_ERROR);
+		}
+	}
+
+	// Fill the slot and publish it (the swap orders the copy before it).
+	GBEE_PORT_MEMORY_COPY(slot->frameData, frameData, length);
+	slot->length = length;
+	GBEE_PORT_ATOMIC_CAS(&slot->sequence, index, index + 1);
+
+	// Wake up the I/O thread only if it is waiting.
+	if (self->waiting && GBEE_PORT_ATOMIC_CAS(&self->waiting, 1, 0))
+	{
+		GBEE_PORT_WAKEUP_SIGNAL(self->wakeup);
+	}
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
+uint32_t gbeeDriverGetFullCount(const GBeeDriver *self)
+{
+	return self->fullCount;
+}
+
+/******************************************************************************/
+
+static void *gbeeDriverRun(void *argument)
+{
+	// The driver.
+	GBeeDriver *self = (GBeeDriver *)argument;
+	// Events to wait for.
+	uint8_t events;
+	// Events occurred.
+	uint8_t occurred;
+	// Time to wait for events.
+	uint32_t timeout;
+	// GBee error code.
+	GBeeError error = GBEE_NO_ERROR;
+
+	while (error == GBEE_NO_ERROR)
+	{
+		error = gbeeDriverFlushQueue(self);
+		if (error != GBEE_NO_ERROR)
+		{
+			break;
+		}
+		if (!self->running && !gbeeDriverQueuePending(self)
+				&& !gbeeWritePending(self->gbee))
+		{
+			break;
+		}
+
+		events = GBEE_PORT_EVENT_READABLE | GBEE_PORT_EVENT_WAKEUP;
+		if (gbeeWritePending(self->gbee))
+		{
+			events |= GBEE_PORT_EVENT_WRITABLE;
+		}
+
+		// Announce that we are going to wait, then look at the queue again:
+		// a frame queued before the announcement would not wake us up.
+		GBEE_PORT_ATOMIC_CAS(&self->waiting, 0, 1);
+		if (gbeeDriverQueuePending(self) && !(events & GBEE_PORT_EVENT_WRITABLE))
+		{
+			GBEE_PORT_ATOMIC_CAS(&self->waiting, 1, 0);
+			continue;
+		}
+		// Wake up now and then while requests are in flight, so they time out.
+		timeout = (gbeeFrameIdGetInFlight(self->gbee) > 0)
+				? GBEE_DRIVER_TIMEOUT_TICK : GBEE_INFINITE_WAIT;
+		error = GBEE_PORT_UART_WAIT(self->gbee->serialDevice, self->wakeup,
+				events, &occurred, timeout);
+		GBEE_PORT_ATOMIC_CAS(&self->waiting, 1, 0);
+		if (error == GBEE_TIMEOUT_ERROR)
+		{
+			gbeeProcessTimeouts(self->gbee);
+			error = GBEE_NO_ERROR;
+			continue;
+		}
+		else if (error != GBEE_NO_ERROR)
+		{
+			break;
+		}
+
+		if (occurred & GBEE_PORT_EVENT_READABLE)
+		{
+			error = gbeeProcessReadable(self->gbee);
+		}
+		if ((error == GBEE_NO_ERROR) && (occurred & GBEE_PORT_EVENT_WRITABLE))
+		{
+			error = gbeeProcessWritable(self->gbee);
+		}
+	}
+
+	self->error = error;
+	return NULL;
+}
+
+/******************************************************************************/
+
+static GBeeError gbeeDriverFlushQueue(GBeeDriver *self)
+{
+	// Frame data of the frames to send.
+	GBeeFrameData *frames[GBEE_DRIVER_BATCH_SIZE];
+	// Lengths of the frames to send.
+	uint16_t lengths[GBEE_DRIVER_BATCH_SIZE];
+	// Slot of the current frame.
+	GBeeDriverSlot *slot;
+	// Number of frames to send.
+	uint16_t count;
+	// Index of the current frame.
+	uint16_t index;
+	// GBee error code.
+	GBeeError error;
+
+	while (1)
+	{
+		// Collect the frames queued so far.
+		for (count = 0; count < GBEE_DRIVER_BATCH_SIZE; count++)
+		{
+			slot = GBEE_DRIVER_SLOT(self, self->head + count);
+			if (slot->sequence != (self->head + count + 1))
+			{
+				break;
+			}
+			frames[count]  = (GBeeFrameData *)slot->frameData;
+			lengths[count] = slot->length;
+		}
+		if (count == 0)
+		{
+			return GBEE_NO_ERROR;
+		}
+		GBEE_PORT_MEMORY_BARRIER();
+
+		// Send as many of them as the transmit buffer takes.
+		do
+		{
+			error = gbeeSendBatch(self->gbee, frames, lengths, count);
+			if (error == GBEE_WOULD_BLOCK_ERROR)
+			{
+				count /= 2;
+			}
+		}
+		while ((error == GBEE_WOULD_BLOCK_ERROR) && (count > 0));
+		if (error == GBEE_WOULD_BLOCK_ERROR)
+		{
+			// Try again when the serial interface gets writable.
+			return GBEE_NO_ERROR;
+		}
+		GBEE_THROW(error);
+
+		// The frames are copied to the transmit buffer, free the slots.
+		GBEE_PORT_MEMORY_BARRIER();
+		for (index = 0; index < count; index++)
+		{
+			slot = GBEE_DRIVER_SLOT(self, self->head);
+			slot->sequence = self->head + GBEE_DRIVER_QUEUE_SIZE;
+			self->head++;
+		}
+	}
+}
+
+/******************************************************************************/
+
+static bool gbeeDriverQueuePending(const GBeeDriver *self)
+{
+	return GBEE_DRIVER_SLOT(self, self->head)->sequence == (self->head + 1);
+}
+
+/******************************************************************************/
+
+static void gbeeDriverOnFrame(GBee *gbee, const GBeeFrameData *frameData,
+		uint16_t length, void *context)
+{
+	// The driver.
+	GBeeDriver *self = (GBeeDriver *)context;
+	// Index of the current consumer.
+	uint16_t index;
+
+	for (index = 0; index < self->consumerCount; index++)
+	{
+		self->consumers[index].handler(gbee, frameData, length,
+				self->consumers[index].context);
+	}
+}
+
+#endif /* GBEE_PORT_THREAD_CREATE */
@@ -0,0 +1,223 @@
+/**
+ * \file
+ * \author  d264
+ * \version $Rev$
+ *
+ * \section DESCRIPTION
+ *
+ * The gbee-driver module provides the "driver mode" of the libgbee: a single
+ * I/O thread owned by the library sends and receives all frames of a GBee
+ * device, while any number of application threads hand frames over to it.
+ *
+ * Frames to send are copied into a bounded, lock-free multi-producer queue by
+ * gbeeDriverSend(), which never blocks and never calls the serial interface
+ * (except for waking the I/O thread if it is idle). The I/O thread takes the
+ * frames queued meanwhile and sends them with one call to gbeeSendBatch().
+ * Received frames are passed to the consumers registered with
+ * gbeeDriverAddConsumer(), which are called by the I/O thread.
+ *
+ * Driver mode is only available if the port provides threads, see
+ * GBEE_PORT_THREAD_CREATE. While the driver is running, the GBee device must
+ * not be used directly by the application.
+ *
+ * \section LICENSE
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#ifndef GBEE_DRIVER_H_INCLUDED
+#define GBEE_DRIVER_H_INCLUDED
+
+#include "gbee.h"
+
+#ifdef GBEE_PORT_THREAD_CREATE
+
+#ifndef GBEE_PORT_ATOMIC_CAS
+#error "Driver mode requires GBEE_PORT_ATOMIC_CAS"
+#endif
+
+#ifndef GBEE_DRIVER_QUEUE_SIZE
+/** Number of frames the transmit queue of a driver holds (must be a power of
+ * two). */
+#define GBEE_DRIVER_QUEUE_SIZE 64
+#endif
+
+#if (GBEE_DRIVER_QUEUE_SIZE & (GBEE_DRIVER_QUEUE_SIZE - 1)) != 0
+#error "GBEE_DRIVER_QUEUE_SIZE must be a power of two"
+#endif
+
+/** Maximum number of consumers registered with a driver. */
+#define GBEE_DRIVER_MAX_CONSUMERS 8
+
+/** Maximum number of frames passed to gbeeSendBatch() at once. */
+#define GBEE_DRIVER_BATCH_SIZE 16
+
+/** Time in milliseconds the I/O thread waits at most while requests are in
+ * flight, before checking them for timeouts (see gbeeProcessTimeouts()). */
+#define GBEE_DRIVER_TIMEOUT_TICK 100
+
+/**
+ * A slot of the transmit queue, holding the frame data of a frame to send.
+ */
+struct gbeeDriverSlot {
+	/** Sequence number telling whether the slot is free or filled (see
+	 * gbeeDriverSend()). */
+	volatile uint32_t sequence;
+	/** Length of the frame data in bytes. */
+	uint16_t length;
+	/** The frame data. */
+	uint8_t frameData[GBEE_MAX_FRAME_SIZE];
+};
+
+/** Type definition for ::gbeeDriverSlot. */
+typedef struct gbeeDriverSlot GBeeDriverSlot;
+
+/**
+ * A consumer of received frames.
+ */
+struct gbeeDriverConsumer {
+	/** Handler called for each frame received. */
+	GBeeFrameHandler handler;
+	/** Context pointer passed to the handler. */
+	void *context;
+};
+
+/** Type definition for ::gbeeDriverConsumer. */
+typedef struct gbeeDriverConsumer GBeeDriverConsumer;
+
+/**
+ * The driver: the I/O thread of a GBee device and its transmit queue.
+ */
+struct gbeeDriver {
+	/** The GBee device owned by the I/O thread. */
+	GBee *gbee;
+	/** The transmit queue. */
+	GBeeDriverSlot slots[GBEE_DRIVER_QUEUE_SIZE];
+	/** Free-running index of the next slot to fill, shared by all sending
+	 * threads. */
+	volatile uint32_t tail;
+	/** Free-running index of the next slot to send, only used by the I/O
+	 * thread. */
+	uint32_t head;
+	/** Non-zero while the I/O thread waits for events. */
+	volatile uint32_t waiting;
+	/** Non-zero until gbeeDriverStop() is called. */
+	volatile uint32_t running;
+	/** Number of frames rejected because the transmit queue was full. */
+	volatile uint32_t fullCount;
+	/** Error that made the I/O thread stop, GBEE_NO_ERROR while it runs. */
+	volatile GBeeError error;
+	/** Consumers of received frames. */
+	GBeeDriverConsumer consumers[GBEE_DRIVER_MAX_CONSUMERS];
+	/** Number of consumers registered. */
+	uint16_t consumerCount;
+	/** Port handle used to wake up the I/O thread. */
+	int wakeup;
+	/** The I/O thread. */
+	GBeePortThread thread;
+};
+
+/** Type definition for ::gbeeDriver. */
+typedef struct gbeeDriver GBeeDriver;
+
+/**
+ * Initializes a driver for the given GBee device. The I/O thread is not
+ * started yet, so consumers can be added first.
+ *
+ * \param[out] self is a pointer to the driver to initialize.
+ * \param[in] gbee is the GBee device, it must be in API mode.
+ */
+void gbeeDriverInit(GBeeDriver *self, GBee *gbee);
+
+/**
+ * Registers a consumer of received frames. All consumers are called for each
+ * frame, in the order they were added, by the I/O thread. Consumers must be
+ * added before gbeeDriverStart() is called.
+ *
+ * \param[in,out] self is a pointer to the driver.
+ * \param[in] handler is called for each frame received. The frame data is
+ * only valid until the handler returns.
+ * \param[in] context is passed to the handler.
+ *
+ * \return true if successful, false if GBEE_DRIVER_MAX_CONSUMERS consumers
+ * are registered already.
+ */
+bool gbeeDriverAddConsumer(GBeeDriver *self, GBeeFrameHandler handler,
+		void *context);
+
+/**
+ * Starts the I/O thread of the driver. From now on, the I/O thread owns the
+ * GBee device, which is switched to non-blocking mode (see
+ * gbeeSetNonBlocking()).
+ *
+ * \param[in,out] self is a pointer to the driver.
+ *
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_RS232_ERROR to indicate that the thread could not be created.
+ */
+GBeeError gbeeDriverStart(GBeeDriver *self);
+
+/**
+ * Stops the I/O thread of the driver, after sending the frames queued so far.
+ * Returns the GBee device to blocking mode, so the application may use it
+ * directly again.
+ *
+ * \param[in,out] self is a pointer to the driver.
+ *
+ * \return GBEE_NO_ERROR, or the error that made the I/O thread stop before.
+ */
+GBeeError gbeeDriverStop(GBeeDriver *self);
+
+/**
+ * Queues a frame to be sent by the I/O thread. The frame data is copied, so
+ * the caller may reuse it right away. This function may be called by any
+ * number of threads at the same time; it does not take a lock and does not
+ * block.
+ *
+ * \param[in,out] self is a pointer to the driver.
+ * \param[in] frameData is a pointer to the frame data to send.
+ * \param[in] length is the size in bytes of the frame data.
+ *
+ * \retval GBEE_NO_ERROR to indicate that the frame was queued.
+ * \retval GBEE_INHERITED_ERROR to indicate that the I/O thread stopped due to
+ * an error (see gbeeDriverStop()).
+ * \retval GBEE_FRAME_SIZE_ERROR to indicate that length exceeds the maximum
+ * allowed frame size.
+ * \retval GBEE_WOULD_BLOCK_ERROR to indicate that the transmit queue is full.
+ */
+GBeeError gbeeDriverSend(GBeeDriver *self, const GBeeFrameData *frameData,
+		uint16_t length);
+
+/**
+ * Returns the number of frames rejected by gbeeDriverSend() because the
+ * transmit queue was full.
+ *
+ * \param[in] self is a pointer to the driver.
+ *
+ * \return The number of rejected frames.
+ */
+uint32_t gbeeDriverGetFullCount(const GBeeDriver *self);
+
+#endif /* GBEE_PORT_THREAD_CREATE */
+
+#endif /* GBEE_DRIVER_H_INCLUDED */
+
+#ifdef __cplusplus
+}
+#endif
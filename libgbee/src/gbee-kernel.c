@@ -0,0 +1,305 @@
+/**
+ * \file
+ * \author  d264
+ * \version $Rev$
+ *
+ * \section DESCRIPTION
+ *
+ * This file contains the implementation of the byte processing loops used by
+ * the GBee driver.
+ *
+ * \section LICENSE
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "gbee-kernel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+/** Use AVX2 kernels. */
+#define GBEE_KERNEL_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+/** Use SSE2 kernels. */
+#define GBEE_KERNEL_SSE2
+#endif
+
+/** Machine word processed at once by the portable kernels. */
+typedef unsigned long GBeeKernelWord;
+
+/** Machine word with all bytes set to 0x01. */
+#define GBEE_KERNEL_ONES  ((GBeeKernelWord)-1 / 0xFF)
+/** Machine word with all bytes set to 0x80. */
+#define GBEE_KERNEL_HIGHS (GBEE_KERNEL_ONES * 0x80)
+/** Machine word with the low byte of each 16-bit lane set to 0xFF. */
+#define GBEE_KERNEL_LANES ((GBeeKernelWord)-1 / 0xFFFF * 0xFF)
+/** Tells if any byte of the given word is zero. */
+#define GBEE_KERNEL_HAS_ZERO(w) (((w) - GBEE_KERNEL_ONES) & ~(w) & GBEE_KERNEL_HIGHS)
+/** Tells if any byte of the given word equals the given byte. */
+#define GBEE_KERNEL_HAS_BYTE(w, b) GBEE_KERNEL_HAS_ZERO((w) ^ (GBEE_KERNEL_ONES * (b)))
+/** Number of words that can be summed up in 16-bit lanes without overflow
+ * (each word adds up to 2 * 255 to a lane). */
+#define GBEE_KERNEL_SUM_BLOCK 128
+
+/******************************************************************************/
+
+const char *gbeeKernelName(void)
+{
+#if defined(GBEE_KERNEL_AVX2)
+	return "avx2";
+#elif defined(GBEE_KERNEL_SSE2)
+	return "sse2";
+#else
+	return "word";
+#endif
+}
+
+/******************************************************************************/
+
+uint8_t gbeeKernelSum(const uint8_t *data, uint32_t length)
+{
+	// Index of the current byte.
+	uint32_t index = 0;
+	// 8-bit sum of the bytes.
+	uint8_t sum = 0;
+	// Current word of data.
+	GBeeKernelWord word;
+	// Sums of the even and odd bytes of the words, in 16-bit lanes.
+	GBeeKernelWord lanes;
+	// Number of words summed up in the lanes.
+	uint32_t words;
+	// Bit position of the current lane.
+	uint32_t shift;
+
+#if defined(GBEE_KERNEL_AVX2)
+	{
+		// Sums of 8-byte groups, in 64-bit lanes.
+		__m256i acc = _mm256_setzero_si256();
+		for (; (index + 32) <= length; index += 32)
+		{
+			acc = _mm256_add_epi64(acc, _mm256_sad_epu8(
+					_mm256_loadu_si256((const __m256i *)&data[index]),
+					_mm256_setzero_si256()));
+		}
+		// Sums folded into two 64-bit lanes.
+		__m128i fold = _mm_add_epi64(_mm256_castsi256_si128(acc),
+				_mm256_extracti128_si256(acc, 1));
+		sum += _mm_cvtsi128_si32(fold)
+				+ _mm_cvtsi128_si32(_mm_unpackhi_epi64(fold, fold));
+	}
+#elif defined(GBEE_KERNEL_SSE2)
+	{
+		// Sums of 8-byte groups, in 64-bit lanes.
+		__m128i acc = _mm_setzero_si128();
+		for (; (index + 16) <= length; index += 16)
+		{
+			acc = _mm_add_epi64(acc, _mm_sad_epu8(
+					_mm_loadu_si128((const __m128i *)&data[index]),
+					_mm_setzero_si128()));
+		}
+		sum += _mm_cvtsi128_si32(acc)
+				+ _mm_cvtsi128_si32(_mm_unpackhi_epi64(acc, acc));
+	}
+#endif
+
+	// Sum up whole words, the lanes are folded before they can overflow.
+	while ((index + sizeof(word)) <= length)
+	{
+		lanes = 0;
+		for (words = 0; (words < GBEE_KERNEL_SUM_BLOCK)
+				&& ((index + sizeof(word)) <= length); words++)
+		{
+			GBEE_PORT_MEMORY_COPY(&word, &data[index], sizeof(word));
+			lanes += (word & GBEE_KERNEL_LANES) + ((word >> 8) & GBEE_KERNEL_LANES);
+			index += sizeof(word);
+		}
+		for (shift = 0; shift < (8 * sizeof(lanes)); shift += 16)
+		{
+			sum += lanes >> shift;
+		}
+	}
+
+	// Sum up the tail.
+	for (; index < length; index++)
+	{
+		sum += data[index];
+	}
+	return sum;
+}
+
+/******************************************************************************/
+
+uint32_t gbeeKernelFindDelimiter(const uint8_t *data, uint32_t length)
+{
+	// Index of the current byte.
+	uint32_t index = 0;
+	// Current word of data.
+	GBeeKernelWord word;
+
+#if defined(GBEE_KERNEL_AVX2)
+	{
+		// Bit mask of the matching bytes.
+		uint32_t mask;
+		for (; (index + 32) <= length; index += 32)
+		{
+			mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(
+					_mm256_loadu_si256((const __m256i *)&data[index]),
+					_mm256_set1_epi8(GBEE_FRAME_START_DELIMITER)));
+			if (mask != 0)
+			{
+				return index + __builtin_ctz(mask);
+			}
+		}
+	}
+#elif defined(GBEE_KERNEL_SSE2)
+	{
+		// Bit mask of the matching bytes.
+		uint32_t mask;
+		for (; (index + 16) <= length; index += 16)
+		{
+			mask = _mm_movemask_epi8(_mm_cmpeq_epi8(
+					_mm_loadu_si128((const __m128i *)&data[index]),
+					_mm_set1_epi8(GBEE_FRAME_START_DELIMITER)));
+			if (mask != 0)
+			{
+				return index + __builtin_ctz(mask);
+			}
+		}
+	}
+#endif
+
+	// Skip whole words without a start delimiter.
+	while ((index + sizeof(word)) <= length)
+	{
+		GBEE_PORT_MEMORY_COPY(&word, &data[index], sizeof(word));
+		if (GBEE_KERNEL_HAS_BYTE(word, GBEE_FRAME_START_DELIMITER))
+		{
+			break;
+		}
+		index += sizeof(word);
+	}
+
+	// Locate the byte within the word (or check the tail).
+	while ((index < length) && (data[index] != GBEE_FRAME_START_DELIMITER))
+	{
+		index++;
+	}
+	return index;
+}
+
+/******************************************************************************/
+
+uint32_t gbeeKernelFindEscape(const uint8_t *data, uint32_t length)
+{
+	// Index of the current byte.
+	uint32_t index = 0;
+	// Current word of data.
+	GBeeKernelWord word;
+
+#if defined(GBEE_KERNEL_AVX2)
+	{
+		// Current block of data.
+		__m256i block;
+		// Bit mask of the matching bytes.
+		uint32_t mask;
+		for (; (index + 32) <= length; index += 32)
+		{
+			block = _mm256_loadu_si256((const __m256i *)&data[index]);
+			mask  = _mm256_movemask_epi8(_mm256_or_si256(
+					_mm256_or_si256(
+						_mm256_cmpeq_epi8(block, _mm256_set1_epi8(GBEE_FRAME_START_DELIMITER)),
+						_mm256_cmpeq_epi8(block, _mm256_set1_epi8(GBEE_ESCAPE))),
+					_mm256_or_si256(
+						_mm256_cmpeq_epi8(block, _mm256_set1_epi8(GBEE_XON)),
+						_mm256_cmpeq_epi8(block, _mm256_set1_epi8(GBEE_XOFF)))));
+			if (mask != 0)
+			{
+				return index + __builtin_ctz(mask);
+			}
+		}
+	}
+#elif defined(GBEE_KERNEL_SSE2)
+	{
+		// Current block of data.
+		__m128i block;
+		// Bit mask of the matching bytes.
+		uint32_t mask;
+		for (; (index + 16) <= length; index += 16)
+		{
+			block = _mm_loadu_si128((const __m128i *)&data[index]);
+			mask  = _mm_movemask_epi8(_mm_or_si128(
+					_mm_or_si128(
+						_mm_cmpeq_epi8(block, _mm_set1_epi8(GBEE_FRAME_START_DELIMITER)),
+						_mm_cmpeq_epi8(block, _mm_set1_epi8(GBEE_ESCAPE))),
+					_mm_or_si128(
+						_mm_cmpeq_epi8(block, _mm_set1_epi8(GBEE_XON)),
+						_mm_cmpeq_epi8(block, _mm_set1_epi8(GBEE_XOFF)))));
+			if (mask != 0)
+			{
+				return index + __builtin_ctz(mask);
+			}
+		}
+	}
+#endif
+
+	// Skip whole words without any byte to escape.
+	while ((index + sizeof(word)) <= length)
+	{
+		GBEE_PORT_MEMORY_COPY(&word, &data[index], sizeof(word));
+		if (GBEE_KERNEL_HAS_BYTE(word, GBEE_FRAME_START_DELIMITER)
+				| GBEE_KERNEL_HAS_BYTE(word, GBEE_ESCAPE)
+				| GBEE_KERNEL_HAS_BYTE(word, GBEE_XON)
+				| GBEE_KERNEL_HAS_BYTE(word, GBEE_XOFF))
+		{
+			break;
+		}
+		index += sizeof(word);
+	}
+
+	// Locate the byte within the word (or check the tail).
+	while ((index < length) && !GBEE_KERNEL_NEEDS_ESCAPE(data[index]))
+	{
+		index++;
+	}
+	return index;
+}
+
+/******************************************************************************/
+
+uint32_t gbeeKernelEscape(const uint8_t *source, uint32_t length,
+		uint8_t *destination)
+{
+	// Number of bytes stored to destination.
+	uint32_t count = 0;
+	// Number of bytes which can be copied as they are.
+	uint32_t plainLength;
+
+	while (length > 0)
+	{
+		plainLength = gbeeKernelFindEscape(source, length);
+		GBEE_PORT_MEMORY_COPY(&destination[count], source, plainLength);
+		count  += plainLength;
+		source += plainLength;
+		length -= plainLength;
+		if (length > 0)
+		{
+			destination[count++] = GBEE_ESCAPE;
+			destination[count++] = *source++ ^ GBEE_ESCAPE_XOR;
+			length--;
+		}
+	}
+	return count;
+}
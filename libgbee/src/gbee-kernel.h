@@ -0,0 +1,101 @@
+/**
+ * \file
+ * \author  d264
+ * \version $Rev$
+ *
+ * \section DESCRIPTION
+ *
+ * The gbee-kernel module provides the byte processing loops used in the hot
+ * path of the GBee driver: checksum calculation, the search for the frame
+ * start delimiter and the codec for escaped API frames (API mode 2).
+ *
+ * The implementation is picked at build time: AVX2 or SSE2 if the compiler
+ * targets it (e.g. -mavx2, SSE2 is always available on x86-64), otherwise a
+ * portable implementation processing a machine word at a time.
+ *
+ * \section LICENSE
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#ifndef GBEE_KERNEL_H_INCLUDED
+#define GBEE_KERNEL_H_INCLUDED
+
+#include "gbee.h"
+
+/** Tells if the given byte has to be escaped in API mode 2. */
+#define GBEE_KERNEL_NEEDS_ESCAPE(b) (((b) == GBEE_FRAME_START_DELIMITER) \
+		|| ((b) == GBEE_ESCAPE) || ((b) == GBEE_XON) || ((b) == GBEE_XOFF))
+
+/**
+ * Provides the name of the kernel implementation in use.
+ *
+ * \return "avx2", "sse2" or "word".
+ */
+const char *gbeeKernelName(void);
+
+/**
+ * Calculates the sum of the given bytes, keeping only the lowest 8 bits (as
+ * needed for the API frame checksum).
+ *
+ * \param[in] data points to the data to sum up.
+ * \param[in] length is the number of bytes.
+ *
+ * \return The 8-bit sum of the bytes.
+ */
+uint8_t gbeeKernelSum(const uint8_t *data, uint32_t length);
+
+/**
+ * Finds the first frame start delimiter (0x7E), like memchr.
+ *
+ * \param[in] data points to the data to search.
+ * \param[in] length is the number of bytes to search.
+ *
+ * \return The index of the first start delimiter, or length if there is none.
+ */
+uint32_t gbeeKernelFindDelimiter(const uint8_t *data, uint32_t length);
+
+/**
+ * Finds the first byte which has to be escaped in API mode 2.
+ *
+ * \param[in] data points to the data to search.
+ * \param[in] length is the number of bytes to search.
+ *
+ * \return The index of the first byte to escape, or length if there is none.
+ */
+uint32_t gbeeKernelFindEscape(const uint8_t *data, uint32_t length);
+
+/**
+ * Escapes the given data for API mode 2.
+ *
+ * \param[in] source points to the data to escape.
+ * \param[in] length is the number of bytes to escape.
+ * \param[out] destination is where to store the escaped data. It must have
+ * room for twice the given number of bytes.
+ *
+ * \return The number of bytes stored to destination.
+ */
+uint32_t gbeeKernelEscape(const uint8_t *source, uint32_t length,
+		uint8_t *destination);
+
+#endif /* GBEE_KERNEL_H_INCLUDED */
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,221 @@
+/**
+ * \file
+ * \author  d264
+ * \version $Rev$
+ *
+ * \section DESCRIPTION
+ *
+ * This file contains the implementation of the frame buffer pool.
+ *
+ * \section LICENSE
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "gbee-pool.h"
+#include "gbee-kernel.h"
+
+/** Bit mask with the bits of all buffers of a pool set. */
+#define GBEE_POOL_ALL_FREE ((uint32_t)(((uint64_t)1 << GBEE_POOL_SIZE) - 1))
+
+/**
+ * Replaces the given value by a new value, if it still equals the old value.
+ * Uses GBEE_PORT_ATOMIC_CAS if the port provides it.
+ * 
+ * \param[in,out] value points to the value to replace.
+ * \param[in] oldValue is the value expected.
+ * \param[in] newValue is the value to store.
+ * 
+ * \return true if the value was replaced, false if it changed meanwhile.
+ */
+static bool gbeePoolCompareAndSwap(volatile uint32_t *value, uint32_t oldValue,
+		uint32_t newValue);
+
+/**
+ * Adds the given (possibly negative) amount to the given value atomically.
+ * 
+ * \param[in,out] value points to the value to change.
+ * \param[in] amount is the amount to add.
+ * 
+ * \return The new value.
+ */
+static uint32_t gbeePoolAdd(volatile uint32_t *value, int32_t amount);
+
+/******************************************************************************/
+
+void gbeePoolInit(GBeeFramePool *self)
+{
+	// Index of the current buffer.
+	uint16_t index;
+
+	for (index = 0; index < GBEE_POOL_SIZE; index++)
+	{
+		self->buffers[index].pool     = self;
+		self->buffers[index].refCount = 0;
+		self->buffers[index].length   = 0;
+	}
+	self->exhaustedCount = 0;
+	self->freeMask       = GBEE_POOL_ALL_FREE;
+}
+
+/******************************************************************************/
+
+GBeeFrameBuffer *gbeePoolTake(GBeeFramePool *self)
+{
+	// Bit mask of the free buffers.
+	uint32_t freeMask;
+	// Index of the buffer to take.
+	uint16_t index;
+
+	// Clear the bit of the first free buffer, retry if another thread took or
+	// released a buffer meanwhile.
+	do
+	{
+		freeMask = self->freeMask;
+		if (freeMask == 0)
+		{
+			gbeePoolAdd(&self->exhaustedCount, 1);
+			return NULL;
+		}
+		index = __builtin_ctz(freeMask);
+	}
+	while (!gbeePoolCompareAndSwap(&self->freeMask, freeMask,
+			freeMask & ~((uint32_t)1 << index)));
+
+	self->buffers[index].refCount = 1;
+	self->buffers[index].length   = 0;
+	return &self->buffers[index];
+}
+
+/******************************************************************************/
+
+void gbeePoolRetain(GBeeFrameBuffer *buffer)
+{
+	gbeePoolAdd(&buffer->refCount, 1);
+}
+
+/******************************************************************************/
+
+void gbeePoolRelease(GBeeFrameBuffer *buffer)
+{
+	// Pool the buffer belongs to.
+	GBeeFramePool *pool = buffer->pool;
+	// Bit of the buffer in the mask of free buffers.
+	uint32_t bit = (uint32_t)1 << (buffer - pool->buffers);
+	// Bit mask of the free buffers.
+	uint32_t freeMask;
+
+	if (gbeePoolAdd(&buffer->refCount, -1) != 0)
+	{
+		return;
+	}
+
+	// Last reference released, return the buffer to the pool.
+	do
+	{
+		freeMask = pool->freeMask;
+	}
+	while (!gbeePoolCompareAndSwap(&pool->freeMask, freeMask, freeMask | bit));
+}
+
+/******************************************************************************/
+
+uint32_t gbeePoolGetExhaustedCount(const GBeeFramePool *self)
+{
+	return self->exhaustedCount;
+}
+
+/******************************************************************************/
+
+GBeeError gbeePoolReceive(GBee *self, GBeeFramePool *pool,
+		GBeeFrameBuffer **buffer, uint32_t *timeout)
+{
+	// Frame data held by the parser.
+	const GBeeFrameData *frameData;
+	// Length of the frame data.
+	uint16_t length;
+	// Header of the frame.
+	GBeeFrameHeader *frameHeader;
+	// Trailer of the frame.
+	GBeeFrameTrailer *frameTrailer;
+	// GBee error code.
+	GBeeError error;
+
+	// Take the buffer first, so no frame is lost if there is none.
+	*buffer = gbeePoolTake(pool);
+	if (*buffer == NULL)
+	{
+		GBEE_THROW(GBEE_NO_BUFFER_ERROR);
+	}
+
+	error = gbeeReceiveFrame(self, &frameData, &length, timeout);
+	if (error != GBEE_NO_ERROR)
+	{
+		gbeePoolRelease(*buffer);
+		*buffer = NULL;
+		GBEE_THROW(error);
+	}
+
+	// Store the complete frame.
+	frameHeader  = (GBeeFrameHeader *)(*buffer)->frame;
+	frameTrailer = (GBeeFrameTrailer *)&(*buffer)->frame[sizeof(GBeeFrameHeader)
+			+ length];
+	frameHeader->startDelimiter = GBEE_FRAME_START_DELIMITER;
+	frameHeader->length         = GBEE_USHORT(length);
+	GBEE_PORT_MEMORY_COPY(GBEE_FRAME_BUFFER_DATA(*buffer), frameData, length);
+	frameTrailer->checksum      = 0xFF - gbeeKernelSum((const uint8_t *)frameData,
+			length);
+	(*buffer)->length = length;
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
+GBeeError gbeePoolSend(GBee *self, const GBeeFrameBuffer *buffer)
+{
+	return gbeeSend(self, GBEE_FRAME_BUFFER_DATA(buffer), buffer->length);
+}
+
+/******************************************************************************/
+
+static bool gbeePoolCompareAndSwap(volatile uint32_t *value, uint32_t oldValue,
+		uint32_t newValue)
+{
+#ifdef GBEE_PORT_ATOMIC_CAS
+	return GBEE_PORT_ATOMIC_CAS(value, oldValue, newValue);
+#else
+	if (*value != oldValue)
+	{
+		return false;
+	}
+	*value = newValue;
+	return true;
+#endif
+}
+
+/******************************************************************************/
+
+static uint32_t gbeePoolAdd(volatile uint32_t *value, int32_t amount)
+{
+	// Value before the change.
+	uint32_t oldValue;
+
+	do
+	{
+		oldValue = *value;
+	}
+	while (!gbeePoolCompareAndSwap(value, oldValue, oldValue + amount));
+	return oldValue + amount;
+}
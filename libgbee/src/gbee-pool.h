@@ -0,0 +1,169 @@
+/**
+ * \file
+ * \author  d264
+ * \version $Rev$
+ *
+ * \section DESCRIPTION
+ *
+ * The gbee-pool module provides a pool of reference-counted frame buffers.
+ * Each buffer holds a complete API frame (GBEE_TOTAL_FRAME_SIZE bytes). The
+ * buffers are allocated with the pool, so taking and releasing a buffer never
+ * allocates memory. A buffer filled by gbeePoolReceive() can be held, passed
+ * to another thread or sent again (gbeePoolSend()) without copying the frame.
+ *
+ * Taking and releasing buffers is thread-safe if the port provides
+ * GBEE_PORT_ATOMIC_CAS, otherwise the pool must be used by a single thread.
+ *
+ * \section LICENSE
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#ifndef GBEE_POOL_H_INCLUDED
+#define GBEE_POOL_H_INCLUDED
+
+#include "gbee.h"
+
+#ifndef GBEE_POOL_SIZE
+/** Number of frame buffers per pool (at most 32). */
+#define GBEE_POOL_SIZE 16
+#endif
+
+#if (GBEE_POOL_SIZE < 1) || (GBEE_POOL_SIZE > 32)
+#error "GBEE_POOL_SIZE must be between 1 and 32"
+#endif
+
+/** Forward declaration of the frame buffer pool. */
+struct gbeeFramePool;
+
+/**
+ * A reference-counted buffer holding a complete API frame.
+ */
+struct gbeeFrameBuffer {
+	/** Pool the buffer belongs to. */
+	struct gbeeFramePool *pool;
+	/** Number of references held to the buffer, 0 if the buffer is free. */
+	volatile uint32_t refCount;
+	/** Length of the frame data in bytes. */
+	uint16_t length;
+	/** The API frame: frame header, frame data and frame trailer. */
+	uint8_t frame[GBEE_TOTAL_FRAME_SIZE];
+};
+
+/** Type definition for ::gbeeFrameBuffer. */
+typedef struct gbeeFrameBuffer GBeeFrameBuffer;
+
+/** Pointer to the frame data held by the given frame buffer. */
+#define GBEE_FRAME_BUFFER_DATA(b) \
+		((GBeeFrameData *)&(b)->frame[sizeof(GBeeFrameHeader)])
+
+/**
+ * A pool of frame buffers.
+ */
+struct gbeeFramePool {
+	/** Bit mask of the free buffers. */
+	volatile uint32_t freeMask;
+	/** Number of times a buffer was requested while the pool was empty. */
+	volatile uint32_t exhaustedCount;
+	/** The frame buffers. */
+	GBeeFrameBuffer buffers[GBEE_POOL_SIZE];
+};
+
+/** Type definition for ::gbeeFramePool. */
+typedef struct gbeeFramePool GBeeFramePool;
+
+/**
+ * Initializes the given frame buffer pool, all buffers are free afterwards.
+ * 
+ * \param[out] self is a pointer to the pool to initialize.
+ */
+void gbeePoolInit(GBeeFramePool *self);
+
+/**
+ * Takes a free buffer from the pool. The buffer is returned with a reference
+ * count of one.
+ * 
+ * \param[in,out] self is a pointer to the pool.
+ * 
+ * \return A pointer to the buffer, or NULL if all buffers are in use.
+ */
+GBeeFrameBuffer *gbeePoolTake(GBeeFramePool *self);
+
+/**
+ * Adds a reference to the given buffer, e.g. before passing it to another
+ * thread which releases it when done.
+ * 
+ * \param[in,out] buffer is a pointer to the buffer.
+ */
+void gbeePoolRetain(GBeeFrameBuffer *buffer);
+
+/**
+ * Releases a reference to the given buffer. The buffer is returned to its pool
+ * when the last reference is released.
+ * 
+ * \param[in,out] buffer is a pointer to the buffer.
+ */
+void gbeePoolRelease(GBeeFrameBuffer *buffer);
+
+/**
+ * Returns the number of times a buffer was requested from the given pool
+ * while all buffers were in use.
+ * 
+ * \param[in] self is a pointer to the pool.
+ * 
+ * \return The number of failed requests.
+ */
+uint32_t gbeePoolGetExhaustedCount(const GBeeFramePool *self);
+
+/**
+ * Reads a frame from the XBee into a buffer taken from the given pool. Works
+ * like gbeeReceiveFrame(), but the frame stays valid until the buffer is
+ * released.
+ * 
+ * \param[in] self is a pointer to the XBee device to read from.
+ * \param[in,out] pool is the pool to take the buffer from.
+ * \param[out] buffer is set to the buffer holding the received frame. The
+ * caller owns one reference to it.
+ * \param[in,out] timeout specifies a timeout in milliseconds, see
+ * gbeeReceive().
+ * 
+ * \retval GBEE_NO_BUFFER_ERROR to indicate that the pool is empty, no data is
+ * read from the XBee in this case.
+ * \return The same error codes as gbeeReceive() otherwise.
+ */
+GBeeError gbeePoolReceive(GBee *self, GBeeFramePool *pool,
+		GBeeFrameBuffer **buffer, uint32_t *timeout);
+
+/**
+ * Sends the frame held by the given buffer to the XBee, see gbeeSend(). The
+ * frame data is taken from GBEE_FRAME_BUFFER_DATA() and the length field of
+ * the buffer. The caller keeps its reference to the buffer.
+ * 
+ * \param[in] self is a pointer to the XBee device to write to.
+ * \param[in] buffer is the buffer to send.
+ * 
+ * \return The same error codes as gbeeSend().
+ */
+GBeeError gbeePoolSend(GBee *self, const GBeeFrameBuffer *buffer);
+
+#endif /* GBEE_POOL_H_INCLUDED */
+
+#ifdef __cplusplus
+}
+#endif
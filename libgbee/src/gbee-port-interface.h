@@ -11,7 +11,8 @@
  * \code
  * int gbeePortConnect(const char *deviceName);
  * \endcode
- * to connect to the serial interface.
+ * to connect to the serial interface, at 9600 bps with 8 data bits, no parity
+ * and 1 stop bit.
  * \param[in] deviceName is the name of the UART (e.g. "/dev/ttyS0") passed by
  * the calling application to the gbeeCreate() function.
  * \return A port-dependent device handle of the UART.
@@ -79,13 +80,38 @@
  * \code
  * unsigned int gbeePortTimeGet(void);
  * \endcode
- * to get a timestamp (in milliseconds).
+ * to get a timestamp (in milliseconds). The timestamp should not follow
+ * changes of the wall clock.
  * \return The current time in milliseconds.
  *
  * Additionally, there are some optional functions, which may be defined by a
  * port. If you do not want to provide these functions in your port you should
  * undef the corresponding macro. Following optional functions may be defined:
  *
+ * \subsection gbee_port_clock_get GBEE_PORT_CLOCK_GET
+ * \code
+ * GBeeTime gbeePortClockGet(void);
+ * \endcode
+ * to get a timestamp in nanoseconds from a monotonic clock, i.e. one that is
+ * not set back or forth with the wall clock (CLOCK_MONOTONIC on Linux). The
+ * GBee driver keeps all deadlines on this clock. If this macro is undefined,
+ * the clock is derived from GBEE_PORT_TIME_GET, with millisecond resolution;
+ * deadlines spanning the wrap-around of that 32-bit counter may then expire
+ * early or late.
+ * \return The current time in nanoseconds.
+ *
+ * \subsection gbee_port_sleep GBEE_PORT_SLEEP
+ * \code
+ * void gbeePortSleep(uint32_t milliseconds);
+ * \endcode
+ * to suspend the caller for the given time without using the CPU, e.g. by
+ * sleeping (Linux) or by idling the processor until the next interrupt
+ * (embedded systems). The function may return early (e.g. when interrupted);
+ * the GBee driver then calls it again. If this macro is undefined, the GBee
+ * driver polls the clock while waiting (e.g. for the guard time of the command
+ * mode).
+ * \param[in] milliseconds is the time to sleep.
+ *
  * \subsection gbee_port_memory_free GBEE_PORT_MEMORY_FREE
  * \code
  * void gbeePortMemoryFree(void *ptr);
@@ -95,6 +121,176 @@
  * to free allocated memory.
  * \param[in] ptr is a pointer to the allocated memory to free.
  *
+ * \subsection gbee_port_uart_receive_buffer GBEE_PORT_UART_RECEIVE_BUFFER
+ * \code
+ * GBeeError gbeePortReceiveBuffer(int       deviceIndex,
+ *                                 uint8_t  *buffer,
+ *                                 uint32_t  maxLength,
+ *                                 uint32_t *length,
+ *                                 uint32_t  timeout);
+ * \endcode
+ * to receive a block of data from the serial interface. The function waits
+ * until at least one byte is available (or the timeout expires) and then
+ * returns all bytes available, up to maxLength. If this macro is undefined,
+ * the GBee driver falls back to reading byte-wise using
+ * GBEE_PORT_UART_RECEIVE_BYTE.
+ * \param[in] deviceIndex is the device index returned by the call to
+ * GBEE_PORT_UART_CONNECT.
+ * \param[out] buffer is where to store the received data.
+ * \param[in] maxLength is the maximum number of bytes to receive.
+ * \param[out] length is the number of bytes received.
+ * \param[in] timeout specifies a timeout in milliseconds.
+ * \retval GBEE_NO_ERROR if successful.
+ * \retval GBEE_TIMEOUT_ERROR if the timeout expired without any data received.
+ * \retval GBEE_RS232_ERROR to indicate an error to establish serial
+ * communication.
+ *
+ * \subsection gbee_port_uart_send_vector GBEE_PORT_UART_SEND_VECTOR
+ * \code
+ * GBeeError gbeePortSendVector(int                 deviceIndex,
+ *                              const GBeeIoVector *vector,
+ *                              uint16_t            count);
+ * \endcode
+ * to send several blocks of data to the serial device in one go, like
+ * writev(). The GBee driver uses this function to send frame header, frame
+ * data and frame trailer without copying them into a contiguous buffer first.
+ * If this macro is undefined, the GBee driver copies the blocks into its
+ * scratch pad and uses GBEE_PORT_UART_SEND_BUFFER instead.
+ * \param[in] deviceIndex is the device index returned by the call to
+ * GBEE_PORT_UART_CONNECT.
+ * \param[in] vector points to the blocks of data to send.
+ * \param[in] count is the number of blocks (at most GBEE_IO_VECTOR_MAX).
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_RS232_ERROR to indicate a failure establishing serial
+ * communication.
+ *
+ * \subsection gbee_port_uart_write_buffer GBEE_PORT_UART_WRITE_BUFFER
+ * \code
+ * GBeeError gbeePortWriteBuffer(int            deviceIndex,
+ *                               const uint8_t *buffer,
+ *                               uint32_t       length,
+ *                               uint32_t      *written);
+ * \endcode
+ * to write as much of a block of data to the serial device as possible
+ * without blocking. This is used by the GBee driver in non-blocking mode (see
+ * gbeeSetNonBlocking()). If this macro is undefined, the GBee driver uses
+ * GBEE_PORT_UART_SEND_BUFFER instead.
+ * \param[in] deviceIndex is the device index returned by the call to
+ * GBEE_PORT_UART_CONNECT.
+ * \param[in] buffer points to the data to send.
+ * \param[in] length is the number of bytes to send.
+ * \param[out] written is the number of bytes actually sent.
+ * \retval GBEE_NO_ERROR to indicate success (even if not all bytes were sent).
+ * \retval GBEE_RS232_ERROR to indicate a failure establishing serial
+ * communication.
+ *
+ * \subsection gbee_port_uart_set_baud_rate GBEE_PORT_UART_SET_BAUD_RATE
+ * \code
+ * GBeeError gbeePortSetBaudRate(int deviceIndex, uint32_t baudRate);
+ * \endcode
+ * to change the baud rate of the serial interface, after the data written so
+ * far is sent. The serial interface starts at 9600 bps (see
+ * GBEE_PORT_UART_CONNECT). This macro is optional; if it is undefined, the
+ * GBee driver only supports 9600 bps (see gbeeCreateEx() and
+ * gbeeNegotiateBaud()).
+ * \param[in] deviceIndex is the device index returned by the call to
+ * GBEE_PORT_UART_CONNECT.
+ * \param[in] baudRate is the new baud rate in bps.
+ * \retval GBEE_NO_ERROR if successful.
+ * \retval GBEE_RS232_ERROR if the baud rate is not supported, or in case of
+ * an error.
+ *
+ * \subsection gbee_port_atomic_cas GBEE_PORT_ATOMIC_CAS
+ * \code
+ * bool gbeePortAtomicCas(volatile uint32_t *value,
+ *                        uint32_t           oldValue,
+ *                        uint32_t           newValue);
+ * \endcode
+ * to replace a value atomically if it still equals the expected value (like
+ * __sync_bool_compare_and_swap()). The frame buffer pool (see gbee-pool.h)
+ * uses this function to be shared between threads. If this macro is
+ * undefined, a frame buffer pool must only be used by a single thread.
+ * \param[in,out] value points to the value to replace.
+ * \param[in] oldValue is the value expected.
+ * \param[in] newValue is the value to store.
+ * \return true if the value was replaced, false otherwise.
+ *
+ * \subsection gbee_port_memory_barrier GBEE_PORT_MEMORY_BARRIER
+ * \code
+ * void gbeePortMemoryBarrier(void);
+ * \endcode
+ * to order the memory accesses before the call against the ones after it
+ * (like __sync_synchronize()). It is required for driver mode (see
+ * gbee-driver.h).
+ *
+ * \subsection gbee_port_thread_create GBEE_PORT_THREAD_CREATE
+ * \code
+ * bool gbeePortThreadCreate(GBeePortThread *thread,
+ *                           void *(*entry)(void *),
+ *                           void *argument);
+ * \endcode
+ * to start a thread. If this macro is defined, the port must also provide
+ * the type GBeePortThread and the functions GBEE_PORT_THREAD_JOIN,
+ * GBEE_PORT_WAKEUP_CREATE, GBEE_PORT_WAKEUP_SIGNAL, GBEE_PORT_WAKEUP_DESTROY,
+ * GBEE_PORT_UART_WAIT, GBEE_PORT_MEMORY_BARRIER and GBEE_PORT_ATOMIC_CAS. The
+ * driver mode of the libgbee (see gbee-driver.h) is only available if this
+ * macro is defined.
+ * \param[out] thread is the thread started.
+ * \param[in] entry is the function run by the thread.
+ * \param[in] argument is passed to the function.
+ * \return true if successful, false otherwise.
+ *
+ * \subsection gbee_port_thread_join GBEE_PORT_THREAD_JOIN
+ * \code
+ * void gbeePortThreadJoin(GBeePortThread thread);
+ * \endcode
+ * to wait until the given thread has finished.
+ * \param[in] thread is the thread to wait for.
+ *
+ * \subsection gbee_port_wakeup_create GBEE_PORT_WAKEUP_CREATE
+ * \code
+ * int gbeePortWakeupCreate(void);
+ * \endcode
+ * to create a wakeup handle, which can be signalled by one thread to end a
+ * GBEE_PORT_UART_WAIT call of another thread.
+ * \return The wakeup handle, or -1 in case of an error.
+ *
+ * \subsection gbee_port_wakeup_signal GBEE_PORT_WAKEUP_SIGNAL
+ * \code
+ * void gbeePortWakeupSignal(int wakeup);
+ * \endcode
+ * to signal a wakeup handle. The signal is kept until it ends a
+ * GBEE_PORT_UART_WAIT call.
+ * \param[in] wakeup is the handle returned by GBEE_PORT_WAKEUP_CREATE.
+ *
+ * \subsection gbee_port_wakeup_destroy GBEE_PORT_WAKEUP_DESTROY
+ * \code
+ * void gbeePortWakeupDestroy(int wakeup);
+ * \endcode
+ * to release a wakeup handle.
+ * \param[in] wakeup is the handle returned by GBEE_PORT_WAKEUP_CREATE.
+ *
+ * \subsection gbee_port_uart_wait GBEE_PORT_UART_WAIT
+ * \code
+ * GBeeError gbeePortWait(int       deviceIndex,
+ *                        int       wakeup,
+ *                        uint8_t   events,
+ *                        uint8_t  *occurred,
+ *                        uint32_t  timeout);
+ * \endcode
+ * to wait until the serial interface gets readable or writable, or the wakeup
+ * handle is signalled. A signal is consumed by this call.
+ * \param[in] deviceIndex is the device index returned by the call to
+ * GBEE_PORT_UART_CONNECT.
+ * \param[in] wakeup is the handle returned by GBEE_PORT_WAKEUP_CREATE, or
+ * GBEE_PORT_NO_WAKEUP to wait for the serial interface only.
+ * \param[in] events is the set of events to wait for (GBEE_PORT_EVENT_...).
+ * \param[out] occurred is the set of events occurred.
+ * \param[in] timeout specifies a timeout in milliseconds.
+ * \retval GBEE_NO_ERROR if an event occurred.
+ * \retval GBEE_TIMEOUT_ERROR if the timeout expired without any event.
+ * \retval GBEE_RS232_ERROR to indicate a serial communication error.
+ *
  * \subsection gbee_port_debug_log GBEE_PORT_DEBUG_LOG
  * \code
  * int gbeePortDebugLog(const char *format, ...);
@@ -155,6 +351,13 @@ extern "C"{
 /** Infinite wait for receive packet. */
 #define GBEE_INFINITE_WAIT 0xFFFFFFFF
 
+/** Point in time in nanoseconds of a monotonic clock, see
+ * GBEE_PORT_CLOCK_GET. */
+typedef uint64_t GBeeTime;
+
+/** Deadline that never passes. */
+#define GBEE_NO_DEADLINE ((GBeeTime)-1)
+
 /** Enumeration of possible error codes. */
 enum gbeeError {
 	/** No error. */
@@ -176,12 +379,41 @@ enum gbeeError {
 	/** Unexpected response from GBee. */
 	GBEE_RESPONSE_ERROR,
 	/** Timeout elapsed. */
-	GBEE_TIMEOUT_ERROR
+	GBEE_TIMEOUT_ERROR,
+	/** Operation would block. */
+	GBEE_WOULD_BLOCK_ERROR,
+	/** No frame buffer available. */
+	GBEE_NO_BUFFER_ERROR,
+	/** All frame IDs are in use. */
+	GBEE_NO_FRAME_ID_ERROR
 };
 
 /** Type definition for GBee error codes. */
 typedef enum gbeeError GBeeError;
 
+/** GBEE_PORT_UART_WAIT event: the serial interface is readable. */
+#define GBEE_PORT_EVENT_READABLE 0x01
+/** GBEE_PORT_UART_WAIT event: the serial interface is writable. */
+#define GBEE_PORT_EVENT_WRITABLE 0x02
+/** GBEE_PORT_UART_WAIT event: the wakeup handle was signalled. */
+#define GBEE_PORT_EVENT_WAKEUP   0x04
+/** GBEE_PORT_UART_WAIT wakeup handle: wait for the serial interface only. */
+#define GBEE_PORT_NO_WAKEUP      (-1)
+
+/** Maximum number of blocks passed to GBEE_PORT_UART_SEND_VECTOR at once. */
+#define GBEE_IO_VECTOR_MAX 16
+
+/** Describes a block of data for vectored (scatter-gather) I/O. */
+struct gbeeIoVector {
+	/** Pointer to the data. */
+	const uint8_t *data;
+	/** Length of the data in bytes. */
+	uint32_t length;
+};
+
+/** Type definition for ::gbeeIoVector. */
+typedef struct gbeeIoVector GBeeIoVector;
+
 #include "gbee-port.h"
 
 #endif /* GBEE_PORT_INTERFACE_H_INCLUDED */
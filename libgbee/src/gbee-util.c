@@ -40,28 +40,104 @@ struct __attribute__((__packed__)) udpHeader {
 /** UDP header type definition. */
 typedef struct udpHeader UdpHeader;
 
+/** Time to wait for the response to an AT command, in milliseconds. */
+#define GBEE_UTIL_RESPONSE_TIMEOUT 1000
+
+/** Outcome of an AT command sent by gbeeUtilXferRegister(). */
+struct gbeeUtilResponse {
+	bool done;                          /**< AT command completed. */
+	GBeeError error;                    /**< GBEE_NO_ERROR, or the failure. */
+	uint8_t atCommand[2];               /**< AT command answered. */
+	uint8_t status;                     /**< AT command status. */
+	uint16_t length;                    /**< Length of the value in bytes. */
+	uint8_t value[GBEE_MAX_FRAME_SIZE]; /**< Register value returned. */
+};
+
+/** AT command outcome type definition. */
+typedef struct gbeeUtilResponse GBeeUtilResponse;
+
+/** State of the AT commands sent by gbeeUtilXferBatch(). */
+struct gbeeUtilBatch {
+	bool done;                  /**< All AT commands completed. */
+	GBeeError error;            /**< GBEE_NO_ERROR, or the first failure. */
+	GBeeUtilRegister *entries;  /**< Registers accessed. */
+	uint16_t count;             /**< Number of registers accessed. */
+	bool read;                  /**< Registers are read, not written. */
+	uint16_t pending;           /**< Number of AT commands in flight. */
+	/** Frame IDs of the AT commands, in the order of the entries, followed by
+	 * the "AC" command if any. */
+	uint8_t frameIds[GBEE_UTIL_MAX_BATCH + 1];
+	/** AT commands in flight, indexed like frameIds. */
+	bool inFlight[GBEE_UTIL_MAX_BATCH + 1];
+};
+
+/** AT command batch type definition. */
+typedef struct gbeeUtilBatch GBeeUtilBatch;
+
+/**
+ * Sends an AT command asynchronously and waits until it completes. Frames
+ * received meanwhile are parked for later receive calls, see gbeeWaitUntil().
+ * 
+ * \param[in] gbee is a pointer to the GBee driver object.
+ * \param[in] regName specifies the name of the register.
+ * \param[in] value points to the AT command value.
+ * \param[in] length specifies the length of the AT command value.
+ * \param[out] response is filled in with the response.
+ * 
+ * \return GBEE_NO_ERROR if successful, or dedicated error code in case of an
+ * error.
+ */
+static GBeeError gbeeUtilXferRegister(GBee *gbee, const char *regName,
+		const uint8_t *value, uint16_t length, GBeeUtilResponse *response);
+
+/**
+ * Sends AT commands for up to GBEE_UTIL_MAX_BATCH registers without waiting
+ * for the responses in between, then waits until all of them complete.
+ * 
+ * \param[in] gbee is a pointer to the GBee driver object.
+ * \param[in,out] entries are the registers to access.
+ * \param[in] count is the number of registers.
+ * \param[in] read is true to read the registers, false to queue the values
+ *            with AT command - queue parameter value frames.
+ * \param[in] apply is true to apply the queued values with an "AC" command.
+ * 
+ * \return GBEE_NO_ERROR if successful, or dedicated error code in case of an
+ * error.
+ */
+static GBeeError gbeeUtilXferBatch(GBee *gbee, GBeeUtilRegister *entries,
+		uint16_t count, bool read, bool apply);
+
+/**
+ * Completion handler of the AT commands sent by gbeeUtilXferBatch(), checks
+ * the response and copies the value read to the register entry.
+ */
+static void gbeeUtilOnBatchResponse(GBee *gbee, uint8_t frameId,
+		GBeeError error, const GBeeFrameData *response, uint16_t length,
+		void *context);
+
+/**
+ * Completion handler of the AT commands sent by gbeeUtilXferRegister(), copies
+ * the response to the GBeeUtilResponse given as context.
+ */
+static void gbeeUtilOnResponse(GBee *gbee, uint8_t frameId, GBeeError error,
+		const GBeeFrameData *response, uint16_t length, void *context);
+
 /******************************************************************************/
 
 GBeeError gbeeUtilSetAddress16(GBee *gbee, uint16_t addr, uint16_t pan)
 {
 	/* GBee 16-bit address (register "MY"). */
-	uint16_t my;
+	uint16_t my = GBEE_USHORT(addr);
 	/* GBee 16-bit PAN-ID (register "ID"). */
-	uint16_t id;
-	/* Error code returned by the GBee driver. */
-	GBeeError error;
-	
-	/* Set the GBee's 16-bit address. */
-	my    = GBEE_USHORT(addr);
-	error = gbeeUtilWriteRegister(gbee, "MY", (uint8_t*)&my, sizeof(my));
-	GBEE_THROW(error);		                         
-
-	/* Set GBee's PAN ID. */
-	id    = GBEE_USHORT(pan);
-	error = gbeeUtilWriteRegister(gbee, "ID", (uint8_t*)&id, sizeof(id));
-	GBEE_THROW(error);
+	uint16_t id = GBEE_USHORT(pan);
+	/* Registers to write. */
+	GBeeUtilRegister entries[2] = {
+		{ "MY", (uint8_t *)&my, sizeof(my), 0 },
+		{ "ID", (uint8_t *)&id, sizeof(id), 0 }
+	};
 
-	return GBEE_NO_ERROR;
+	/* Set the GBee's 16-bit address and PAN ID at once. */
+	return gbeeUtilApplyConfig(gbee, entries, 2);
 }
 
 /******************************************************************************/
@@ -70,22 +146,27 @@ GBeeError gbeeUtilGetAddress16(GBee *gbee, uint16_t *addr, uint16_t *pan)
 {
 	/* Error code returned by the GBee driver. */
 	GBeeError error;
-	/* Length of data read from register. */
-	uint16_t length;
+	/* Value of the MY register (big-endian). */
+	uint8_t my[2];
+	/* Value of the ID register (big-endian). */
+	uint8_t id[2];
+	/* Registers to read. */
+	GBeeUtilRegister entries[2] = {
+		{ "MY", my, 0, sizeof(my) },
+		{ "ID", id, 0, sizeof(id) }
+	};
 	
-	/* Read GBee's 16-bit address. */
-	error = gbeeUtilReadRegister(gbee, "MY", (uint8_t *)addr, &length, sizeof(uint16_t));
-	GBEE_THROW(error);	
-
-	/* Convert endianess. */
-	(*addr) = GBEE_USHORT(*addr);	
-
-	/* Read GBee's PAN-ID. */
-	error = gbeeUtilReadRegister(gbee, "MY", (uint8_t*)pan, &length, sizeof(uint16_t));
-	GBEE_THROW(error);	
+	/* Read GBee's 16-bit address and PAN-ID. */
+	error = gbeeUtilReadRegisters(gbee, entries, 2);
+	GBEE_THROW(error);
+	if ((entries[0].length == 0) || (entries[1].length == 0))
+	{
+		GBEE_THROW(GBEE_RESPONSE_ERROR);
+	}
 
-	/* Convert endianess. */
-	(*pan) = GBEE_USHORT(*pan);	
+	/* The values are sent without leading zeros. */
+	*addr = (entries[0].length == 1) ? my[0] : ((my[0] << 8) | my[1]);
+	*pan  = (entries[1].length == 1) ? id[0] : ((id[0] << 8) | id[1]);
 
 	return GBEE_NO_ERROR;
 }
@@ -97,37 +178,20 @@ GBeeError gbeeUtilWriteRegister(GBee *gbee, const char *regName, const uint8_t *
 {
 	/* GBee error code. */
 	GBeeError error;
-	/* GBee response to AT commands. */
-	GBeeAtCommandResponse atCommandResponse;
-	/* Length of AT command response. */
-	uint16_t responseLength;
-	/* Timeout in milliseconds. */
-	uint32_t timeout;
+	/* GBee response to the AT command. */
+	GBeeUtilResponse response;
 	
-	/* Send command to write the register. */
-	error = gbeeSendAtCommand(gbee, GBEE_UTIL_DEFAULT_FRAME_ID, (uint8_t*)regName,
-			(uint8_t*)value, length);
-	GBEE_THROW(error);
-	
-	/* Receive the response. */
-	timeout = 1000;
-	do
-	{
-		error = gbeeReceive(gbee, (GBeeFrameData *)&atCommandResponse, &responseLength, 
-				&timeout);
-	}
-	while ((error == GBEE_NO_ERROR) && 
-	       (atCommandResponse.ident != GBEE_AT_COMMAND_RESPONSE));
+	/* Write the register. */
+	error = gbeeUtilXferRegister(gbee, regName, value, length, &response);
 	GBEE_THROW(error);
 	
 	/* Check the response. */
-	if ((atCommandResponse.atCommand[0] != regName[0]) || 
-	    (atCommandResponse.atCommand[1] != regName[1]) ||
-	    (atCommandResponse.status != GBEE_AT_COMMAND_STATUS_OK))
+	if (response.status != GBEE_AT_COMMAND_STATUS_OK)
 	{
 		GBEE_THROW(GBEE_RESPONSE_ERROR);
 	}
 	
+	gbeeRegisterCachePut(gbee, regName, value, length);
 	return GBEE_NO_ERROR;
 }
 
@@ -138,41 +202,130 @@ GBeeError gbeeUtilReadRegister(GBee *gbee, const char *regName, uint8_t *value,
 {
 	/* Error code returned by the GBee driver. */
 	GBeeError error;
-	/* GBee response to AT commands. */
-	GBeeAtCommandResponse atCommandResponse;
-	/* Length of AT command response. */
-	uint16_t responseLength;
-	/* Timeout in milliseconds. */
-	uint32_t timeout;
+	/* GBee response to the AT command. */
+	GBeeUtilResponse response;
 	
+	/* Serve the register from the cache if possible. */
+	if (gbeeRegisterCacheGet(gbee, regName, value, length, maxLength))
+	{
+		return GBEE_NO_ERROR;
+	}
+
 	/* Query the GBee for the given register. */
-	error = gbeeSendAtCommand(gbee, GBEE_UTIL_DEFAULT_FRAME_ID, (uint8_t *)regName, 
-			NULL, 0);
+	error = gbeeUtilXferRegister(gbee, regName, NULL, 0, &response);
 	GBEE_THROW(error);
+	
+	/* Check the response. */
+	if ((response.status != GBEE_AT_COMMAND_STATUS_OK) 
+			|| (maxLength < response.length))
+	{
+		GBEE_THROW(GBEE_RESPONSE_ERROR);
+	}
+	
+	GBEE_PORT_MEMORY_COPY(value, response.value, response.length);
+	*length = response.length;
+	return GBEE_NO_ERROR;
+}
 
-	/* Receive the response. */
-	timeout = 1000;
+/******************************************************************************/
+
+GBeeError gbeeUtilApplyConfig(GBee *gbee, const GBeeUtilRegister *entries,
+		uint16_t count)
+{
+	/* Error code returned by the GBee driver. */
+	GBeeError error;
+	/* Number of registers in the current batch. */
+	uint16_t batch;
+	/* First register to write. */
+	const GBeeUtilRegister *first = entries;
+	/* Number of registers to write. */
+	uint16_t total = count;
+	/* Index of the current register. */
+	uint16_t index;
+
+	/* Queue the values batch by batch, the last batch applies them all. The
+	 * entries are not modified when writing. */
 	do
 	{
-		error = gbeeReceive(gbee, (GBeeFrameData *)&atCommandResponse, &responseLength, 
-				&timeout);
+		batch = (count > GBEE_UTIL_MAX_BATCH) ? GBEE_UTIL_MAX_BATCH : count;
+		error = gbeeUtilXferBatch(gbee, (GBeeUtilRegister *)entries, batch,
+				false, batch == count);
+		GBEE_THROW(error);
+		entries += batch;
+		count   -= batch;
+	}
+	while (count > 0);
+
+	/* All values are applied now. */
+	for (index = 0; index < total; index++)
+	{
+		gbeeRegisterCachePut(gbee, first[index].regName, first[index].value,
+				first[index].length);
+	}
+
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeUtilReadRegisters(GBee *gbee, GBeeUtilRegister *entries,
+		uint16_t count)
+{
+	/* Error code returned by the GBee driver. */
+	GBeeError error;
+	/* Number of registers in the current batch. */
+	uint16_t batch;
+	/* Index of the current register. */
+	uint16_t index;
+
+	/* Serve the registers from the cache if all of them are known. */
+	for (index = 0; index < count; index++)
+	{
+		if (!gbeeRegisterCacheGet(gbee, entries[index].regName,
+				entries[index].value, &entries[index].length,
+				entries[index].maxLength))
+		{
+			break;
+		}
+	}
+	if (index == count)
+	{
+		return GBEE_NO_ERROR;
 	}
-	while ((error == GBEE_NO_ERROR) 
-			&& (atCommandResponse.ident != GBEE_AT_COMMAND_RESPONSE));
+
+	while (count > 0)
+	{
+		batch = (count > GBEE_UTIL_MAX_BATCH) ? GBEE_UTIL_MAX_BATCH : count;
+		error = gbeeUtilXferBatch(gbee, entries, batch, true, false);
+		GBEE_THROW(error);
+		entries += batch;
+		count   -= batch;
+	}
+
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeUtilReadMaxPayloadLength(GBee *gbee)
+{
+	/* Error code returned by the GBee driver. */
+	GBeeError error;
+	/* Value of the NP register (big-endian). */
+	uint8_t np[2];
+	/* Length of data read from register. */
+	uint16_t length;
+
+	/* Query the GBee for the maximum payload length. */
+	error = gbeeUtilReadRegister(gbee, "NP", np, &length, sizeof(np));
 	GBEE_THROW(error);
-	
-	responseLength -= GBEE_AT_COMMAND_RESPONSE_HEADER_LENGTH;
-	
-	/* Check the response. */
-	if ((atCommandResponse.atCommand[0] != regName[0]) 
-			|| (atCommandResponse.atCommand[1] != regName[1]) 
-			|| (atCommandResponse.status != GBEE_AT_COMMAND_STATUS_OK) 
-			|| (maxLength < responseLength))
+	if (length == 0)
 	{
 		GBEE_THROW(GBEE_RESPONSE_ERROR);
 	}
-	
-	GBEE_PORT_MEMORY_COPY(value, atCommandResponse.value, responseLength);
+
+	/* The value is sent without leading zeros. */
+	gbeeSetMaxPayloadLength(gbee, (length == 1) ? np[0] : ((np[0] << 8) | np[1]));
 	return GBEE_NO_ERROR;
 }
 
@@ -211,6 +364,37 @@ bool gbeeUtilEncodeUdp(const uint8_t *payload, uint16_t payloadLength,
 
 /******************************************************************************/
 
+GBeeError gbeeUtilSendUdp(GBee *gbee, const uint8_t *payload,
+		uint16_t payloadLength, uint16_t fromPort, const GBeeSockAddr *toAddr)
+{
+	/* UDP header. */
+	UdpHeader udpHeader;
+	/* UDP header and payload fragments. */
+	GBeeIoVector fragments[2];
+
+	/* Check the length of the payload. */
+	if ((payloadLength + sizeof(UdpHeader)) > gbeeGetMaxPayloadLength(gbee))
+	{
+		GBEE_THROW(GBEE_FRAME_SIZE_ERROR);
+	}
+
+	/* Create the UDP header. */
+	udpHeader.fromPort = GBEE_USHORT(fromPort);
+	udpHeader.toPort   = GBEE_USHORT(toAddr->port);
+	udpHeader.length   = GBEE_USHORT(payloadLength + sizeof(UdpHeader));
+	udpHeader.checksum = 0;
+
+	/* Send UDP header and payload without joining them. */
+	fragments[0].data   = (const uint8_t *)&udpHeader;
+	fragments[0].length = sizeof(UdpHeader);
+	fragments[1].data   = payload;
+	fragments[1].length = payloadLength;
+	return gbeeSendTxRequest16v(gbee, GBEE_UTIL_DEFAULT_FRAME_ID, toAddr->addr,
+			0, fragments, 2);
+}
+
+/******************************************************************************/
+
 bool gbeeUtilDecodeUdp(GBeeRxPacket16 *frame, uint16_t length, uint8_t **payload,
 		uint16_t *payloadLength, GBeeSockAddr *fromAddr)
 {
@@ -270,6 +454,12 @@ const char *gbeeUtilCodeToString(GBeeError code)
 			return "UNEXPECTED RESPONSE";
 		case GBEE_TIMEOUT_ERROR:
 			return "TIMEOUT";
+		case GBEE_WOULD_BLOCK_ERROR:
+			return "WOULD BLOCK";
+		case GBEE_NO_BUFFER_ERROR:
+			return "NO FRAME BUFFER";
+		case GBEE_NO_FRAME_ID_ERROR:
+			return "NO FRAME ID";
 		default:
 			return "UNKNOWN ERROR";
 	};
@@ -358,3 +548,231 @@ const char *gbeeUtilStatusCodeToString(uint8_t code)
 			return "Unknown Status";
 	};
 }
+
+/******************************************************************************/
+
+static GBeeError gbeeUtilXferRegister(GBee *gbee, const char *regName,
+		const uint8_t *value, uint16_t length, GBeeUtilResponse *response)
+{
+	/* Error code returned by the GBee driver. */
+	GBeeError error;
+	/* Frame ID of the AT command. */
+	uint8_t frameId;
+	/* Timeout in milliseconds. */
+	uint32_t timeout;
+
+	/* Send the AT command, its response completes it. */
+	response->done = false;
+	error = gbeeSendAtCommandAsync(gbee, (uint8_t *)regName, (uint8_t *)value,
+			length, GBEE_UTIL_RESPONSE_TIMEOUT, gbeeUtilOnResponse, response,
+			&frameId);
+	GBEE_THROW(error);
+
+	/* Wait until the AT command completes or times out, frames received
+	 * meanwhile are kept for the application. */
+	while (!response->done)
+	{
+		timeout = GBEE_UTIL_RESPONSE_TIMEOUT;
+		error = gbeeWaitUntil(gbee, &response->done, &timeout);
+		if ((error != GBEE_NO_ERROR) && (error != GBEE_TIMEOUT_ERROR))
+		{
+			/* Cancel the AT command, the response would outlive us. */
+			gbeeFrameIdRelease(gbee, frameId);
+			GBEE_THROW(error);
+		}
+	}
+	GBEE_THROW(response->error);
+
+	/* Check the response belongs to the register. */
+	if ((response->atCommand[0] != regName[0])
+			|| (response->atCommand[1] != regName[1]))
+	{
+		GBEE_THROW(GBEE_RESPONSE_ERROR);
+	}
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
+static void gbeeUtilOnResponse(GBee *gbee, uint8_t frameId, GBeeError error,
+		const GBeeFrameData *response, uint16_t length, void *context)
+{
+	/* Outcome of the AT command. */
+	GBeeUtilResponse *outcome = (GBeeUtilResponse *)context;
+
+	(void)gbee;
+	(void)frameId;
+	outcome->done  = true;
+	outcome->error = error;
+	if (error != GBEE_NO_ERROR)
+	{
+		return;
+	}
+	if (length < GBEE_AT_COMMAND_RESPONSE_HEADER_LENGTH)
+	{
+		outcome->error = GBEE_RESPONSE_ERROR;
+		return;
+	}
+	outcome->atCommand[0] = response->atCommandResponse.atCommand[0];
+	outcome->atCommand[1] = response->atCommandResponse.atCommand[1];
+	outcome->status       = response->atCommandResponse.status;
+	outcome->length       = length - GBEE_AT_COMMAND_RESPONSE_HEADER_LENGTH;
+	GBEE_PORT_MEMORY_COPY(outcome->value, response->atCommandResponse.value,
+			outcome->length);
+}
+
+/******************************************************************************/
+
+static GBeeError gbeeUtilXferBatch(GBee *gbee, GBeeUtilRegister *entries,
+		uint16_t count, bool read, bool apply)
+{
+	/* Error code returned by the GBee driver. */
+	GBeeError error = GBEE_NO_ERROR;
+	/* Error code of the wait for the responses. */
+	GBeeError waitError;
+	/* State of the AT commands. */
+	GBeeUtilBatch batch;
+	/* Index of the current register. */
+	uint16_t index;
+	/* Timeout in milliseconds. */
+	uint32_t timeout;
+
+	batch.done    = false;
+	batch.error   = GBEE_NO_ERROR;
+	batch.entries = entries;
+	batch.count   = count;
+	batch.read    = read;
+	batch.pending = 0;
+	for (index = 0; index <= GBEE_UTIL_MAX_BATCH; index++)
+	{
+		batch.inFlight[index] = false;
+	}
+
+	/* Send all AT commands, the responses complete them. */
+	for (index = 0; (index < count) && (error == GBEE_NO_ERROR); index++)
+	{
+		if (read)
+		{
+			error = gbeeSendAtCommandAsync(gbee,
+					(uint8_t *)entries[index].regName, NULL, 0,
+					GBEE_UTIL_RESPONSE_TIMEOUT, gbeeUtilOnBatchResponse, &batch,
+					&batch.frameIds[index]);
+		}
+		else
+		{
+			error = gbeeSendAtCommandQueueAsync(gbee,
+					(uint8_t *)entries[index].regName, entries[index].value,
+					entries[index].length, GBEE_UTIL_RESPONSE_TIMEOUT,
+					gbeeUtilOnBatchResponse, &batch, &batch.frameIds[index]);
+		}
+		if (error == GBEE_NO_ERROR)
+		{
+			batch.inFlight[index] = true;
+			batch.pending++;
+		}
+	}
+	if (apply && (error == GBEE_NO_ERROR))
+	{
+		error = gbeeSendAtCommandAsync(gbee, (uint8_t *)"AC", NULL, 0,
+				GBEE_UTIL_RESPONSE_TIMEOUT, gbeeUtilOnBatchResponse, &batch,
+				&batch.frameIds[count]);
+		if (error == GBEE_NO_ERROR)
+		{
+			batch.inFlight[count] = true;
+			batch.pending++;
+		}
+	}
+
+	/* Wait until the AT commands sent complete or time out, even if sending
+	 * failed: the batch state must outlive them. */
+	batch.done = (batch.pending == 0);
+	while (!batch.done)
+	{
+		timeout   = GBEE_UTIL_RESPONSE_TIMEOUT;
+		waitError = gbeeWaitUntil(gbee, &batch.done, &timeout);
+		if ((waitError != GBEE_NO_ERROR) && (waitError != GBEE_TIMEOUT_ERROR))
+		{
+			/* Cancel the AT commands, the responses would outlive us. */
+			for (index = 0; index <= count; index++)
+			{
+				if (batch.inFlight[index])
+				{
+					gbeeFrameIdRelease(gbee, batch.frameIds[index]);
+				}
+			}
+			GBEE_THROW(waitError);
+		}
+	}
+	GBEE_THROW(error);
+	GBEE_THROW(batch.error);
+
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
+static void gbeeUtilOnBatchResponse(GBee *gbee, uint8_t frameId,
+		GBeeError error, const GBeeFrameData *response, uint16_t length,
+		void *context)
+{
+	/* State of the AT commands. */
+	GBeeUtilBatch *batch = (GBeeUtilBatch *)context;
+	/* Index of the AT command. */
+	uint16_t index;
+	/* Name of the register. */
+	const char *regName;
+	/* Length of the value read. */
+	uint16_t valueLength;
+
+	(void)gbee;
+
+	/* Find the AT command. */
+	for (index = 0; index <= batch->count; index++)
+	{
+		if (batch->inFlight[index] && (batch->frameIds[index] == frameId))
+		{
+			break;
+		}
+	}
+	if (index > batch->count)
+	{
+		return;
+	}
+	batch->inFlight[index] = false;
+	batch->pending--;
+	batch->done = (batch->pending == 0);
+
+	/* Check the response, keep the first failure. */
+	if (batch->error != GBEE_NO_ERROR)
+	{
+		return;
+	}
+	if (error != GBEE_NO_ERROR)
+	{
+		batch->error = error;
+		return;
+	}
+	regName = (index < batch->count) ? batch->entries[index].regName : "AC";
+	if ((length < GBEE_AT_COMMAND_RESPONSE_HEADER_LENGTH)
+			|| (response->atCommandResponse.atCommand[0] != regName[0])
+			|| (response->atCommandResponse.atCommand[1] != regName[1])
+			|| (response->atCommandResponse.status != GBEE_AT_COMMAND_STATUS_OK))
+	{
+		batch->error = GBEE_RESPONSE_ERROR;
+		return;
+	}
+
+	/* Copy the value read. */
+	if (batch->read && (index < batch->count))
+	{
+		valueLength = length - GBEE_AT_COMMAND_RESPONSE_HEADER_LENGTH;
+		if (valueLength > batch->entries[index].maxLength)
+		{
+			batch->error = GBEE_RESPONSE_ERROR;
+			return;
+		}
+		GBEE_PORT_MEMORY_COPY(batch->entries[index].value,
+				response->atCommandResponse.value, valueLength);
+		batch->entries[index].length = valueLength;
+	}
+}
@@ -16,7 +16,9 @@
  *
  * To set any register of the XBee module you can call the function
  * gbeeUtilWriteRegister(). To query the value of a register of the XBee module
- * you can call the function gbeeUtilReadRegister().
+ * you can call the function gbeeUtilReadRegister(). To write or read several
+ * registers in a single round trip, call gbeeUtilApplyConfig() or
+ * gbeeUtilReadRegisters().
  *
  * \subsection xbee_error_string_conversion XBee Error to String Conversion
  *
@@ -31,7 +33,8 @@
  * module operated by the XBee Tunnel Daemon.
  *
  * To encode a XBee data frame into an UDP packet the GBee utilities provide
- * the function gbeeUtilEncodeUdp(). To decode a received UDP packet containing
+ * the function gbeeUtilEncodeUdp(), or gbeeUtilSendUdp() to encode and send
+ * it without copying the payload. To decode a received UDP packet containing
  * an XBee frame, there is the function gbeeUtilDecodeUdp().
  *
  * For more information how to do UDP tunneling with the libgbee, please refer
@@ -87,6 +90,22 @@ struct __attribute__((__packed__)) GBeeSockAddr {
 /** Type definition for GBee UDP socket address. */
 typedef struct GBeeSockAddr GBeeSockAddr;
 
+/** Maximum number of AT commands gbeeUtilApplyConfig() and
+ * gbeeUtilReadRegisters() keep in flight at once. */
+#define GBEE_UTIL_MAX_BATCH 32
+
+/** XBee register accessed by gbeeUtilApplyConfig() or gbeeUtilReadRegisters(). */
+struct GBeeUtilRegister {
+	const char *regName; /**< Name of the register. */
+	uint8_t *value;      /**< Value to write, or buffer for the value read. */
+	uint16_t length;     /**< Length of the value to write, or of the value
+	                          read. */
+	uint16_t maxLength;  /**< Size of the buffer (reading only). */
+};
+
+/** Type definition for XBee register access. */
+typedef struct GBeeUtilRegister GBeeUtilRegister;
+
 /**
  * Sets the XBee's 16-bit address and PAN ID.
  * The XBee has to be in API mode when this function is called!
@@ -130,7 +149,8 @@ GBeeError gbeeUtilWriteRegister(GBee *gbee, const char *regName, const uint8_t *
 		uint16_t length);
 
 /**
- * Reads data from a XBee register.
+ * Reads data from a XBee register. The value is taken from the register cache
+ * if known (see gbeeRegisterCacheGet()).
  * The XBee has to be in API mode when this function is called!
  * 
  * \param[in] gbee is a pointer to the GBee driver object.
@@ -146,6 +166,60 @@ GBeeError gbeeUtilWriteRegister(GBee *gbee, const char *regName, const uint8_t *
 GBeeError gbeeUtilReadRegister(GBee *gbee, const char *regName, uint8_t *value,
 		uint16_t *length, uint16_t maxLength);
 
+/**
+ * Writes several XBee registers and applies the changes at once. The values
+ * are queued with AT command - queue parameter value frames and applied by
+ * one "AC" command, all sent without waiting for the responses in between, so
+ * the whole configuration takes a single round trip (per GBEE_UTIL_MAX_BATCH
+ * registers). Frames received meanwhile are parked for later receive calls,
+ * see gbeeWaitUntil().
+ * The XBee has to be in API mode when this function is called!
+ * 
+ * \param[in] gbee is a pointer to the GBee driver object.
+ * \param[in] entries are the registers to write (regName, value and length).
+ *            Remember to convert endianess if you write a multi-byte value.
+ * \param[in] count is the number of registers.
+ * 
+ * \return GBEE_NO_ERROR if successful, GBEE_RESPONSE_ERROR if the XBee
+ * rejected any of the values (the others are applied nonetheless), or
+ * dedicated error code in case of an error.
+ */
+GBeeError gbeeUtilApplyConfig(GBee *gbee, const GBeeUtilRegister *entries,
+		uint16_t count);
+
+/**
+ * Reads several XBee registers. The AT commands are sent without waiting for
+ * the responses in between, so reading takes a single round trip (per
+ * GBEE_UTIL_MAX_BATCH registers). Frames received meanwhile are parked for
+ * later receive calls, see gbeeWaitUntil(). If all values are known to the
+ * register cache (see gbeeRegisterCacheGet()), the XBee is not queried at all.
+ * The XBee has to be in API mode when this function is called!
+ * 
+ * \param[in] gbee is a pointer to the GBee driver object.
+ * \param[in,out] entries are the registers to read: regName, value and
+ *            maxLength are input, length is set to the length read. Values
+ *            are sent without leading zeros.
+ * \param[in] count is the number of registers.
+ * 
+ * \return GBEE_NO_ERROR if successful, GBEE_RESPONSE_ERROR if any of the
+ * registers could not be read, or dedicated error code in case of an error.
+ */
+GBeeError gbeeUtilReadRegisters(GBee *gbee, GBeeUtilRegister *entries,
+		uint16_t count);
+
+/**
+ * Reads the maximum payload length from the XBee's NP register and applies it
+ * to the GBee driver object (see gbeeSetMaxPayloadLength()). Modules without
+ * NP register answer with an error, the driver's limit is not changed then.
+ * The XBee has to be in API mode when this function is called!
+ * 
+ * \param[in] gbee is a pointer to the GBee driver object.
+ * 
+ * \return GBEE_NO_ERROR if successful, or dedicated error code in case of an
+ * error.
+ */
+GBeeError gbeeUtilReadMaxPayloadLength(GBee *gbee);
+
 /**
  * Encode the given payload into a GBee UDP frame.
  * 
@@ -162,6 +236,24 @@ bool gbeeUtilEncodeUdp(const uint8_t *payload, uint16_t payloadLength,
 		uint16_t fromPort, const GBeeSockAddr *toAddr,
 		GBeeTxRequest16 *txRequest, uint16_t *totalLength);
 
+/**
+ * Encode the given payload into a GBee UDP frame and send it. UDP header and
+ * payload are passed to gbeeSendTxRequest16v() as separate fragments, so the
+ * payload is not copied.
+ * 
+ * \param[in] gbee is a pointer to the GBee driver object.
+ * \param[in] payload is a pointer to the UDP payload.
+ * \param[in] payloadLength is the length of the payload.
+ * \param[in] fromPort is the originating port number.
+ * \param[in] toAddr is the port and 16bit address of the remote host.
+ * 
+ * \return GBEE_NO_ERROR if successful, GBEE_FRAME_SIZE_ERROR if payload and
+ * UDP header exceed the maximum payload length (see gbeeGetMaxPayloadLength()),
+ * or dedicated error code in case of an error.
+ */
+GBeeError gbeeUtilSendUdp(GBee *gbee, const uint8_t *payload,
+		uint16_t payloadLength, uint16_t fromPort, const GBeeSockAddr *toAddr);
+
 /**
  * Check if the given GBee frame data contains a UDP packet and decode the UDP
  * and payload data.
@@ -26,6 +26,7 @@
  */
 
 #include "gbee.h"
+#include "gbee-kernel.h"
 
 #ifdef GBEE_PORT_DEBUG_LOG
 #define GBEE_DEBUG_LOG GBEE_PORT_DEBUG_LOG
@@ -39,15 +40,84 @@
 #define GBEE_MEMORY_FREE(p)
 #endif
 
+#ifdef GBEE_PORT_MEMORY_BARRIER
+#define GBEE_MEMORY_BARRIER GBEE_PORT_MEMORY_BARRIER
+#else
+#define GBEE_MEMORY_BARRIER()
+#endif
+
+/** Number of bytes held in the receive buffer of the given GBee device. */
+#define GBEE_RX_BUFFER_COUNT(self) ((uint16_t)((self)->rx.tail - (self)->rx.head))
+/** Offset of the given free-running index within the receive buffer. */
+#define GBEE_RX_BUFFER_OFFSET(index) ((index) & (GBEE_RX_BUFFER_SIZE - 1))
+/** Number of bytes held in the transmit buffer of the given GBee device. */
+#define GBEE_TX_BUFFER_COUNT(self) ((uint16_t)((self)->tx.tail - (self)->tx.head))
+/** Offset of the given free-running index within the transmit buffer. */
+#define GBEE_TX_BUFFER_OFFSET(index) ((index) & (GBEE_TX_BUFFER_SIZE - 1))
+/** Maximum length of an escaped API frame (start delimiter is not escaped). */
+#define GBEE_ESCAPED_FRAME_SIZE (1 + 2 * (GBEE_TOTAL_FRAME_SIZE - 1))
+/** Tells if the given frame ID is one handed out by gbeeFrameIdAlloc(). The
+ * upper bound is only checked if it is below the largest uint8_t. */
+#if GBEE_MAX_FRAME_IDS < 255
+#define GBEE_FRAME_ID_VALID(id) (((id) >= 1) && ((id) <= GBEE_MAX_FRAME_IDS))
+#else
+#define GBEE_FRAME_ID_VALID(id) ((id) >= 1)
+#endif
+/** Time in milliseconds to wait for each response in command mode. */
+#define GBEE_AT_RESPONSE_TIMEOUT 2000
+
+/** Number of bytes of the API mode probe and its response on the wire. */
+#define GBEE_PROBE_FRAME_BYTES 18
+/** Time in milliseconds added to the transfer time of the probe for the
+ * XBee to answer. */
+#define GBEE_PROBE_MARGIN 80
+/** Time in milliseconds gbeeGetMode() waits for the answer to its API mode
+ * probe at the given baud rate (10 bits per byte), before falling back to
+ * command mode. */
+#define GBEE_PROBE_TIMEOUT(baudRate) \
+		((GBEE_PROBE_FRAME_BYTES * 10 * 1000 + (baudRate) - 1) / (baudRate) \
+				+ GBEE_PROBE_MARGIN)
+/** Number of frame IDs gbeeProbeApiMode() tries to find one that needs no
+ * escaping. */
+#define GBEE_PROBE_ATTEMPTS 4
+
+/** Outcome of an AT command sent by gbeeProbeApiMode() or
+ * gbeeNegotiateBaud(). */
+struct gbeeProbe {
+	bool done;       /**< Probe completed. */
+	GBeeError error; /**< GBEE_NO_ERROR, or the failure. */
+	uint8_t status;  /**< AT command status. */
+	uint16_t length; /**< Length of the value in bytes. */
+	uint8_t value;   /**< Value of the AP register. */
+};
+
+/** API mode probe type definition. */
+typedef struct gbeeProbe GBeeProbe;
+
+/** Registers held by the register cache, in the order of its entries. */
+static const char gbeeCachedRegisters[GBEE_REGISTER_CACHE_SIZE][2] = {
+	{'M', 'Y'}, {'I', 'D'}, {'C', 'H'}, {'A', 'P'}, {'N', 'P'}, {'S', 'H'},
+	{'S', 'L'}, {'D', 'H'}, {'D', 'L'}, {'C', 'E'}, {'B', 'D'}
+};
+
+/** Number of baud rates the XBee selects with its BD register. */
+#define GBEE_BAUD_RATE_COUNT 8
+
+/** Baud rates of the XBee, indexed by the value of its BD register. */
+static const uint32_t gbeeBaudRates[GBEE_BAUD_RATE_COUNT] = {
+	1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200
+};
+
 /**
  * Calculates and returns the frame data checksum.
  * 
- * \param[in] frameData points to the data to calculate the checksum for.
- * \param[in] length is the length of the frame data.
+ * \param[in] fragments points to the blocks making up the frame data.
+ * \param[in] count is the number of blocks.
  * 
  * \return Frame data checksum.
  */
-static uint8_t gbeeCalculateChecksum(const uint8_t *frameData, uint8_t length);
+static uint8_t gbeeCalculateChecksum(const GBeeIoVector *fragments,
+		uint16_t count);
 
 /**
  * Verifies the frame data checksum.
@@ -58,9 +128,60 @@ static uint8_t gbeeCalculateChecksum(const uint8_t *frameData, uint8_t length);
  * \return GBEE_NO_ERROR if the checksum is valid and GBEE_CHECKSUM_ERROR 
  * otherwise.
  */
-static GBeeError gbeeVerifyChecksum(const uint8_t *frameData, uint8_t length,
+static GBeeError gbeeVerifyChecksum(const uint8_t *frameData, uint16_t length,
 		uint8_t checksum);
+
+/**
+ * Calculates the total length of the given payload fragments.
+ * 
+ * \param[in] fragments points to the payload fragments.
+ * \param[in] count is the number of fragments.
+ * 
+ * \return The total length in bytes.
+ */
+static uint32_t gbeeGetPayloadLength(const GBeeIoVector *fragments,
+		uint16_t count);
 		
+/**
+ * Runs the API frame parser state machine over the given bytes. Stops after a
+ * corrupt frame, so the caller can resynchronize.
+ * 
+ * \param[in,out] self is a pointer to the parser.
+ * \param[in] bytes points to the data to parse.
+ * \param[in] length is the number of bytes to parse.
+ * \param[in,out] proceed is set to false if the callback asks to stop.
+ * \param[in,out] corrupt is set to true if a corrupt frame was found.
+ * 
+ * \return The number of bytes consumed.
+ */
+static uint32_t gbeeParserParse(GBeeParser *self, const uint8_t *bytes,
+		uint32_t length, bool *proceed, bool *corrupt);
+
+/**
+ * Takes a byte received by the API frame parser, unescaping it if it follows
+ * the escape character.
+ * 
+ * \param[in,out] self is a pointer to the parser.
+ * \param[in] byte is the byte received.
+ * 
+ * \return The unescaped byte.
+ */
+static uint8_t gbeeParserTakeByte(GBeeParser *self, uint8_t byte);
+
+/**
+ * Escapes an API frame for API mode 2.
+ * 
+ * \param[in] vector points to the blocks making up the frame, starting with
+ * the frame header.
+ * \param[in] count is the number of blocks.
+ * \param[out] buffer is where to store the escaped frame, it must have room
+ * for GBEE_ESCAPED_FRAME_SIZE bytes.
+ * 
+ * \return The length of the escaped frame.
+ */
+static uint16_t gbeeEscapeFrame(const GBeeIoVector *vector, uint16_t count,
+		uint8_t *buffer);
+
 /**
  * Starts buffering data from the GBee, until the given maximum number of byte
  * is buffered, or until the stop character is received, or until no byte is
@@ -77,10 +198,338 @@ static GBeeError gbeeVerifyChecksum(const uint8_t *frameData, uint8_t length,
  * error.
  */
 static GBeeError gbeeGetResponse(GBee *self, uint8_t *response, uint16_t *size,
-		uint16_t maxSize, char stopChar, uint32_t charTimeout);
+		uint16_t maxSize, char stopChar, GBeeTime deadline);
+
+/**
+ * Refills the receive buffer of the GBee device from the serial interface.
+ * Reads all bytes available (as far as they fit into the buffer) with a
+ * single call to the port.
+ * 
+ * \param[in] self points to the GBee device.
+ * \param[in] deadline is the point in time to give up at.
+ * 
+ * \return GBEE_NO_ERROR if data was buffered, GBEE_TIMEOUT_ERROR if no data
+ * was received, or GBEE_RS232_ERROR in case of a serial communication error.
+ */
+static GBeeError gbeeFillRxBuffer(GBee *self, GBeeTime deadline);
+
+/**
+ * Takes the next byte from the receive buffer of the GBee device. If the
+ * buffer is empty, it is refilled from the serial interface first.
+ * 
+ * \param[in] self points to the GBee device.
+ * \param[out] byte is the byte received.
+ * \param[in] deadline is the point in time to give up at.
+ * 
+ * \return GBEE_NO_ERROR if successful, GBEE_TIMEOUT_ERROR if no data was
+ * received, or GBEE_RS232_ERROR in case of a serial communication error.
+ */
+static GBeeError gbeeReceiveByte(GBee *self, uint8_t *byte, GBeeTime deadline);
+
+/**
+ * Sends an API frame assembled from the given blocks of frame data. Frame
+ * header and trailer are added, and the checksum is calculated over the blocks
+ * in place.
+ * 
+ * \param[in] self points to the GBee device.
+ * \param[in] fragments points to the blocks making up the frame data.
+ * \param[in] count is the number of blocks.
+ * 
+ * \return GBEE_NO_ERROR if successful, or dedicated error code in case of any
+ * error.
+ */
+static GBeeError gbeeSendFragments(GBee *self, const GBeeIoVector *fragments,
+		uint16_t count);
+
+/**
+ * Sends several blocks of data to the XBee. In blocking mode, the data is sent
+ * directly (with a single vectored write if supported by the port). In
+ * non-blocking mode, the data is queued in the transmit buffer and as much of
+ * the transmit buffer as possible is sent.
+ * 
+ * \param[in] self points to the GBee device.
+ * \param[in] vector points to the blocks of data to send.
+ * \param[in] count is the number of blocks.
+ * \param[in] length is the total number of bytes to send.
+ * 
+ * \return GBEE_NO_ERROR if successful, GBEE_WOULD_BLOCK_ERROR if the transmit
+ * buffer is full, or GBEE_RS232_ERROR in case of a serial communication error.
+ */
+static GBeeError gbeeTransmit(GBee *self, const GBeeIoVector *vector,
+		uint16_t count, uint16_t length);
+
+/**
+ * Copies several blocks of data to the transmit buffer. The caller has to make
+ * sure that the data fits into the buffer.
+ * 
+ * \param[in] self points to the GBee device.
+ * \param[in] vector points to the blocks of data to queue.
+ * \param[in] count is the number of blocks.
+ */
+static void gbeeEnqueue(GBee *self, const GBeeIoVector *vector, uint16_t count);
+
+/**
+ * Sends all data from the transmit buffer, blocking until done.
+ * 
+ * \param[in] self points to the GBee device.
+ * 
+ * \return GBEE_NO_ERROR if successful, or GBEE_RS232_ERROR in case of a
+ * serial communication error.
+ */
+static GBeeError gbeeDrainTxBuffer(GBee *self);
+
+/**
+ * Sends as much data from the transmit buffer as possible without blocking.
+ * 
+ * \param[in] self points to the GBee device.
+ * 
+ * \return GBEE_NO_ERROR if successful, or GBEE_RS232_ERROR in case of a
+ * serial communication error.
+ */
+static GBeeError gbeeFlushTxBuffer(GBee *self);
+
+/**
+ * Feeds the data held in the receive buffer of the GBee device into the API
+ * frame parser, until the buffer is empty or the pending gbeeReceiveFrame()
+ * call got its frame.
+ * 
+ * \param[in] self points to the GBee device.
+ */
+static void gbeeProcessRxBuffer(GBee *self);
+
+/**
+ * API frame parser callback of the GBee device. Hands the frame over to the
+ * pending gbeeReceiveFrame() call, or to the frame handler if no call is
+ * pending.
+ * 
+ * \param[in] context points to the GBee device.
+ * \param[in] error is the parser result for the frame.
+ * \param[in] frameData points to the frame data.
+ * \param[in] length is the length of the frame data.
+ * 
+ * \return false to stop parsing when a gbeeReceiveFrame() call got its frame
+ * (so the frame data is kept in the parser), true otherwise.
+ */
+static bool gbeeOnFrame(void *context, GBeeError error,
+		const GBeeFrameData *frameData, uint16_t length);
+
+/**
+ * Replaces the given value by a new value, if it still equals the old value.
+ * Uses GBEE_PORT_ATOMIC_CAS if the port provides it.
+ * 
+ * \param[in,out] value points to the value to replace.
+ * \param[in] oldValue is the value expected.
+ * \param[in] newValue is the value to store.
+ * 
+ * \return true if the value was replaced, false if it changed meanwhile.
+ */
+static bool gbeeCompareAndSwap(volatile uint32_t *value, uint32_t oldValue,
+		uint32_t newValue);
+
+/**
+ * Tells if a frame with the given API identifier answers a request with the
+ * given API identifier.
+ * 
+ * \param[in] requestIdent is the API identifier of the request.
+ * \param[in] responseIdent is the API identifier of the frame received.
+ * 
+ * \return true if the frame is a response to the request.
+ */
+static bool gbeeIsResponse(uint8_t requestIdent, uint8_t responseIdent);
+
+/**
+ * Claims a free entry of the in-flight table and fills it in, see
+ * gbeeFrameIdAlloc().
+ * 
+ * \param[in,out] self is a pointer to the GBee device structure.
+ * \param[in] requestIdent is the API identifier of the request.
+ * \param[in] timeout specifies the time in milliseconds after which the
+ * request expires, GBEE_INFINITE_WAIT if it never expires.
+ * \param[in] completion is the completion handler, NULL for synchronous
+ * requests.
+ * \param[in] context is the context pointer of the request.
+ * \param[out] frameId is the frame ID allocated.
+ * 
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_NO_FRAME_ID_ERROR to indicate that all frame IDs are in use.
+ */
+static GBeeError gbeeFrameIdClaim(GBee *self, uint8_t requestIdent,
+		uint32_t timeout, GBeeCompletionHandler completion, void *context,
+		uint8_t *frameId);
+
+/**
+ * Calls the completion handler of the asynchronous request the given frame
+ * answers, if any.
+ * 
+ * \param[in,out] self is a pointer to the GBee device structure.
+ * \param[in] frameData points to the frame received.
+ * \param[in] length is the length of the frame data in bytes.
+ * 
+ * \return true if the frame was taken by a completion handler.
+ */
+static bool gbeeComplete(GBee *self, const GBeeFrameData *frameData,
+		uint16_t length);
+
+/**
+ * Parks a frame in the receive queues, or drops and counts it if the queue of
+ * its type is full.
+ * 
+ * \param[in,out] self is a pointer to the GBee device structure.
+ * \param[in] frameData points to the frame received.
+ * \param[in] length is the length of the frame data in bytes.
+ */
+static void gbeeQueuePut(GBee *self, const GBeeFrameData *frameData,
+		uint16_t length);
+
+/**
+ * Takes the oldest frame from the receive queues.
+ * 
+ * \param[in,out] self is a pointer to the GBee device structure.
+ * \param[out] frameData is set to the frame, valid until the next receive
+ * call.
+ * \param[out] length is set to the length of the frame data in bytes.
+ * 
+ * \return true if a frame was taken, false if the queues are empty.
+ */
+static bool gbeeQueueTake(GBee *self, const GBeeFrameData **frameData,
+		uint16_t *length);
+
+/**
+ * Converts a deadline into the timeout left until then, for the port
+ * functions. The timeout is rounded up, so it never expires before the
+ * deadline.
+ * 
+ * \param[in] deadline is the point in time, GBEE_NO_DEADLINE for none.
+ * 
+ * \return The timeout in milliseconds, GBEE_NO_WAIT if the deadline has
+ * passed, GBEE_INFINITE_WAIT for GBEE_NO_DEADLINE.
+ */
+static uint32_t gbeeRemaining(GBeeTime deadline);
+
+/**
+ * Returns the deadline for a response in command mode: the response timeout
+ * from now, but not beyond the deadline of the whole exchange.
+ * 
+ * \param[in] deadline is the deadline of the whole exchange.
+ * 
+ * \return The earlier of both deadlines.
+ */
+static GBeeTime gbeeResponseDeadline(GBeeTime deadline);
+
+/**
+ * Queries the AP register with an API frame, to find out quickly whether the
+ * XBee is in API mode. The frame ID is chosen such that request and response
+ * read the same whether escaped or not, so the probe works in both API modes.
+ * 
+ * \param[in] self is a pointer to the GBee device structure.
+ * \param[out] mode is set to the API mode of the XBee.
+ * 
+ * \return GBEE_NO_ERROR if the XBee answered, GBEE_TIMEOUT_ERROR if it did
+ * not (e.g. because it is in transparent mode), or another error code.
+ */
+static GBeeError gbeeProbeApiMode(GBee *self, GBeeMode *mode);
+
+/**
+ * Tells if the API mode probe with the given frame ID would contain a byte
+ * that must be escaped in API mode 2.
+ * 
+ * \param[in] frameId is the frame ID of the probe.
+ * 
+ * \return true if the request or a response would need escaping.
+ */
+static bool gbeeProbeNeedsEscape(uint8_t frameId);
+
+/**
+ * Completion handler of the API mode probe, copies the response to the
+ * GBeeProbe given as context.
+ */
+static void gbeeOnProbeResponse(GBee *self, uint8_t frameId, GBeeError error,
+		const GBeeFrameData *response, uint16_t length, void *context);
+
+/**
+ * Switches the serial interface to the given baud rate. Bytes received so far
+ * are discarded, as they may be garbled by the change.
+ * 
+ * \param[in] self is a pointer to the GBee device structure.
+ * \param[in] baudRate is the new baud rate.
+ * 
+ * \return GBEE_NO_ERROR if successful, GBEE_RS232_ERROR if the port cannot
+ * change the baud rate.
+ */
+static GBeeError gbeeSetBaudRate(GBee *self, uint32_t baudRate);
+
+/**
+ * Looks up the register cache entry of the given register.
+ * 
+ * \param[in] self is a pointer to the GBee device structure.
+ * \param[in] regName is the name of the register (two characters).
+ * 
+ * \return The cache entry, or NULL if the register is not cached.
+ */
+static GBeeRegisterCacheEntry *gbeeRegisterCacheFind(GBee *self,
+		const uint8_t *regName);
+
+/**
+ * Starts writing a register cache entry: waits until no other thread writes
+ * it and makes its sequence number odd.
+ * 
+ * \param[in,out] entry is the cache entry to write.
+ * 
+ * \return The odd sequence number, to be passed to gbeeRegisterCacheUnlock().
+ */
+static uint32_t gbeeRegisterCacheLock(GBeeRegisterCacheEntry *entry);
+
+/**
+ * Finishes writing a register cache entry: makes its sequence number even
+ * again, publishing the new contents to readers.
+ * 
+ * \param[in,out] entry is the cache entry written.
+ * \param[in] sequence is the value returned by gbeeRegisterCacheLock().
+ */
+static void gbeeRegisterCacheUnlock(GBeeRegisterCacheEntry *entry,
+		uint32_t sequence);
+
+/**
+ * Updates the register cache with an AT command about to be sent: a command
+ * setting a register invalidates its value, "RE" (restore defaults)
+ * invalidates all values. A queued value keeps the register out of the cache
+ * until an AT command frame (e.g. "AC") applies the queued values.
+ * 
+ * \param[in] self is a pointer to the GBee device structure.
+ * \param[in] atCmd is the AT command.
+ * \param[in] length is the length of the AT command value.
+ * \param[in] queued tells if the value is queued (AT command frame 0x09).
+ */
+static void gbeeRegisterCacheOnCommand(GBee *self, const uint8_t *atCmd,
+		uint16_t length, bool queued);
+
+/**
+ * Updates the register cache with a received frame: AT command responses
+ * carrying a register value fill the cache, responses to setting a register
+ * invalidate its value (again, in case the answer to an earlier query
+ * re-cached the old one), modem status frames reporting a reset invalidate
+ * all values.
+ * 
+ * \param[in] self is a pointer to the GBee device structure.
+ * \param[in] frameData points to the frame data.
+ * \param[in] length is the length of the frame data.
+ */
+static void gbeeRegisterCacheOnFrame(GBee *self,
+		const GBeeFrameData *frameData, uint16_t length);
+
+/**
+ * Checks whether a response in command mode is "OK\r".
+ * 
+ * \param[in] response is the response received.
+ * \param[in] length is the length of the response.
+ * 
+ * \return true if the response ends with "OK\r", false otherwise.
+ */
+static bool gbeeIsOkResponse(const uint8_t *response, uint16_t length);
 
 /**
  * GBee wait routine - delays for the requested number of milliseconds.
+ * Sleeps if the port provides GBEE_PORT_SLEEP, polls the clock otherwise.
  * 
  * \param[in] self is a pointer to the GBee device structure.
  * \param[in] milliseconds specifies the number of milliseconds to delay.
@@ -90,8 +539,17 @@ static void gbeeWait(GBee *self, uint32_t milliseconds);
 /******************************************************************************/
 
 GBee *gbeeCreate(const char *serialName)
+{
+	return gbeeCreateEx(serialName, GBEE_BAUD_RATE_DEFAULT);
+}
+
+/******************************************************************************/
+
+GBee *gbeeCreateEx(const char *serialName, uint32_t baudRate)
 {
 	int deviceIndex;
+	// Index of the current table entry.
+	uint16_t index;
 
 	// Connect to the selected serial interface.
 	if  ((deviceIndex = GBEE_PORT_UART_CONNECT(serialName)) < 0)
@@ -109,8 +567,58 @@ GBee *gbeeCreate(const char *serialName)
 	}
 
 	// Initialize self.
-	self->serialDevice = deviceIndex;
-	self->lastError    = GBEE_NO_ERROR;
+	self->serialDevice     = deviceIndex;
+	self->lastError        = GBEE_NO_ERROR;
+	self->rx.head          = 0;
+	self->rx.tail          = 0;
+	self->rx.pending       = false;
+	self->rx.frameData     = NULL;
+	self->rx.frameDone     = false;
+	self->rx.handler       = NULL;
+	self->tx.head          = 0;
+	self->tx.tail          = 0;
+	self->nonBlocking      = false;
+	self->escaped          = false;
+	self->maxPayloadLength = GBEE_MAX_PAYLOAD_LENGTH;
+	self->baudRate         = GBEE_BAUD_RATE_DEFAULT;
+	gbeeParserInit(&self->rx.parser, gbeeOnFrame, self);
+	self->rx.parking       = false;
+	self->rx.queueHead     = 0;
+	self->rx.queueCount    = 0;
+	for (index = 0; index < 256; index++)
+	{
+		self->rx.dispatch[index].handler = NULL;
+		self->rx.dispatch[index].context = NULL;
+		self->rx.queued[index]           = 0;
+		self->rx.queueDepth[index]       = GBEE_RX_QUEUE_DEPTH;
+		self->rx.queueOverflow[index]    = 0;
+	}
+	for (index = 0; index < GBEE_MAX_FRAME_IDS; index++)
+	{
+		self->frameIds.entries[index].inUse      = GBEE_FRAME_ID_FREE;
+		self->frameIds.entries[index].completion = NULL;
+	}
+	self->frameIds.nextFrameId = 1;
+	for (index = 0; index < GBEE_REGISTER_CACHE_SIZE; index++)
+	{
+		self->registers[index].sequence = 0;
+		self->registers[index].pending  = false;
+	}
+	gbeeRegisterCacheInvalidate(self);
+
+	// Switch to the requested baud rate; an XBee not answering in API mode
+	// keeps the default one.
+	if (baudRate == GBEE_BAUD_RATE_AUTO)
+	{
+		gbeeDetectBaudRate(self, &baudRate);
+	}
+	else if ((baudRate != GBEE_BAUD_RATE_DEFAULT)
+			&& (gbeeSetBaudRate(self, baudRate) != GBEE_NO_ERROR))
+	{
+		GBEE_DEBUG_LOG("%s: Error setting baud rate \r\n", __func__);
+		gbeeDestroy(self);
+		return NULL;
+	}
 	
 	return self;
 }
@@ -128,6 +636,7 @@ void gbeeDestroy(GBee *self)
 GBeeError gbeeSetMode(GBee *self, GBeeMode mode)
 {
 	char      asciiMode;
+	uint8_t   apValue;
 	GBeeError error = GBEE_NO_ERROR;
 	
 	// Check pre-conditions.
@@ -138,9 +647,14 @@ GBeeError gbeeSetMode(GBee *self, GBeeMode mode)
 	
 	GBEE_THROW(error);
 	
-	// Set AP to 0/1 depending on desired mode.
+	// Set AP to 0/1/2 depending on desired mode.
 	asciiMode = '0' + mode;
 	error     = gbeeXferAtCommand(self, "AP", &asciiMode, 1, NULL, NULL);
+	GBEE_THROW(error);
+	apValue   = mode;
+	gbeeRegisterCachePut(self, "AP", &apValue, 1);
+
+	gbeeSetEscaped(self, mode == GBEE_MODE_API_ESCAPED);
 	return error;
 }
 
@@ -150,6 +664,7 @@ GBeeError gbeeGetMode(GBee *self, GBeeMode *mode)
 {
 	char     buffer[GBEE_MAX_FRAME_SIZE];
 	uint16_t bufferSize;
+	uint8_t  apValue;
 	int      error = GBEE_NO_ERROR;
 	
 	// Check pre-conditions.
@@ -159,6 +674,25 @@ GBeeError gbeeGetMode(GBee *self, GBeeMode *mode)
 	}
 	GBEE_THROW(error);
 
+	// Serve the mode from the register cache if possible.
+	if (gbeeRegisterCacheGet(self, "AP", &apValue, &bufferSize, 1)
+			&& (apValue <= GBEE_MODE_API_ESCAPED))
+	{
+		*mode = apValue;
+		gbeeSetEscaped(self, *mode == GBEE_MODE_API_ESCAPED);
+		return GBEE_NO_ERROR;
+	}
+
+	// The XBee is usually in API mode already: ask it with an API frame
+	// first, command mode takes more than a second.
+	if (gbeeProbeApiMode(self, mode) == GBEE_NO_ERROR)
+	{
+		gbeeSetEscaped(self, *mode == GBEE_MODE_API_ESCAPED);
+		apValue = *mode;
+		gbeeRegisterCachePut(self, "AP", &apValue, 1);
+		return GBEE_NO_ERROR;
+	}
+
 	// Get AP parameter.
 	error = gbeeXferAtCommand(self, "AP", NULL, 0, buffer, &bufferSize);
 	GBEE_THROW(error);
@@ -170,7 +704,11 @@ GBeeError gbeeGetMode(GBee *self, GBeeMode *mode)
 			// The GBee sends its mode as ASCII!
 			case '0' + GBEE_MODE_TRANSPARENT:
 			case '0' + GBEE_MODE_API:
+			case '0' + GBEE_MODE_API_ESCAPED:
 				*mode = buffer[0] - '0';
+				gbeeSetEscaped(self, *mode == GBEE_MODE_API_ESCAPED);
+				apValue = *mode;
+				gbeeRegisterCachePut(self, "AP", &apValue, 1);
 				break;
 			default:
 				error = GBEE_MODE_ERROR;
@@ -185,180 +723,371 @@ GBeeError gbeeGetMode(GBee *self, GBeeMode *mode)
 
 /******************************************************************************/
 
-GBeeError gbeeReceive(GBee *self, GBeeFrameData *frameData, uint16_t *length, 
-		uint32_t *timeout)
+uint32_t gbeeGetBaudRate(const GBee *self)
 {
-	// Header of frame.
-	GBeeFrameHeader frameHeader;
-	// Trailer of frame.
-	GBeeFrameTrailer frameTrailer;
-	// Pointer to current byte being processed.
-	uint8_t *bytePtr;
-	// Size of received frame.
-	uint8_t frameSize;
-	// Elapsed time for reception.
-	uint8_t elapsedTime;
+	return self->baudRate;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeDetectBaudRate(GBee *self, uint32_t *baudRate)
+{
+	// Baud rate of the serial interface before the detection.
+	uint32_t oldBaudRate = self->baudRate;
+	// Baud rate to try next.
+	uint32_t candidate = oldBaudRate;
+	// Index of the next baud rate to try.
+	int16_t index = GBEE_BAUD_RATE_COUNT - 1;
+	// Mode of the XBee.
+	GBeeMode mode;
+	uint8_t  apValue;
 	// GBee error code.
 	GBeeError error = GBEE_NO_ERROR;
-	// GBee read error code.
-	GBeeError readError;
-	
-	// Check some pre-conditions.
+
+	// Check pre-conditions.
 	if (self->lastError != GBEE_NO_ERROR)
 	{
 		error = GBEE_INHERITED_ERROR;
 	}
-	GBEE_THROW(error);	
+	GBEE_THROW(error);
 
-	// Prepare.
-	*length                    = 0;
-	frameSize                  = 0;
-	frameHeader.startDelimiter = 0;
-	frameHeader.length         = 0;
-	elapsedTime                = 0;
-	bytePtr                    = (uint8_t*)&frameHeader;
-	
-	GBEE_DEBUG_LOG("%s: ", __func__);
-	
-	// Loop to read the frame byte-wise.
-	while (error == GBEE_NO_ERROR)
+	// Try the current baud rate first, then the others from the fastest one.
+	while (1)
 	{
-		if ((*timeout != GBEE_NO_WAIT) && (*timeout != GBEE_INFINITE_WAIT))
+		error = gbeeSetBaudRate(self, candidate);
+		GBEE_THROW(error);
+
+		error = gbeeProbeApiMode(self, &mode);
+		if (error == GBEE_NO_ERROR)
 		{
-			// Check if timeout expired.
-			if (elapsedTime >= (*timeout))
-			{
-				error = GBEE_TIMEOUT_ERROR;
-				break;
-			}
-			(*timeout) -= elapsedTime;
+			gbeeSetEscaped(self, mode == GBEE_MODE_API_ESCAPED);
+			apValue = mode;
+			gbeeRegisterCachePut(self, "AP", &apValue, 1);
+			*baudRate = candidate;
+			return GBEE_NO_ERROR;
+		}
+		if ((error != GBEE_TIMEOUT_ERROR) && (error != GBEE_MODE_ERROR))
+		{
+			return error;
 		}
 
-		// Get timestamp.
-		elapsedTime = GBEE_PORT_TIME_GET();
-		// Read a byte from the serial interface.
-		readError = GBEE_PORT_UART_RECEIVE_BYTE(self->serialDevice, bytePtr, *timeout);
-		// Calculate elapsed time.
-		elapsedTime = GBEE_PORT_TIME_GET() - elapsedTime;
-
-		GBEE_DEBUG_LOG("%02x ", *bytePtr);
-
-		// Check for errors.
-		if (readError != GBEE_NO_ERROR)
+		while ((index >= 0) && (gbeeBaudRates[index] == oldBaudRate))
 		{
-			error = GBEE_FRAME_INTEGRITY_ERROR;
-			break;
+			index--;
 		}
-		
-		// First byte must be the start delimiter.
-		if ((frameSize > 0) || (frameHeader.startDelimiter == 0x7E))
+		if (index < 0)
 		{
-			// Got a byte, so increment the frame size.
-			frameSize++;
-
-			// Got the header? Read the data.
-			if (frameSize == sizeof(GBeeFrameHeader))
-			{
-				if (GBEE_USHORT(frameHeader.length) > GBEE_MAX_FRAME_SIZE)
-				{
-					error = GBEE_FRAME_SIZE_ERROR;
-					break;
-				}
-				bytePtr = (uint8_t *)frameData;
-			}
-			// Got the data? Read the trailer.
-			else if (frameSize == (sizeof(GBeeFrameHeader) + GBEE_USHORT(frameHeader.length)))
-			{
-				bytePtr = (uint8_t *)&frameTrailer;
-			}
-			// Got the trailer? Verify checksum.
-			else if (frameSize == (sizeof(GBeeFrameHeader) + sizeof(GBeeFrameTrailer) + GBEE_USHORT(frameHeader.length)))
-			{
-				// Verify checksum.
-				if (gbeeVerifyChecksum((uint8_t *)frameData, GBEE_USHORT(frameHeader.length),
-						frameTrailer.checksum) != GBEE_NO_ERROR)
-				{
-					error = GBEE_CHECKSUM_ERROR;
-					break;
-				}
-				else
-				{
-					*length = GBEE_USHORT(frameHeader.length);
-					error  = GBEE_NO_ERROR;
-					break;
-				}
-			}
-			// Keep reading.
-			else
-			{
-				bytePtr++;
-			}
+			break;
 		}
+		candidate = gbeeBaudRates[index--];
 	}
 
-	GBEE_DEBUG_LOG("\r\n");
-	return error;
+	// No XBee answered, go back to where we started.
+	error = gbeeSetBaudRate(self, oldBaudRate);
+	GBEE_THROW(error);
+	return GBEE_MODE_ERROR;
 }
 
 /******************************************************************************/
 
-GBeeError gbeeSend(GBee *self, GBeeFrameData *frameData, uint16_t length)
+GBeeError gbeeNegotiateBaud(GBee *self, uint32_t baudRate)
 {
-	// Pointer to header of frame to send.
-	GBeeFrameHeader *frameHeader = (GBeeFrameHeader *)&self->scratch[0];
-	// Pointer to trailer of frame to send.
-	GBeeFrameTrailer *frameTrailer = (GBeeFrameTrailer *)&self->scratch[sizeof(GBeeFrameHeader)+length];
+#ifdef GBEE_PORT_UART_SET_BAUD_RATE
+	// Value of the BD register.
+	uint8_t bdValue;
+	// Outcome of the AT command.
+	GBeeProbe probe;
+	// Frame ID of the AT command.
+	uint8_t frameId;
+	// Deadline of the AT command.
+	GBeeTime deadline = gbeeDeadlineAfter(GBEE_AT_RESPONSE_TIMEOUT);
+	// Mode of the XBee.
+	GBeeMode mode;
 	// GBee error code.
 	GBeeError error = GBEE_NO_ERROR;
-	// Total frame size.
-	uint16_t totalLength;
-	
-	// Check some pre-conditions.
+
+	// Check pre-conditions.
 	if (self->lastError != GBEE_NO_ERROR)
 	{
 		error = GBEE_INHERITED_ERROR;
 	}
-	else if (length > GBEE_MAX_FRAME_SIZE)
+	GBEE_THROW(error);
+
+	// Look up the BD value of the baud rate.
+	for (bdValue = 0; bdValue < GBEE_BAUD_RATE_COUNT; bdValue++)
 	{
-		error = GBEE_FRAME_SIZE_ERROR;
+		if (gbeeBaudRates[bdValue] == baudRate)
+		{
+			break;
+		}
 	}
-	GBEE_THROW(error);	
-	
-	// Create frame to send to the XBee.
-	frameHeader->startDelimiter = 0x7E;
-	frameHeader->length = GBEE_USHORT(length);
-	GBEE_PORT_MEMORY_COPY(&self->scratch[sizeof(GBeeFrameHeader)], frameData, length);
-	frameTrailer->checksum = gbeeCalculateChecksum((uint8_t *)frameData, length);
-	totalLength = length + sizeof(GBeeFrameHeader) + sizeof(GBeeFrameTrailer);
-		
-	// Print the GBee message to send if debug logging is enabled.
-#ifdef GBEE_PORT_DEBUG_LOG
+	if (bdValue == GBEE_BAUD_RATE_COUNT)
+	{
+		return GBEE_RS232_ERROR;
+	}
+	if (baudRate == self->baudRate)
+	{
+		return GBEE_NO_ERROR;
+	}
+
+	// Set BD, the XBee answers at the old baud rate.
+	probe.done  = false;
+	probe.error = GBEE_NO_ERROR;
+	error = gbeeSendAtCommandAsync(self, (uint8_t *)"BD", &bdValue, 1,
+			GBEE_AT_RESPONSE_TIMEOUT, gbeeOnProbeResponse, &probe, &frameId);
+	GBEE_THROW(error);
+	while (!probe.done)
 	{
-		uint16_t byteNr;
-		printf("%s: ", __func__);
-		for (byteNr = 0; byteNr < totalLength; byteNr++)
+		error = gbeeWaitUntilDeadline(self, &probe.done, deadline);
+		if ((error != GBEE_NO_ERROR) && (error != GBEE_TIMEOUT_ERROR))
+		{
+			// Cancel the request, the response would outlive us.
+			gbeeFrameIdRelease(self, frameId);
+			return error;
+		}
+		if (!probe.done && (gbeeClockGet() >= deadline))
 		{
-			printf("%02x ", byteNr);
+			// No answer in time, BD is left as it is.
+			gbeeFrameIdRelease(self, frameId);
+			return GBEE_TIMEOUT_ERROR;
 		}
-		printf("\r\n");
 	}
-#endif // GBEE_PORT_DEBUG_LOG
-	
-	// Send the frame via the serial interface.
-	error = GBEE_PORT_UART_SEND_BUFFER(self->serialDevice, self->scratch, totalLength);
+	GBEE_THROW(probe.error);
+	if (probe.status != GBEE_AT_COMMAND_STATUS_OK)
+	{
+		return GBEE_RESPONSE_ERROR;
+	}
+
+	// Follow the XBee and check that it answers at the new baud rate.
+	error = gbeeSetBaudRate(self, baudRate);
+	GBEE_THROW(error);
+	error = gbeeProbeApiMode(self, &mode);
+	if (error == GBEE_TIMEOUT_ERROR)
+	{
+		// Find the XBee again, wherever it ended up.
+		error = gbeeDetectBaudRate(self, &baudRate);
+		GBEE_THROW(error);
+		return GBEE_RESPONSE_ERROR;
+	}
+	GBEE_THROW(error);
+	gbeeRegisterCachePut(self, "BD", &bdValue, 1);
+	return GBEE_NO_ERROR;
+#else
+	// The port cannot follow the XBee to another baud rate.
+	(void)self;
+	(void)baudRate;
+	return GBEE_RS232_ERROR;
+#endif
+}
+
+/******************************************************************************/
+
+void gbeeParserInit(GBeeParser *self, GBeeParserCallback callback, void *context)
+{
+	self->callback    = callback;
+	self->context     = context;
+	self->resyncCount = 0;
+	self->escaped     = false;
+	gbeeParserReset(self);
+}
+
+/******************************************************************************/
+
+void gbeeParserReset(GBeeParser *self)
+{
+	self->state         = GBEE_PARSER_STATE_START;
+	self->length        = 0;
+	self->count         = 0;
+	self->replayLength  = 0;
+	self->replayOffset  = 0;
+	self->escapePending = false;
+}
+
+/******************************************************************************/
+
+void gbeeParserResync(GBeeParser *self)
+{
+	// Bytes to parse again.
+	uint8_t buffer[GBEE_PARSER_BUFFER_SIZE];
+	// Number of bytes to parse again.
+	uint16_t length;
+	// Number of bytes to take from the replay buffer.
+	uint16_t replayLength;
+	// Index of the next start delimiter in the frame.
+	uint16_t index;
+
+	// Escaped frames never contain a start delimiter.
+	self->escapePending = false;
+	if (self->escaped)
+	{
+		self->state = GBEE_PARSER_STATE_START;
+		self->count = 0;
+		return;
+	}
+
+	// Look for another start delimiter in the frame.
+	index = gbeeKernelFindDelimiter(self->frame, self->count);
+	if (index >= self->count)
+	{
+		self->state = GBEE_PARSER_STATE_START;
+		self->count = 0;
+		return;
+	}
+
+	// Parse the bytes after it again, followed by the bytes still to be
+	// replayed (if the corrupt frame was parsed from the replay buffer).
+	length       = self->count - index - 1;
+	replayLength = self->replayLength - self->replayOffset;
+	if (replayLength > (GBEE_PARSER_BUFFER_SIZE - length))
+	{
+		replayLength = GBEE_PARSER_BUFFER_SIZE - length;
+	}
+	GBEE_PORT_MEMORY_COPY(buffer, &self->frame[index+1], length);
+	GBEE_PORT_MEMORY_COPY(&buffer[length], &self->replay[self->replayOffset],
+			replayLength);
+	GBEE_PORT_MEMORY_COPY(self->replay, buffer, length + replayLength);
+	self->replayLength = length + replayLength;
+	self->replayOffset = 0;
+
+	self->state = GBEE_PARSER_STATE_LENGTH_MSB;
+	self->count = 0;
+	self->resyncCount++;
+}
+
+/******************************************************************************/
+
+uint32_t gbeeParserFeed(GBeeParser *self, const uint8_t *bytes, uint32_t length)
+{
+	// Number of bytes consumed from the given data.
+	uint32_t consumed = 0;
+	// Tells if parsing shall go on.
+	bool proceed = true;
+	// Tells if a corrupt frame was found.
+	bool corrupt;
+
+	while (proceed)
+	{
+		corrupt = false;
+		if (self->replayOffset < self->replayLength)
+		{
+			// Parse bytes of a corrupt frame again first.
+			self->replayOffset += gbeeParserParse(self,
+					&self->replay[self->replayOffset],
+					self->replayLength - self->replayOffset, &proceed, &corrupt);
+		}
+		else if (consumed < length)
+		{
+			consumed += gbeeParserParse(self, bytes + consumed, length - consumed,
+					&proceed, &corrupt);
+		}
+		else
+		{
+			break;
+		}
+
+		if (corrupt)
+		{
+			gbeeParserResync(self);
+		}
+	}
+
+	return consumed;
+}
+
+/******************************************************************************/
+
+bool gbeeParserIdle(const GBeeParser *self)
+{
+	return (self->state == GBEE_PARSER_STATE_START)
+			&& (self->replayOffset >= self->replayLength);
+}
+
+/******************************************************************************/
+
+void gbeeParserSetEscaped(GBeeParser *self, bool enable)
+{
+	self->escaped       = enable;
+	self->escapePending = false;
+}
+
+/******************************************************************************/
+
+GBeeTime gbeeClockGet(void)
+{
+#ifdef GBEE_PORT_CLOCK_GET
+	return GBEE_PORT_CLOCK_GET();
+#else
+	return (GBeeTime)GBEE_PORT_TIME_GET() * 1000000;
+#endif
+}
+
+/******************************************************************************/
+
+GBeeTime gbeeDeadlineAfter(uint32_t timeout)
+{
+	if (timeout == GBEE_INFINITE_WAIT)
+	{
+		return GBEE_NO_DEADLINE;
+	}
+	return gbeeClockGet() + (GBeeTime)timeout * 1000000;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeReceive(GBee *self, GBeeFrameData *frameData, uint16_t *length, 
+		uint32_t *timeout)
+{
+	// Deadline of the call.
+	GBeeTime deadline = gbeeDeadlineAfter(*timeout);
+	// GBee error code.
+	GBeeError error;
+
+	error = gbeeReceiveDeadline(self, frameData, length, deadline);
+	*timeout = gbeeRemaining(deadline);
 	return error;
 }
 
 /******************************************************************************/
 
-GBeeError gbeeSendAtCommand(GBee *self, uint8_t frameId, uint8_t *atCmd, 
-		uint8_t *value, uint16_t length)
+GBeeError gbeeReceiveDeadline(GBee *self, GBeeFrameData *frameData,
+		uint16_t *length, GBeeTime deadline)
 {
+	// Frame data held by the parser.
+	const GBeeFrameData *frame;
 	// GBee error code.
-	GBeeError error = GBEE_NO_ERROR;
-	// AT command to send to GBee.
-	GBeeAtCommand atCommand;
+	GBeeError error;
 
+	error = gbeeReceiveFrameDeadline(self, &frame, length, deadline);
+	GBEE_THROW(error);
+	GBEE_PORT_MEMORY_COPY(frameData, frame, *length);
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeReceiveFrame(GBee *self, const GBeeFrameData **frameData,
+		uint16_t *length, uint32_t *timeout)
+{
+	// Deadline of the call.
+	GBeeTime deadline = gbeeDeadlineAfter(*timeout);
+	// GBee error code.
+	GBeeError error;
+
+	error = gbeeReceiveFrameDeadline(self, frameData, length, deadline);
+	*timeout = gbeeRemaining(deadline);
+	return error;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeReceiveFrameDeadline(GBee *self, const GBeeFrameData **frameData,
+		uint16_t *length, GBeeTime deadline)
+{
+	// GBee error code.
+	GBeeError error = GBEE_NO_ERROR;
+	// GBee read error code.
+	GBeeError readError;
+	
 	// Check some pre-conditions.
 	if (self->lastError != GBEE_NO_ERROR)
 	{
@@ -366,403 +1095,2314 @@ GBeeError gbeeSendAtCommand(GBee *self, uint8_t frameId, uint8_t *atCmd,
 	}
 	GBEE_THROW(error);	
 
-	// Assemble the AT command frame.
-	atCommand.ident        = GBEE_AT_COMMAND;
-	atCommand.frameId      = frameId;
-	atCommand.atCommand[0] = atCmd[0];
-	atCommand.atCommand[1] = atCmd[1];
-	GBEE_PORT_MEMORY_COPY(atCommand.value, value, length);
+	// Frames parked by gbeeWaitUntil() come first.
+	if (gbeeQueueTake(self, frameData, length))
+	{
+		return GBEE_NO_ERROR;
+	}
+
+	// Prepare.
+	*length             = 0;
+	self->rx.pending     = true;
+	self->rx.frameData   = NULL;
+	self->rx.frameLength = 0;
+	self->rx.frameError  = GBEE_NO_ERROR;
+	self->rx.frameDone   = false;
+	
+	while (1)
+	{
+		// Parse the data already buffered.
+		gbeeProcessRxBuffer(self);
+		gbeeProcessTimeouts(self);
+		if (self->rx.frameDone)
+		{
+			error = self->rx.frameError;
+			if (error == GBEE_NO_ERROR)
+			{
+				*frameData = self->rx.frameData;
+				*length    = self->rx.frameLength;
+			}
+			break;
+		}
+
+		// Need more data: read from the serial interface.
+		readError = gbeeFillRxBuffer(self, deadline);
+
+		// Check for errors.
+		if (readError == GBEE_TIMEOUT_ERROR)
+		{
+			gbeeProcessTimeouts(self);
+			error = GBEE_TIMEOUT_ERROR;
+			break;
+		}
+		else if (readError != GBEE_NO_ERROR)
+		{
+			gbeeParserResync(&self->rx.parser);
+			error = GBEE_FRAME_INTEGRITY_ERROR;
+			break;
+		}
+	}
 
-	// Send the AT command frame.
-	error = gbeeSend(self, (GBeeFrameData *)&atCommand, length + GBEE_AT_COMMAND_HEADER_LENGTH);
+	self->rx.pending   = false;
+	self->rx.frameDone = false;
 	return error;
 }
 
 /******************************************************************************/
 
-GBeeError gbeeSendAtCommandQueue(GBee *self, uint8_t frameId, uint8_t *atCmd, 
-		uint8_t *value, uint16_t length)
+int gbeeGetFd(GBee *self)
+{
+	return self->serialDevice;
+}
+
+/******************************************************************************/
+
+void gbeeSetFrameHandler(GBee *self, GBeeFrameHandler handler, void *context)
+{
+	self->rx.handler        = handler;
+	self->rx.handlerContext = context;
+}
+
+/******************************************************************************/
+
+void gbeeRegisterHandler(GBee *self, uint8_t ident, GBeeFrameHandler handler,
+		void *context)
+{
+	self->rx.dispatch[ident].handler = handler;
+	self->rx.dispatch[ident].context = context;
+}
+
+/******************************************************************************/
+
+void gbeeSetNonBlocking(GBee *self, bool enable)
+{
+	self->nonBlocking = enable;
+}
+
+/******************************************************************************/
+
+void gbeeSetEscaped(GBee *self, bool enable)
+{
+	self->escaped = enable;
+	gbeeParserSetEscaped(&self->rx.parser, enable);
+}
+
+/******************************************************************************/
+
+GBeeError gbeeProcessReadable(GBee *self)
 {
 	// GBee error code.
 	GBeeError error = GBEE_NO_ERROR;
-	// AT command to send to GBee.
-	GBeeAtCommandQueue atCommandQueue;
+	// Frame parked by gbeeWaitUntil().
+	const GBeeFrameData *frameData;
+	// Length of the parked frame.
+	uint16_t length;
 
 	// Check some pre-conditions.
 	if (self->lastError != GBEE_NO_ERROR)
 	{
 		error = GBEE_INHERITED_ERROR;
 	}
-	GBEE_THROW(error);	
+	GBEE_THROW(error);
 
-	// Assemble the AT command frame.
-	atCommandQueue.ident        = GBEE_AT_COMMAND_QUEUE;
-	atCommandQueue.frameId      = frameId;
-	atCommandQueue.atCommand[0] = atCmd[0];
-	atCommandQueue.atCommand[1] = atCmd[1];
-	GBEE_PORT_MEMORY_COPY(atCommandQueue.value, value, length);
+	// Pass the frames parked by gbeeWaitUntil() first.
+	while (gbeeQueueTake(self, &frameData, &length))
+	{
+		if (self->rx.handler != NULL)
+		{
+			self->rx.handler(self, frameData, length, self->rx.handlerContext);
+		}
+	}
 
-	// Send the AT command frame.
-	error = gbeeSend(self, (GBeeFrameData *)&atCommandQueue, length + GBEE_AT_COMMAND_QUEUE_HEADER_LENGTH);
-	return error;
+	// Drain the serial interface, so edge-triggered event loops work as well.
+	while (1)
+	{
+		gbeeProcessRxBuffer(self);
+		error = gbeeFillRxBuffer(self, 0); // Deadline passed: do not wait.
+		if (error == GBEE_TIMEOUT_ERROR)
+		{
+			// No more data.
+			gbeeProcessTimeouts(self);
+			return GBEE_NO_ERROR;
+		}
+		else if (error != GBEE_NO_ERROR)
+		{
+			gbeeParserResync(&self->rx.parser);
+			return error;
+		}
+	}
 }
 
 /******************************************************************************/
 
-GBeeError gbeeSendRemoteAtCommand(GBee *self, uint8_t frameId, uint32_t dstAddr64h,
-		uint32_t dstAddr64l, uint16_t dstAddr16, uint8_t *atCmd, uint8_t cmdOpts,
-		uint8_t *value, uint16_t length)
+GBeeError gbeeProcessWritable(GBee *self)
 {
-	// Error code returned by GBee.
-	GBeeError error = GBEE_NO_ERROR;
-	// Remote AT command parameters.
-	GBeeRemoteAtCommand remoteAtCommand;
-
 	// Check some pre-conditions.
 	if (self->lastError != GBEE_NO_ERROR)
 	{
-		error = GBEE_INHERITED_ERROR;
+		return GBEE_INHERITED_ERROR;
 	}
-	GBEE_THROW(error);	
+	return gbeeFlushTxBuffer(self);
+}
 
-	// Assemble the AT command frame.
-	remoteAtCommand.ident        = GBEE_REMOTE_AT_COMMAND;
-	remoteAtCommand.frameId      = frameId;
-	remoteAtCommand.dstAddr64h   = GBEE_ULONG(dstAddr64h);
-	remoteAtCommand.dstAddr64l   = GBEE_ULONG(dstAddr64l);
-	remoteAtCommand.dstAddr16    = GBEE_USHORT(dstAddr16);
-	remoteAtCommand.atCommand[0] = atCmd[0];
-	remoteAtCommand.atCommand[1] = atCmd[1];
-	remoteAtCommand.cmdOpts      = cmdOpts;
-	GBEE_PORT_MEMORY_COPY(remoteAtCommand.value, value, length);
+/******************************************************************************/
 
-	// Send the AT command frame.
-	error = gbeeSend(self, (GBeeFrameData *)&remoteAtCommand,
-			length + GBEE_REMOTE_AT_COMMAND_HEADER_LENGTH);
-	return error;
+bool gbeeWritePending(const GBee *self)
+{
+	return self->tx.head != self->tx.tail;
+}
+
+/******************************************************************************/
+
+uint32_t gbeeGetResyncCount(const GBee *self)
+{
+	return self->rx.parser.resyncCount;
+}
+
+/******************************************************************************/
+
+void gbeeSetMaxPayloadLength(GBee *self, uint16_t length)
+{
+	if (length > GBEE_MAX_PAYLOAD_LENGTH)
+	{
+		length = GBEE_MAX_PAYLOAD_LENGTH;
+	}
+	self->maxPayloadLength = length;
+}
+
+/******************************************************************************/
+
+uint16_t gbeeGetMaxPayloadLength(const GBee *self)
+{
+	return self->maxPayloadLength;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeFrameIdAlloc(GBee *self, uint8_t requestIdent, uint32_t timeout,
+		void *context, uint8_t *frameId)
+{
+	return gbeeFrameIdClaim(self, requestIdent, timeout, NULL, context, frameId);
+}
+
+/******************************************************************************/
+
+void gbeeFrameIdRelease(GBee *self, uint8_t frameId)
+{
+	if (GBEE_FRAME_ID_VALID(frameId))
+	{
+		gbeeCompareAndSwap(&self->frameIds.entries[frameId - 1].inUse,
+				GBEE_FRAME_ID_IN_FLIGHT, GBEE_FRAME_ID_FREE);
+	}
+}
+
+/******************************************************************************/
+
+bool gbeeFrameIdMatch(GBee *self, const GBeeFrameData *frameData,
+		uint16_t length, void **context)
+{
+	// Frame ID of the frame received.
+	uint8_t frameId;
+	// Entry of the frame ID.
+	GBeeFrameIdEntry *entry;
+
+	// All responses carry the frame ID right after the API identifier.
+	if (length < 2)
+	{
+		return false;
+	}
+	frameId = frameData->atCommandResponse.frameId;
+	if (!GBEE_FRAME_ID_VALID(frameId))
+	{
+		return false;
+	}
+
+	entry = &self->frameIds.entries[frameId - 1];
+	if ((entry->inUse != GBEE_FRAME_ID_IN_FLIGHT) || (entry->completion != NULL)
+			|| !gbeeIsResponse(entry->requestIdent, frameData->ident))
+	{
+		return false;
+	}
+	if (context != NULL)
+	{
+		*context = entry->context;
+	}
+	return gbeeCompareAndSwap(&entry->inUse, GBEE_FRAME_ID_IN_FLIGHT,
+			GBEE_FRAME_ID_FREE);
+}
+
+/******************************************************************************/
+
+bool gbeeFrameIdExpire(GBee *self, uint8_t *frameId, void **context)
+{
+	// Current time.
+	GBeeTime now = gbeeClockGet();
+	// Index of the current entry.
+	uint16_t index;
+	// Current entry.
+	GBeeFrameIdEntry *entry;
+
+	for (index = 0; index < GBEE_MAX_FRAME_IDS; index++)
+	{
+		entry = &self->frameIds.entries[index];
+		if ((entry->inUse == GBEE_FRAME_ID_IN_FLIGHT)
+				&& (entry->completion == NULL) && (now >= entry->deadline))
+		{
+			if (context != NULL)
+			{
+				*context = entry->context;
+			}
+			if (gbeeCompareAndSwap(&entry->inUse, GBEE_FRAME_ID_IN_FLIGHT,
+					GBEE_FRAME_ID_FREE))
+			{
+				*frameId = index + 1;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/******************************************************************************/
+
+uint16_t gbeeFrameIdGetInFlight(const GBee *self)
+{
+	// Number of frame IDs in use.
+	uint16_t count = 0;
+	// Index of the current entry.
+	uint16_t index;
+
+	for (index = 0; index < GBEE_MAX_FRAME_IDS; index++)
+	{
+		if (self->frameIds.entries[index].inUse != GBEE_FRAME_ID_FREE)
+		{
+			count++;
+		}
+	}
+	return count;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeSendTxRequestAsync(GBee *self, GBeeFrameData *frameData,
+		uint16_t length, uint32_t timeout, GBeeCompletionHandler handler,
+		void *context, uint8_t *frameId)
+{
+	// Frame ID of the request.
+	uint8_t id;
+	// GBee error code.
+	GBeeError error = GBEE_NO_ERROR;
+
+	// Check some pre-conditions.
+	if ((length < 2) || (length > GBEE_MAX_FRAME_SIZE))
+	{
+		error = GBEE_FRAME_SIZE_ERROR;
+	}
+	if (self->lastError != GBEE_NO_ERROR)
+	{
+		error = GBEE_INHERITED_ERROR;
+	}
+	GBEE_THROW(error);
+
+	// All Tx requests carry the frame ID right after the API identifier.
+	error = gbeeFrameIdClaim(self, frameData->ident, timeout, handler, context,
+			&id);
+	GBEE_THROW(error);
+	frameData->txRequest16.frameId = id;
+
+	error = gbeeSend(self, frameData, length);
+	if (error != GBEE_NO_ERROR)
+	{
+		gbeeFrameIdRelease(self, id);
+	}
+	else if (frameId != NULL)
+	{
+		*frameId = id;
+	}
+	return error;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeSendAtCommandAsync(GBee *self, uint8_t *atCmd, uint8_t *value,
+		uint16_t length, uint32_t timeout, GBeeCompletionHandler handler,
+		void *context, uint8_t *frameId)
+{
+	// Frame ID of the request.
+	uint8_t id;
+	// GBee error code.
+	GBeeError error;
+
+	error = gbeeFrameIdClaim(self, GBEE_AT_COMMAND, timeout, handler, context,
+			&id);
+	GBEE_THROW(error);
+
+	error = gbeeSendAtCommand(self, id, atCmd, value, length);
+	if (error != GBEE_NO_ERROR)
+	{
+		gbeeFrameIdRelease(self, id);
+	}
+	else if (frameId != NULL)
+	{
+		*frameId = id;
+	}
+	return error;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeSendAtCommandQueueAsync(GBee *self, uint8_t *atCmd,
+		uint8_t *value, uint16_t length, uint32_t timeout,
+		GBeeCompletionHandler handler, void *context, uint8_t *frameId)
+{
+	// Frame ID of the request.
+	uint8_t id;
+	// GBee error code.
+	GBeeError error;
+
+	error = gbeeFrameIdClaim(self, GBEE_AT_COMMAND_QUEUE, timeout, handler,
+			context, &id);
+	GBEE_THROW(error);
+
+	error = gbeeSendAtCommandQueue(self, id, atCmd, value, length);
+	if (error != GBEE_NO_ERROR)
+	{
+		gbeeFrameIdRelease(self, id);
+	}
+	else if (frameId != NULL)
+	{
+		*frameId = id;
+	}
+	return error;
+}
+
+/******************************************************************************/
+
+void gbeeProcessTimeouts(GBee *self)
+{
+	// Current time.
+	GBeeTime now = gbeeClockGet();
+	// Index of the current entry.
+	uint16_t index;
+	// Current entry.
+	GBeeFrameIdEntry *entry;
+	// Completion handler of the current entry.
+	GBeeCompletionHandler completion;
+	// Context pointer of the current entry.
+	void *context;
+
+	for (index = 0; index < GBEE_MAX_FRAME_IDS; index++)
+	{
+		entry = &self->frameIds.entries[index];
+		if ((entry->inUse == GBEE_FRAME_ID_IN_FLIGHT)
+				&& (entry->completion != NULL) && (now >= entry->deadline))
+		{
+			completion = entry->completion;
+			context    = entry->context;
+			if (gbeeCompareAndSwap(&entry->inUse, GBEE_FRAME_ID_IN_FLIGHT,
+					GBEE_FRAME_ID_FREE))
+			{
+				completion(self, index + 1, GBEE_TIMEOUT_ERROR, NULL, 0, context);
+			}
+		}
+	}
+}
+
+/******************************************************************************/
+
+GBeeError gbeeWaitUntil(GBee *self, const volatile bool *done,
+		uint32_t *timeout)
+{
+	// Deadline of the call.
+	GBeeTime deadline = gbeeDeadlineAfter(*timeout);
+	// GBee error code.
+	GBeeError error;
+
+	error = gbeeWaitUntilDeadline(self, done, deadline);
+	*timeout = gbeeRemaining(deadline);
+	return error;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeWaitUntilDeadline(GBee *self, const volatile bool *done,
+		GBeeTime deadline)
+{
+	// GBee error code.
+	GBeeError error = GBEE_NO_ERROR;
+
+	// Check some pre-conditions.
+	if (self->lastError != GBEE_NO_ERROR)
+	{
+		error = GBEE_INHERITED_ERROR;
+	}
+	GBEE_THROW(error);
+
+	self->rx.parking = true;
+	while (1)
+	{
+		// Parse the data already buffered, the frames are parked.
+		gbeeProcessRxBuffer(self);
+		gbeeProcessTimeouts(self);
+		if (*done)
+		{
+			error = GBEE_NO_ERROR;
+			break;
+		}
+
+		// Need more data: read from the serial interface.
+		error = gbeeFillRxBuffer(self, deadline);
+		if (error == GBEE_TIMEOUT_ERROR)
+		{
+			gbeeProcessTimeouts(self);
+			if (*done)
+			{
+				error = GBEE_NO_ERROR;
+			}
+			break;
+		}
+		else if (error != GBEE_NO_ERROR)
+		{
+			gbeeParserResync(&self->rx.parser);
+			break;
+		}
+	}
+	self->rx.parking = false;
+	return error;
+}
+
+/******************************************************************************/
+
+void gbeeSetQueueDepth(GBee *self, uint8_t ident, uint8_t depth)
+{
+	self->rx.queueDepth[ident] = depth;
+}
+
+/******************************************************************************/
+
+uint32_t gbeeGetQueueOverflowCount(const GBee *self, uint8_t ident)
+{
+	return self->rx.queueOverflow[ident];
+}
+
+/******************************************************************************/
+
+bool gbeeRegisterCacheGet(GBee *self, const char *regName, uint8_t *value,
+		uint16_t *length, uint16_t maxLength)
+{
+	// Cache entry of the register.
+	GBeeRegisterCacheEntry *entry;
+	// Sequence number of the entry before reading it.
+	uint32_t sequence;
+	// Length of the value.
+	uint8_t valueLength;
+
+	entry = gbeeRegisterCacheFind(self, (const uint8_t *)regName);
+	if (entry == NULL)
+	{
+		return false;
+	}
+
+	// Read the entry, unless it is written meanwhile: a value torn by a
+	// concurrent write is reported as not cached.
+	sequence = entry->sequence;
+	if (sequence & 1)
+	{
+		return false;
+	}
+	GBEE_MEMORY_BARRIER();
+	valueLength = entry->length;
+	if (!entry->valid || (valueLength > maxLength)
+			|| (valueLength > GBEE_REGISTER_CACHE_VALUE_LENGTH))
+	{
+		return false;
+	}
+	GBEE_PORT_MEMORY_COPY(value, entry->value, valueLength);
+	GBEE_MEMORY_BARRIER();
+	if (entry->sequence != sequence)
+	{
+		return false;
+	}
+	*length = valueLength;
+	return true;
+}
+
+/******************************************************************************/
+
+void gbeeRegisterCachePut(GBee *self, const char *regName,
+		const uint8_t *value, uint16_t length)
+{
+	// Cache entry of the register.
+	GBeeRegisterCacheEntry *entry;
+	// Sequence number of the entry while writing it.
+	uint32_t sequence;
+
+	entry = gbeeRegisterCacheFind(self, (const uint8_t *)regName);
+	if ((entry == NULL) || (length == 0)
+			|| (length > GBEE_REGISTER_CACHE_VALUE_LENGTH))
+	{
+		return;
+	}
+	sequence = gbeeRegisterCacheLock(entry);
+	GBEE_PORT_MEMORY_COPY(entry->value, value, length);
+	entry->length  = length;
+	entry->valid   = true;
+	entry->pending = false;
+	gbeeRegisterCacheUnlock(entry, sequence);
+}
+
+/******************************************************************************/
+
+void gbeeRegisterCacheInvalidate(GBee *self)
+{
+	// Index of the current entry.
+	uint16_t index;
+	// Sequence number of the current entry while writing it.
+	uint32_t sequence;
+
+	for (index = 0; index < GBEE_REGISTER_CACHE_SIZE; index++)
+	{
+		sequence = gbeeRegisterCacheLock(&self->registers[index]);
+		self->registers[index].valid = false;
+		gbeeRegisterCacheUnlock(&self->registers[index], sequence);
+	}
+}
+
+/******************************************************************************/
+
+GBeeError gbeeSend(GBee *self, GBeeFrameData *frameData, uint16_t length)
+{
+	// The frame data as a single block.
+	GBeeIoVector fragment;
+
+	fragment.data   = (const uint8_t *)frameData;
+	fragment.length = length;
+	return gbeeSendFragments(self, &fragment, 1);
+}
+
+/******************************************************************************/
+
+GBeeError gbeeSendBatch(GBee *self, GBeeFrameData * const *frames,
+		const uint16_t *lengths, uint16_t count)
+{
+	// Frame header, frame data and frame trailer of the current frame.
+	GBeeIoVector vector[3];
+	// Header of the current frame.
+	GBeeFrameHeader frameHeader;
+	// Trailer of the current frame.
+	GBeeFrameTrailer frameTrailer;
+	// Current frame escaped for API mode 2.
+	uint8_t escapedFrame[GBEE_ESCAPED_FRAME_SIZE];
+	// Number of blocks making up the current frame.
+	uint16_t vectorCount;
+	// Total length of the current frame.
+	uint16_t frameLength;
+	// End of the transmit buffer before queueing the batch.
+	uint16_t txTail = self->tx.tail;
+	// Index of the current frame.
+	uint16_t index;
+	// GBee error code.
+	GBeeError error = GBEE_NO_ERROR;
+
+	for (index = 0; index < count; index++)
+	{
+		if (lengths[index] > GBEE_MAX_FRAME_SIZE)
+		{
+			error = GBEE_FRAME_SIZE_ERROR;
+		}
+	}
+
+	// Check some pre-conditions.
+	if (self->lastError != GBEE_NO_ERROR)
+	{
+		error = GBEE_INHERITED_ERROR;
+	}
+	GBEE_THROW(error);
+
+	if (!self->nonBlocking)
+	{
+		// Send anything left over from non-blocking mode, then start at the
+		// beginning of the buffer, so the frames are contiguous.
+		error = gbeeDrainTxBuffer(self);
+		GBEE_THROW(error);
+		self->tx.head = 0;
+		self->tx.tail = 0;
+	}
+
+	// Encode the frames back to back into the transmit buffer.
+	for (index = 0; index < count; index++)
+	{
+		vector[1].data   = (const uint8_t *)frames[index];
+		vector[1].length = lengths[index];
+		frameHeader.startDelimiter = GBEE_FRAME_START_DELIMITER;
+		frameHeader.length         = GBEE_USHORT(lengths[index]);
+		frameTrailer.checksum      = gbeeCalculateChecksum(&vector[1], 1);
+		vector[0].data   = (const uint8_t *)&frameHeader;
+		vector[0].length = sizeof(GBeeFrameHeader);
+		vector[2].data   = (const uint8_t *)&frameTrailer;
+		vector[2].length = sizeof(GBeeFrameTrailer);
+		vectorCount = 3;
+		frameLength = lengths[index] + sizeof(GBeeFrameHeader)
+				+ sizeof(GBeeFrameTrailer);
+		if (self->escaped)
+		{
+			frameLength      = gbeeEscapeFrame(vector, 3, escapedFrame);
+			vector[0].data   = escapedFrame;
+			vector[0].length = frameLength;
+			vectorCount      = 1;
+		}
+
+		if ((GBEE_TX_BUFFER_SIZE - GBEE_TX_BUFFER_COUNT(self)) < frameLength)
+		{
+			if (self->nonBlocking)
+			{
+				// Drop the frames queued so far - all frames or nothing.
+				self->tx.tail = txTail;
+				return GBEE_WOULD_BLOCK_ERROR;
+			}
+
+			// Buffer is full, send what we have so far.
+			error = gbeeDrainTxBuffer(self);
+			GBEE_THROW(error);
+			self->tx.head = 0;
+			self->tx.tail = 0;
+		}
+		gbeeEnqueue(self, vector, vectorCount);
+	}
+
+	// Send the frames via the serial interface.
+	if (self->nonBlocking)
+	{
+		return gbeeFlushTxBuffer(self);
+	}
+	return gbeeDrainTxBuffer(self);
+}
+
+/******************************************************************************/
+
+GBeeError gbeeSendAtCommand(GBee *self, uint8_t frameId, uint8_t *atCmd, 
+		uint8_t *value, uint16_t length)
+{
+	// GBee error code.
+	GBeeError error = GBEE_NO_ERROR;
+	// AT command to send to GBee.
+	GBeeAtCommand atCommand;
+	// Frame header and payload.
+	GBeeIoVector fragments[2];
+
+	// Check some pre-conditions.
+	if (self->lastError != GBEE_NO_ERROR)
+	{
+		error = GBEE_INHERITED_ERROR;
+	}
+	GBEE_THROW(error);	
+
+	gbeeRegisterCacheOnCommand(self, atCmd, length, false);
+
+	// Assemble the AT command frame.
+	atCommand.ident        = GBEE_AT_COMMAND;
+	atCommand.frameId      = frameId;
+	atCommand.atCommand[0] = atCmd[0];
+	atCommand.atCommand[1] = atCmd[1];
+	fragments[0].data   = (const uint8_t *)&atCommand;
+	fragments[0].length = GBEE_AT_COMMAND_HEADER_LENGTH;
+	fragments[1].data   = value;
+	fragments[1].length = length;
+
+	// Send the frame, the payload is not copied.
+	error = gbeeSendFragments(self, fragments, 2);
+	return error;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeSendAtCommandQueue(GBee *self, uint8_t frameId, uint8_t *atCmd, 
+		uint8_t *value, uint16_t length)
+{
+	// GBee error code.
+	GBeeError error = GBEE_NO_ERROR;
+	// AT command to send to GBee.
+	GBeeAtCommandQueue atCommandQueue;
+	// Frame header and payload.
+	GBeeIoVector fragments[2];
+
+	// Check some pre-conditions.
+	if (self->lastError != GBEE_NO_ERROR)
+	{
+		error = GBEE_INHERITED_ERROR;
+	}
+	GBEE_THROW(error);	
+
+	gbeeRegisterCacheOnCommand(self, atCmd, length, true);
+
+	// Assemble the AT command frame.
+	atCommandQueue.ident        = GBEE_AT_COMMAND_QUEUE;
+	atCommandQueue.frameId      = frameId;
+	atCommandQueue.atCommand[0] = atCmd[0];
+	atCommandQueue.atCommand[1] = atCmd[1];
+	fragments[0].data   = (const uint8_t *)&atCommandQueue;
+	fragments[0].length = GBEE_AT_COMMAND_QUEUE_HEADER_LENGTH;
+	fragments[1].data   = value;
+	fragments[1].length = length;
+
+	// Send the frame, the payload is not copied.
+	error = gbeeSendFragments(self, fragments, 2);
+	return error;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeSendRemoteAtCommand(GBee *self, uint8_t frameId, uint32_t dstAddr64h,
+		uint32_t dstAddr64l, uint16_t dstAddr16, uint8_t *atCmd, uint8_t cmdOpts,
+		uint8_t *value, uint16_t length)
+{
+	// Error code returned by GBee.
+	GBeeError error = GBEE_NO_ERROR;
+	// Remote AT command parameters.
+	GBeeRemoteAtCommand remoteAtCommand;
+	// Frame header and payload.
+	GBeeIoVector fragments[2];
+
+	// Check some pre-conditions.
+	if (self->lastError != GBEE_NO_ERROR)
+	{
+		error = GBEE_INHERITED_ERROR;
+	}
+	GBEE_THROW(error);	
+
+	// Assemble the AT command frame.
+	remoteAtCommand.ident        = GBEE_REMOTE_AT_COMMAND;
+	remoteAtCommand.frameId      = frameId;
+	remoteAtCommand.dstAddr64h   = GBEE_ULONG(dstAddr64h);
+	remoteAtCommand.dstAddr64l   = GBEE_ULONG(dstAddr64l);
+	remoteAtCommand.dstAddr16    = GBEE_USHORT(dstAddr16);
+	remoteAtCommand.atCommand[0] = atCmd[0];
+	remoteAtCommand.atCommand[1] = atCmd[1];
+	remoteAtCommand.cmdOpts      = cmdOpts;
+	fragments[0].data   = (const uint8_t *)&remoteAtCommand;
+	fragments[0].length = GBEE_REMOTE_AT_COMMAND_HEADER_LENGTH;
+	fragments[1].data   = value;
+	fragments[1].length = length;
+
+	// Send the frame, the payload is not copied.
+	error = gbeeSendFragments(self, fragments, 2);
+	return error;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeSendTxRequest64(GBee *self, uint8_t frameId, uint32_t dstAddr64h,
+		uint32_t dstAddr64l, uint8_t options, uint8_t* data, uint16_t length)
+{
+	// The data as a single fragment.
+	GBeeIoVector fragment;
+
+	fragment.data   = data;
+	fragment.length = length;
+	return gbeeSendTxRequest64v(self, frameId, dstAddr64h, dstAddr64l, options,
+			&fragment, 1);
+}
+
+/******************************************************************************/
+
+GBeeError gbeeSendTxRequest64v(GBee *self, uint8_t frameId, uint32_t dstAddr64h,
+		uint32_t dstAddr64l, uint8_t options, const GBeeIoVector *fragments,
+		uint16_t count)
+{
+	// Error code returned by GBee.
+	GBeeError error = GBEE_NO_ERROR;
+	// 64bit address Tx request parameters.
+	GBeeTxRequest64 txRequest64;
+	// Frame header followed by the payload fragments.
+	GBeeIoVector vector[GBEE_MAX_PAYLOAD_FRAGMENTS + 1];
+
+	// Check some pre-conditions.
+	if (self->lastError != GBEE_NO_ERROR)
+	{
+		error = GBEE_INHERITED_ERROR;
+	}
+	else if ((count > GBEE_MAX_PAYLOAD_FRAGMENTS)
+			|| (gbeeGetPayloadLength(fragments, count) > self->maxPayloadLength))
+	{
+		error = GBEE_FRAME_SIZE_ERROR;
+	}
+	GBEE_THROW(error);	
+
+	// Assemble the Tx request frame header.
+	txRequest64.ident      = GBEE_TX_REQUEST_64;
+	txRequest64.frameId    = frameId;
+	txRequest64.dstAddr64h = GBEE_ULONG(dstAddr64h);
+	txRequest64.dstAddr64l = GBEE_ULONG(dstAddr64l);
+	txRequest64.options    = options;
+	vector[0].data   = (const uint8_t *)&txRequest64;
+	vector[0].length = GBEE_TX_REQUEST_64_HEADER_LENGTH;
+	GBEE_PORT_MEMORY_COPY(&vector[1], fragments, count * sizeof(GBeeIoVector));
+
+	// Send the frame, the payload is not copied.
+	error = gbeeSendFragments(self, vector, count + 1);
+	return error;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeSendTxRequest16(GBee *self, uint8_t frameId, uint16_t dstAddr16,
+		uint8_t options, uint8_t *data, uint16_t length)
+{
+	// The data as a single fragment.
+	GBeeIoVector fragment;
+
+	fragment.data   = data;
+	fragment.length = length;
+	return gbeeSendTxRequest16v(self, frameId, dstAddr16, options, &fragment, 1);
+}
+
+/******************************************************************************/
+
+GBeeError gbeeSendTxRequest16v(GBee *self, uint8_t frameId, uint16_t dstAddr16,
+		uint8_t options, const GBeeIoVector *fragments, uint16_t count)
+{
+	// Error code returned by GBee.
+	GBeeError error = GBEE_NO_ERROR;
+	// 16bit address Tx request parameters.
+	GBeeTxRequest16 txRequest16;
+	// Frame header followed by the payload fragments.
+	GBeeIoVector vector[GBEE_MAX_PAYLOAD_FRAGMENTS + 1];
+
+	// Check some pre-conditions.
+	if (self->lastError != GBEE_NO_ERROR)
+	{
+		error = GBEE_INHERITED_ERROR;
+	}
+	else if ((count > GBEE_MAX_PAYLOAD_FRAGMENTS)
+			|| (gbeeGetPayloadLength(fragments, count) > self->maxPayloadLength))
+	{
+		error = GBEE_FRAME_SIZE_ERROR;
+	}
+	GBEE_THROW(error);	
+
+	// Assemble the Tx request frame header.
+	txRequest16.ident     = GBEE_TX_REQUEST_16;
+	txRequest16.frameId   = frameId;
+	txRequest16.dstAddr16 = GBEE_USHORT(dstAddr16);
+	txRequest16.options   = options;
+	vector[0].data   = (const uint8_t *)&txRequest16;
+	vector[0].length = GBEE_TX_REQUEST_16_HEADER_LENGTH;
+	GBEE_PORT_MEMORY_COPY(&vector[1], fragments, count * sizeof(GBeeIoVector));
+
+	// Send the frame, the payload is not copied.
+	error = gbeeSendFragments(self, vector, count + 1);
+	return error;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeSendTxRequest(GBee *self, uint8_t frameId, uint32_t dstAddr64h, 
+		uint32_t dstAddr64l, uint16_t dstAddr16, uint8_t bcastRadius,
+		uint8_t options, uint8_t *data, uint16_t length)
+{
+	// The data as a single fragment.
+	GBeeIoVector fragment;
+
+	fragment.data   = data;
+	fragment.length = length;
+	return gbeeSendTxRequestv(self, frameId, dstAddr64h, dstAddr64l, dstAddr16,
+			bcastRadius, options, &fragment, 1);
+}
+
+/******************************************************************************/
+
+GBeeError gbeeSendTxRequestv(GBee *self, uint8_t frameId, uint32_t dstAddr64h,
+		uint32_t dstAddr64l, uint16_t dstAddr16, uint8_t bcastRadius,
+		uint8_t options, const GBeeIoVector *fragments, uint16_t count)
+{
+	// Error code returned by GBee.
+	GBeeError error = GBEE_NO_ERROR;
+	// Tx request parameters.
+	GBeeTxRequest txRequest;
+	// Frame header followed by the payload fragments.
+	GBeeIoVector vector[GBEE_MAX_PAYLOAD_FRAGMENTS + 1];
+
+	// Check some pre-conditions.
+	if (self->lastError != GBEE_NO_ERROR)
+	{
+		error = GBEE_INHERITED_ERROR;
+	}
+	else if ((count > GBEE_MAX_PAYLOAD_FRAGMENTS)
+			|| (gbeeGetPayloadLength(fragments, count) > self->maxPayloadLength))
+	{
+		error = GBEE_FRAME_SIZE_ERROR;
+	}
+	GBEE_THROW(error);
+
+	// Assemble the Tx request frame header.
+	txRequest.ident       = GBEE_TX_REQUEST;
+	txRequest.frameId     = frameId;
+	txRequest.dstAddr64h  = GBEE_ULONG(dstAddr64h);
+	txRequest.dstAddr64l  = GBEE_ULONG(dstAddr64l);
+	txRequest.dstAddr16   = GBEE_USHORT(dstAddr16);
+	txRequest.bcastRadius = bcastRadius;
+	txRequest.options     = options;
+	vector[0].data   = (const uint8_t *)&txRequest;
+	vector[0].length = GBEE_TX_REQUEST_HEADER_LENGTH;
+	GBEE_PORT_MEMORY_COPY(&vector[1], fragments, count * sizeof(GBeeIoVector));
+
+	// Send the frame, the payload is not copied.
+	error = gbeeSendFragments(self, vector, count + 1);
+	return error;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeXferAtCommand(GBee *self, const char *command, const char *args,
+		uint16_t argLength, char *response, uint16_t *responseLength)
+{
+	return gbeeXferAtCommandDeadline(self, command, args, argLength, response,
+			responseLength, GBEE_NO_DEADLINE);
+}
+
+/******************************************************************************/
+
+GBeeError gbeeXferAtCommandDeadline(GBee *self, const char *command,
+		const char *args, uint16_t argLength, char *response,
+		uint16_t *responseLength, GBeeTime deadline)
+{
+	// Error code returned by XBee.
+	GBeeError error = GBEE_NO_ERROR;
+	// Error code of the exit from command mode.
+	GBeeError endError;
+
+	error = gbeeCommandModeBegin(self, deadline);
+	GBEE_THROW(error);
+
+	// Leave command mode even if the command failed, report the first error.
+	error = gbeeCommandModeExec(self, command, args, argLength, response,
+			responseLength, deadline);
+	endError = gbeeCommandModeEnd(self, deadline);
+	GBEE_THROW(error);
+	return endError;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeCommandModeBegin(GBee *self, GBeeTime deadline)
+{
+	// Count bytes transferred.
+	uint16_t byteCount;
+	// Scratch pad for the response.
+	uint8_t scratch[GBEE_MAX_FRAME_SIZE];
+	// Error code returned by XBee.
+	GBeeError error = GBEE_NO_ERROR;
+	
+	// Ensure no transmission for 1 second minimum.
+	gbeeWait(self, 1100);
+	
+	// Write the command sequence.
+	if (GBEE_PORT_UART_SEND_BUFFER(self->serialDevice, (uint8_t*)"+++", 3) != 0)
+	{
+		error = GBEE_RS232_ERROR;
+	}
+	GBEE_THROW(error);	
+	
+	// Wait for the OK.
+	error = gbeeGetResponse(self, scratch, &byteCount, GBEE_MAX_FRAME_SIZE,
+			'\r', gbeeResponseDeadline(deadline));
+	GBEE_THROW(error);	
+	
+	if (!gbeeIsOkResponse(scratch, byteCount))
+	{
+		GBEE_THROW(GBEE_RESPONSE_ERROR);
+	}
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeCommandModeExec(GBee *self, const char *command,
+		const char *args, uint16_t argLength, char *response,
+		uint16_t *responseLength, GBeeTime deadline)
+{
+	// Count bytes transferred.
+	uint16_t byteCount;
+	// Pointer to GBee response.
+	char *responsePtr;
+	// Scratch pad for commands and responses (command mode uses both
+	// directions, so it does not borrow the buffers of the Rx/Tx contexts).
+	uint8_t scratch[GBEE_MAX_FRAME_SIZE];
+	// Pointer into the scratch pad.
+	char *scratchPtr = (char*)scratch;
+	// Error code returned by XBee.
+	GBeeError error = GBEE_NO_ERROR;
+	
+	// Check the command fits into the scratch pad ("AT", command and '\r').
+	if ((uint32_t)argLength + 5 > GBEE_MAX_FRAME_SIZE)
+	{
+		error = GBEE_FRAME_SIZE_ERROR;
+	}
+	GBEE_THROW(error);
+
+	gbeeRegisterCacheOnCommand(self, (const uint8_t *)command, argLength,
+			false);
+
+	// Assemble the AT command.
+	*scratchPtr++ = 'A';
+	*scratchPtr++ = 'T';
+	*scratchPtr++ = command[0];
+	*scratchPtr++ = command[1];
+	if (args != NULL)
+	{
+		GBEE_PORT_MEMORY_COPY(scratchPtr, args, argLength);
+		scratchPtr += argLength;
+	}
+	*scratchPtr++ = '\r';
+
+	// Write the AT command.
+	error = GBEE_PORT_UART_SEND_BUFFER(self->serialDevice, scratch,
+			scratchPtr - ((char*)scratch));
+	GBEE_THROW(error);
+
+	// Read the response.
+	if (response != NULL)
+	{
+		responsePtr = response;
+	}
+	else
+	{
+		responsePtr = (char*)scratch;
+	}
+		
+	error = gbeeGetResponse(self, (uint8_t*)responsePtr, &byteCount,
+			GBEE_MAX_FRAME_SIZE, '\r', gbeeResponseDeadline(deadline));
+	GBEE_THROW(error);
+		
+	// Check the response and remove all control characters from it.
+	if (byteCount >= 6)
+	{
+		if ((responsePtr[byteCount-6] == 'E')
+				&& (responsePtr[byteCount-5] == 'R') 
+				&& (responsePtr[byteCount-4] == 'R')
+				&& (responsePtr[byteCount-3] == 'O')
+				&& (responsePtr[byteCount-2] == 'R') 
+				&& (responsePtr[byteCount-1] == '\r'))
+		{
+			responsePtr[byteCount-6] = 
+			responsePtr[byteCount-5] = 
+			responsePtr[byteCount-4] = 
+			responsePtr[byteCount-3] = 
+			responsePtr[byteCount-2] = 
+			responsePtr[byteCount-1] = 0;
+			byteCount -= 6;
+			GBEE_THROW(GBEE_RESPONSE_ERROR);
+		}
+	}
+	if (byteCount >= 3)
+	{
+		if ((responsePtr[byteCount-3] == 'O')
+				&& (responsePtr[byteCount-2] == 'K') 
+				&& (responsePtr[byteCount-1] == '\r'))
+		{
+			responsePtr[byteCount-3] = 
+			responsePtr[byteCount-2] = 
+			responsePtr[byteCount-1] = 0;
+			byteCount -= 3;
+		}
+	}
+
+	if (responseLength != NULL)
+	{
+		*responseLength = byteCount;
+	}
+	
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
+GBeeError gbeeCommandModeEnd(GBee *self, GBeeTime deadline)
+{
+	// Count bytes transferred.
+	uint16_t byteCount;
+	// Scratch pad for the command and the response.
+	uint8_t scratch[GBEE_MAX_FRAME_SIZE];
+	// Error code returned by XBee.
+	GBeeError error = GBEE_NO_ERROR;
+
+	// Exit command mode.
+	error = GBEE_PORT_UART_SEND_BUFFER(self->serialDevice, (uint8_t*)"ATCN\r",
+			5);
+	GBEE_THROW(error);
+	
+	error = gbeeGetResponse(self, scratch, &byteCount, GBEE_MAX_FRAME_SIZE,
+			'\r', gbeeResponseDeadline(deadline));
+	GBEE_THROW(error);
+
+	if (!gbeeIsOkResponse(scratch, byteCount))
+	{
+		GBEE_THROW(GBEE_RESPONSE_ERROR);
+	}
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
+static GBeeError gbeeGetResponse(GBee *self, uint8_t *response, uint16_t *size,
+		uint16_t maxSize, char stopChar, GBeeTime deadline)
+{
+	// GBee error code.
+	GBeeError error = GBEE_NO_ERROR;
+	*size = 0;
+	
+	while (1)
+	{
+		// Read a byte.
+		error = gbeeReceiveByte(self, &response[*size], deadline);
+		
+		if (error == GBEE_NO_ERROR)
+		{
+			// Count the byte.
+			(*size)++;
+			
+			// Got a byte. Check if it is the stop character.
+			if (response[(*size)-1] == stopChar)
+			{
+				error = GBEE_NO_ERROR;
+				break;
+			}
+			
+			// Check if maximum number of bytes received.
+			if (*size >= maxSize)
+			{
+				error = GBEE_NO_ERROR;
+				break;
+			}
+		}
+		else
+		{
+			// Either timeout or serial error.
+			break;
+		}
+	}
+
+	return error;
+}
+
+/******************************************************************************/
+
+static GBeeError gbeeFillRxBuffer(GBee *self, GBeeTime deadline)
+{
+	// Offset of the first free byte in the receive buffer.
+	uint16_t offset = GBEE_RX_BUFFER_OFFSET(self->rx.tail);
+	// Number of bytes to read - limited to the end of the buffer.
+	uint32_t maxLength = GBEE_RX_BUFFER_SIZE - GBEE_RX_BUFFER_COUNT(self);
+	// Number of bytes received.
+	uint32_t length;
+	// GBee error code.
+	GBeeError error;
+
+	if (maxLength > (uint32_t)(GBEE_RX_BUFFER_SIZE - offset))
+	{
+		maxLength = GBEE_RX_BUFFER_SIZE - offset;
+	}
+	if (maxLength == 0)
+	{
+		// Buffer is full, nothing to do.
+		return GBEE_NO_ERROR;
+	}
+
+	// The port may return early (e.g. when interrupted), so keep reading until
+	// the deadline has passed.
+	do
+	{
+#ifdef GBEE_PORT_UART_RECEIVE_BUFFER
+		error = GBEE_PORT_UART_RECEIVE_BUFFER(self->serialDevice,
+				&self->rx.buffer[offset], maxLength, &length,
+				gbeeRemaining(deadline));
+#else
+		error  = GBEE_PORT_UART_RECEIVE_BYTE(self->serialDevice,
+				&self->rx.buffer[offset], gbeeRemaining(deadline));
+		length = 1;
+#endif // GBEE_PORT_UART_RECEIVE_BUFFER
+	}
+	while ((error == GBEE_TIMEOUT_ERROR) && (gbeeClockGet() < deadline));
+
+	if (error == GBEE_NO_ERROR)
+	{
+		self->rx.tail += length;
+	}
+	return error;
+}
+
+/******************************************************************************/
+
+static GBeeError gbeeReceiveByte(GBee *self, uint8_t *byte, GBeeTime deadline)
+{
+	// GBee error code.
+	GBeeError error;
+
+	// Go to the serial interface only if there is no buffered data left.
+	if (self->rx.head == self->rx.tail)
+	{
+		error = gbeeFillRxBuffer(self, deadline);
+		GBEE_THROW(error);
+	}
+
+	*byte = self->rx.buffer[GBEE_RX_BUFFER_OFFSET(self->rx.head)];
+	self->rx.head++;
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
+static GBeeError gbeeSendFragments(GBee *self, const GBeeIoVector *fragments,
+		uint16_t count)
+{
+	// Frame header, frame data blocks and frame trailer.
+	GBeeIoVector vector[GBEE_IO_VECTOR_MAX];
+	// Header of frame to send.
+	GBeeFrameHeader frameHeader;
+	// Trailer of frame to send.
+	GBeeFrameTrailer frameTrailer;
+	// Frame escaped for API mode 2.
+	uint8_t escapedFrame[GBEE_ESCAPED_FRAME_SIZE];
+	// Escaped frame as a single block.
+	GBeeIoVector escapedVector;
+	// Length of the frame data.
+	uint32_t length = 0;
+	// Index of the current block.
+	uint16_t index;
+	// GBee error code.
+	GBeeError error = GBEE_NO_ERROR;
+
+	for (index = 0; index < count; index++)
+	{
+		length += fragments[index].length;
+	}
+
+	// Check some pre-conditions.
+	if (self->lastError != GBEE_NO_ERROR)
+	{
+		error = GBEE_INHERITED_ERROR;
+	}
+	else if ((length > GBEE_MAX_FRAME_SIZE) || (count > (GBEE_IO_VECTOR_MAX - 2)))
+	{
+		error = GBEE_FRAME_SIZE_ERROR;
+	}
+	GBEE_THROW(error);
+
+	// Create frame header and trailer around the frame data.
+	frameHeader.startDelimiter = GBEE_FRAME_START_DELIMITER;
+	frameHeader.length         = GBEE_USHORT(length);
+	frameTrailer.checksum      = gbeeCalculateChecksum(fragments, count);
+	vector[0].data   = (const uint8_t *)&frameHeader;
+	vector[0].length = sizeof(GBeeFrameHeader);
+	for (index = 0; index < count; index++)
+	{
+		vector[index+1] = fragments[index];
+	}
+	vector[count+1].data   = (const uint8_t *)&frameTrailer;
+	vector[count+1].length = sizeof(GBeeFrameTrailer);
+
+	// Print the GBee message to send if debug logging is enabled.
+#ifdef GBEE_PORT_DEBUG_LOG
+	{
+		uint32_t byteNr;
+		GBEE_DEBUG_LOG("%s: ", __func__);
+		for (index = 0; index < (count + 2); index++)
+		{
+			for (byteNr = 0; byteNr < vector[index].length; byteNr++)
+			{
+				GBEE_DEBUG_LOG("%02x ", vector[index].data[byteNr]);
+			}
+		}
+		GBEE_DEBUG_LOG("\r\n");
+	}
+#endif // GBEE_PORT_DEBUG_LOG
+
+	// Send the frame via the serial interface.
+	if (self->escaped)
+	{
+		escapedVector.data   = escapedFrame;
+		escapedVector.length = gbeeEscapeFrame(vector, count + 2, escapedFrame);
+		error = gbeeTransmit(self, &escapedVector, 1, escapedVector.length);
+		return error;
+	}
+	error = gbeeTransmit(self, vector, count + 2,
+			length + sizeof(GBeeFrameHeader) + sizeof(GBeeFrameTrailer));
+	return error;
+}
+
+/******************************************************************************/
+
+static GBeeError gbeeTransmit(GBee *self, const GBeeIoVector *vector,
+		uint16_t count, uint16_t length)
+{
+	if (!self->nonBlocking)
+	{
+#ifdef GBEE_PORT_UART_SEND_VECTOR
+		return GBEE_PORT_UART_SEND_VECTOR(self->serialDevice, vector, count);
+#else
+		// Offset within the scratch pad.
+		uint16_t offset = 0;
+		// Index of the current block.
+		uint16_t index;
+
+		// Gather the blocks in the scratch pad.
+		for (index = 0; index < count; index++)
+		{
+			GBEE_PORT_MEMORY_COPY(&self->tx.scratch[offset], vector[index].data,
+					vector[index].length);
+			offset += vector[index].length;
+		}
+		return GBEE_PORT_UART_SEND_BUFFER(self->serialDevice, self->tx.scratch,
+				length);
+#endif // GBEE_PORT_UART_SEND_VECTOR
+	}
+
+	// Queue the data (the whole frame or nothing).
+	if ((GBEE_TX_BUFFER_SIZE - GBEE_TX_BUFFER_COUNT(self)) < length)
+	{
+		return GBEE_WOULD_BLOCK_ERROR;
+	}
+	gbeeEnqueue(self, vector, count);
+
+	return gbeeFlushTxBuffer(self);
+}
+
+/******************************************************************************/
+
+static void gbeeEnqueue(GBee *self, const GBeeIoVector *vector, uint16_t count)
+{
+	// Offset of the first free byte in the transmit buffer.
+	uint16_t offset;
+	// Number of bytes to copy before wrapping around.
+	uint16_t chunkLength;
+	// Index of the current block.
+	uint16_t index;
+
+	for (index = 0; index < count; index++)
+	{
+		offset      = GBEE_TX_BUFFER_OFFSET(self->tx.tail);
+		chunkLength = GBEE_TX_BUFFER_SIZE - offset;
+		if (chunkLength > vector[index].length)
+		{
+			chunkLength = vector[index].length;
+		}
+		GBEE_PORT_MEMORY_COPY(&self->tx.buffer[offset], vector[index].data,
+				chunkLength);
+		GBEE_PORT_MEMORY_COPY(self->tx.buffer, vector[index].data + chunkLength,
+				vector[index].length - chunkLength);
+		self->tx.tail += vector[index].length;
+	}
+}
+
+/******************************************************************************/
+
+static GBeeError gbeeDrainTxBuffer(GBee *self)
+{
+	// Offset of the first byte to send.
+	uint16_t offset;
+	// Number of bytes to send - limited to the end of the buffer.
+	uint16_t length;
+	// Number of bytes sent.
+	uint32_t written;
+#ifdef GBEE_PORT_UART_WAIT
+	// Events occurred while waiting for the serial interface.
+	uint8_t occurred;
+#endif // GBEE_PORT_UART_WAIT
+	// GBee error code.
+	GBeeError error;
+
+	while (self->tx.head != self->tx.tail)
+	{
+		offset = GBEE_TX_BUFFER_OFFSET(self->tx.head);
+		length = GBEE_TX_BUFFER_COUNT(self);
+		if (length > (GBEE_TX_BUFFER_SIZE - offset))
+		{
+			length = GBEE_TX_BUFFER_SIZE - offset;
+		}
+#ifdef GBEE_PORT_UART_WRITE_BUFFER
+		error = GBEE_PORT_UART_WRITE_BUFFER(self->serialDevice,
+				&self->tx.buffer[offset], length, &written);
+#else
+		error   = GBEE_PORT_UART_SEND_BUFFER(self->serialDevice,
+				&self->tx.buffer[offset], length);
+		written = length;
+#endif // GBEE_PORT_UART_WRITE_BUFFER
+		GBEE_THROW(error);
+
+		self->tx.head += written;
+		if (written < length)
+		{
+			// Serial interface is busy, wait until it gets writable.
+#ifdef GBEE_PORT_UART_WAIT
+			error = GBEE_PORT_UART_WAIT(self->serialDevice, GBEE_PORT_NO_WAKEUP,
+					GBEE_PORT_EVENT_WRITABLE, &occurred, GBEE_INFINITE_WAIT);
+			if ((error != GBEE_NO_ERROR) && (error != GBEE_TIMEOUT_ERROR))
+			{
+				return error;
+			}
+#else
+			gbeeWait(self, 1);
+#endif // GBEE_PORT_UART_WAIT
+		}
+	}
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
+static GBeeError gbeeFlushTxBuffer(GBee *self)
+{
+	// Offset of the first byte to send.
+	uint16_t offset;
+	// Number of bytes to send - limited to the end of the buffer.
+	uint16_t length;
+	// Number of bytes sent.
+	uint32_t written;
+	// GBee error code.
+	GBeeError error;
+
+	while (self->tx.head != self->tx.tail)
+	{
+		offset = GBEE_TX_BUFFER_OFFSET(self->tx.head);
+		length = GBEE_TX_BUFFER_COUNT(self);
+		if (length > (GBEE_TX_BUFFER_SIZE - offset))
+		{
+			length = GBEE_TX_BUFFER_SIZE - offset;
+		}
+#ifdef GBEE_PORT_UART_WRITE_BUFFER
+		error = GBEE_PORT_UART_WRITE_BUFFER(self->serialDevice,
+				&self->tx.buffer[offset], length, &written);
+#else
+		error   = GBEE_PORT_UART_SEND_BUFFER(self->serialDevice,
+				&self->tx.buffer[offset], length);
+		written = length;
+#endif // GBEE_PORT_UART_WRITE_BUFFER
+		GBEE_THROW(error);
+
+		self->tx.head += written;
+		if (written < length)
+		{
+			// Serial interface is busy, try again when it gets writable.
+			break;
+		}
+	}
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
+static void gbeeProcessRxBuffer(GBee *self)
+{
+	// Offset of the first byte to parse.
+	uint16_t offset;
+	// Number of bytes to parse - limited to the end of the buffer.
+	uint16_t length;
+
+	// Parse the bytes of a corrupt frame again first.
+	if (!self->rx.frameDone
+			&& (self->rx.parser.replayOffset < self->rx.parser.replayLength))
+	{
+		gbeeParserFeed(&self->rx.parser, NULL, 0);
+	}
+
+	while (!self->rx.frameDone && (self->rx.head != self->rx.tail))
+	{
+		offset = GBEE_RX_BUFFER_OFFSET(self->rx.head);
+		length = GBEE_RX_BUFFER_COUNT(self);
+		if (length > (GBEE_RX_BUFFER_SIZE - offset))
+		{
+			length = GBEE_RX_BUFFER_SIZE - offset;
+		}
+		self->rx.head += gbeeParserFeed(&self->rx.parser, &self->rx.buffer[offset],
+				length);
+	}
+}
+
+/******************************************************************************/
+
+static bool gbeeOnFrame(void *context, GBeeError error,
+		const GBeeFrameData *frameData, uint16_t length)
+{
+	// The GBee device.
+	GBee *self = (GBee *)context;
+	// Handler registered for the frame type.
+	const GBeeFrameDispatch *dispatch;
+
+	GBEE_DEBUG_LOG("%s: ident=%02x, length=%d, error=%d \r\n", __func__,
+			frameData ? frameData->ident : 0, length, error);
+
+	if (error == GBEE_NO_ERROR)
+	{
+		gbeeRegisterCacheOnFrame(self, frameData, length);
+	}
+
+	// Responses to asynchronous requests go to their completion handlers.
+	if ((error == GBEE_NO_ERROR) && gbeeComplete(self, frameData, length))
+	{
+		return true;
+	}
+
+	// Frame types with a handler of their own go straight to it.
+	if (error == GBEE_NO_ERROR)
+	{
+		dispatch = &self->rx.dispatch[frameData->ident];
+		if (dispatch->handler != NULL)
+		{
+			dispatch->handler(self, frameData, length, dispatch->context);
+			return true;
+		}
+	}
+
+	// Park the frame for a later receive call while gbeeWaitUntil() runs.
+	if (self->rx.parking)
+	{
+		if (error == GBEE_NO_ERROR)
+		{
+			gbeeQueuePut(self, frameData, length);
+		}
+		return true;
+	}
+
+	// Hand the frame over to the pending gbeeReceiveFrame() call.
+	if (self->rx.pending)
+	{
+		self->rx.frameData   = frameData;
+		self->rx.frameLength = length;
+		self->rx.frameError  = error;
+		self->rx.frameDone   = true;
+		return false;
+	}
+
+	// No call pending, pass the frame to the frame handler.
+	if ((error == GBEE_NO_ERROR) && (self->rx.handler != NULL))
+	{
+		self->rx.handler(self, frameData, length, self->rx.handlerContext);
+	}
+	return true;
+}
+
+/******************************************************************************/
+
+static uint32_t gbeeParserParse(GBeeParser *self, const uint8_t *bytes,
+		uint32_t length, bool *proceed, bool *corrupt)
+{
+	// Pointer to current byte being processed.
+	const uint8_t *bytePtr = bytes;
+	// Pointer behind the last byte to process.
+	const uint8_t *endPtr = bytes + length;
+	// Number of frame data bytes to take at once.
+	uint16_t chunkLength;
+
+	while (*proceed && !(*corrupt) && (bytePtr < endPtr))
+	{
+		if (self->escaped && (self->state != GBEE_PARSER_STATE_START))
+		{
+			if (*bytePtr == GBEE_FRAME_START_DELIMITER)
+			{
+				if (self->count == 0)
+				{
+					// Repeated start delimiter.
+					bytePtr++;
+					continue;
+				}
+				// Frame cut short by the next one - restart at the delimiter.
+				*corrupt = true;
+				*proceed = self->callback(self->context,
+						GBEE_FRAME_INTEGRITY_ERROR, NULL, self->length);
+				continue;
+			}
+			if (*bytePtr == GBEE_ESCAPE)
+			{
+				self->escapePending = true;
+				bytePtr++;
+				continue;
+			}
+		}
+
+		switch (self->state)
+		{
+			case GBEE_PARSER_STATE_START:
+				// Skip everything up to the next start delimiter.
+				bytePtr += gbeeKernelFindDelimiter(bytePtr, endPtr - bytePtr);
+				if (bytePtr < endPtr)
+				{
+					bytePtr++;
+					self->count = 0;
+					self->state = GBEE_PARSER_STATE_LENGTH_MSB;
+				}
+				break;
+
+			case GBEE_PARSER_STATE_LENGTH_MSB:
+				self->frame[self->count++] = gbeeParserTakeByte(self, *bytePtr++);
+				self->state = GBEE_PARSER_STATE_LENGTH_LSB;
+				break;
+
+			case GBEE_PARSER_STATE_LENGTH_LSB:
+				self->frame[self->count++] = gbeeParserTakeByte(self, *bytePtr++);
+				self->length = ((uint16_t)self->frame[0] << 8) | self->frame[1];
+				if ((self->length == 0) || (self->length > GBEE_MAX_FRAME_SIZE))
+				{
+					// Every frame holds at least its API identifier.
+					*corrupt = true;
+					*proceed = self->callback(self->context, GBEE_FRAME_SIZE_ERROR,
+							NULL, self->length);
+				}
+				else
+				{
+					self->state = GBEE_PARSER_STATE_DATA;
+				}
+				break;
+
+			case GBEE_PARSER_STATE_DATA:
+				if (self->escapePending)
+				{
+					self->frame[self->count++] = gbeeParserTakeByte(self, *bytePtr++);
+				}
+				else
+				{
+					// Take as much of the frame data as is available (up to the
+					// next escaped byte).
+					chunkLength = self->length + 2 - self->count;
+					if (chunkLength > (endPtr - bytePtr))
+					{
+						chunkLength = endPtr - bytePtr;
+					}
+					if (self->escaped)
+					{
+						chunkLength = gbeeKernelFindEscape(bytePtr, chunkLength);
+						if (chunkLength == 0)
+						{
+							// Stray XON/XOFF, take it as it is.
+							chunkLength = 1;
+						}
+					}
+					GBEE_PORT_MEMORY_COPY(&self->frame[self->count], bytePtr,
+							chunkLength);
+					self->count += chunkLength;
+					bytePtr     += chunkLength;
+				}
+				if (self->count == (self->length + 2))
+				{
+					self->state = GBEE_PARSER_STATE_CHECKSUM;
+				}
+				break;
+
+			case GBEE_PARSER_STATE_CHECKSUM:
+				self->frame[self->count++] = gbeeParserTakeByte(self, *bytePtr++);
+				if (gbeeVerifyChecksum(&self->frame[2], self->length,
+						self->frame[self->length+2]) != GBEE_NO_ERROR)
+				{
+					*corrupt = true;
+					*proceed = self->callback(self->context, GBEE_CHECKSUM_ERROR,
+							NULL, self->length);
+				}
+				else
+				{
+					self->state = GBEE_PARSER_STATE_START;
+					*proceed = self->callback(self->context, GBEE_NO_ERROR,
+							(GBeeFrameData *)&self->frame[2], self->length);
+				}
+				break;
+		}
+	}
+
+	return bytePtr - bytes;
+}
+
+/******************************************************************************/
+
+static uint8_t gbeeParserTakeByte(GBeeParser *self, uint8_t byte)
+{
+	if (self->escapePending)
+	{
+		self->escapePending = false;
+		return byte ^ GBEE_ESCAPE_XOR;
+	}
+	return byte;
+}
+
+/******************************************************************************/
+
+static uint16_t gbeeEscapeFrame(const GBeeIoVector *vector, uint16_t count,
+		uint8_t *buffer)
+{
+	// Length of the escaped frame.
+	uint16_t length;
+	// Index of the current block.
+	uint16_t index;
+
+	// The start delimiter is sent as it is, everything else is escaped.
+	buffer[0] = vector[0].data[0];
+	length    = 1 + gbeeKernelEscape(&vector[0].data[1], vector[0].length - 1,
+			&buffer[1]);
+	for (index = 1; index < count; index++)
+	{
+		length += gbeeKernelEscape(vector[index].data, vector[index].length,
+				&buffer[length]);
+	}
+	return length;
+}
+
+/******************************************************************************/
+
+static bool gbeeCompareAndSwap(volatile uint32_t *value, uint32_t oldValue,
+		uint32_t newValue)
+{
+#ifdef GBEE_PORT_ATOMIC_CAS
+	return GBEE_PORT_ATOMIC_CAS(value, oldValue, newValue);
+#else
+	if (*value != oldValue)
+	{
+		return false;
+	}
+	*value = newValue;
+	return true;
+#endif
+}
+
+/******************************************************************************/
+
+static bool gbeeIsResponse(uint8_t requestIdent, uint8_t responseIdent)
+{
+	switch (responseIdent)
+	{
+		case GBEE_AT_COMMAND_RESPONSE:
+			return (requestIdent == GBEE_AT_COMMAND)
+					|| (requestIdent == GBEE_AT_COMMAND_QUEUE);
+		case GBEE_REMOTE_AT_COMMAND_RESPONSE:
+			return requestIdent == GBEE_REMOTE_AT_COMMAND;
+		case GBEE_TX_STATUS:
+		case GBEE_TX_STATUS_NEW:
+			return (requestIdent == GBEE_TX_REQUEST_64)
+					|| (requestIdent == GBEE_TX_REQUEST_16)
+					|| (requestIdent == GBEE_TX_REQUEST);
+		default:
+			return false;
+	}
+}
+
+/******************************************************************************/
+
+static GBeeError gbeeFrameIdClaim(GBee *self, uint8_t requestIdent,
+		uint32_t timeout, GBeeCompletionHandler completion, void *context,
+		uint8_t *frameId)
+{
+	// Frame ID to try first.
+	uint8_t firstId = self->frameIds.nextFrameId;
+	// Frame ID currently tried.
+	uint8_t id = firstId;
+	// Entry of the frame ID.
+	GBeeFrameIdEntry *entry;
+
+	// Take the first free frame ID, starting after the last one handed out.
+	do
+	{
+		entry = &self->frameIds.entries[id - 1];
+		if ((entry->inUse == GBEE_FRAME_ID_FREE) && gbeeCompareAndSwap(
+				&entry->inUse, GBEE_FRAME_ID_FREE, GBEE_FRAME_ID_CLAIMED))
+		{
+			entry->requestIdent = requestIdent;
+			entry->deadline     = gbeeDeadlineAfter(timeout);
+			entry->context      = context;
+			entry->completion   = completion;
+			self->frameIds.nextFrameId = (id < GBEE_MAX_FRAME_IDS) ? id + 1 : 1;
+			*frameId = id;
+
+			// Publish the entry to the receiving thread.
+#ifdef GBEE_PORT_MEMORY_BARRIER
+			GBEE_PORT_MEMORY_BARRIER();
+#endif
+			entry->inUse = GBEE_FRAME_ID_IN_FLIGHT;
+			return GBEE_NO_ERROR;
+		}
+		id = (id < GBEE_MAX_FRAME_IDS) ? id + 1 : 1;
+	}
+	while (id != firstId);
+
+	return GBEE_NO_FRAME_ID_ERROR;
+}
+
+/******************************************************************************/
+
+static bool gbeeComplete(GBee *self, const GBeeFrameData *frameData,
+		uint16_t length)
+{
+	// Frame ID of the frame received.
+	uint8_t frameId;
+	// Entry of the frame ID.
+	GBeeFrameIdEntry *entry;
+	// Completion handler of the entry.
+	GBeeCompletionHandler completion;
+	// Context pointer of the entry.
+	void *context;
+
+	if (length < 2)
+	{
+		return false;
+	}
+	frameId = frameData->atCommandResponse.frameId;
+	if (!GBEE_FRAME_ID_VALID(frameId))
+	{
+		return false;
+	}
+
+	entry = &self->frameIds.entries[frameId - 1];
+	if (entry->inUse != GBEE_FRAME_ID_IN_FLIGHT)
+	{
+		return false;
+	}
+	completion = entry->completion;
+	context    = entry->context;
+	if ((completion == NULL)
+			|| !gbeeIsResponse(entry->requestIdent, frameData->ident))
+	{
+		return false;
+	}
+	if (gbeeCompareAndSwap(&entry->inUse, GBEE_FRAME_ID_IN_FLIGHT,
+			GBEE_FRAME_ID_FREE))
+	{
+		completion(self, frameId, GBEE_NO_ERROR, frameData, length, context);
+	}
+	return true;
 }
 
 /******************************************************************************/
 
-GBeeError gbeeSendTxRequest64(GBee *self, uint8_t frameId, uint32_t dstAddr64h,
-		uint32_t dstAddr64l, uint8_t options, uint8_t* data, uint16_t length)
+static void gbeeQueuePut(GBee *self, const GBeeFrameData *frameData,
+		uint16_t length)
 {
-	// Error code returned by GBee.
-	GBeeError error = GBEE_NO_ERROR;
-	// 64bit address Tx request parameters.
-	GBeeTxRequest64 txRequest64;
+	// Slot to park the frame in.
+	GBeeRxQueueSlot *slot;
 
-	// Check some pre-conditions.
-	if (self->lastError != GBEE_NO_ERROR)
+	if ((self->rx.queued[frameData->ident] >= self->rx.queueDepth[frameData->ident])
+			|| (self->rx.queueCount >= GBEE_RX_QUEUE_SIZE))
 	{
-		error = GBEE_INHERITED_ERROR;
+		self->rx.queueOverflow[frameData->ident]++;
+		return;
 	}
-	GBEE_THROW(error);	
-
-	// Assemble the AT command frame.
-	txRequest64.ident      = GBEE_TX_REQUEST_64;
-	txRequest64.frameId    = frameId;
-	txRequest64.dstAddr64h = GBEE_ULONG(dstAddr64h);
-	txRequest64.dstAddr64l = GBEE_ULONG(dstAddr64l);
-	txRequest64.options    = options;
-	GBEE_PORT_MEMORY_COPY(txRequest64.data, data, length);
 
-	// Send the AT command frame.
-	error = gbeeSend(self, (GBeeFrameData *)&txRequest64, length + GBEE_TX_REQUEST_64_HEADER_LENGTH);
-	return error;
+	slot = &self->rx.queue[(self->rx.queueHead + self->rx.queueCount)
+			% GBEE_RX_QUEUE_SIZE];
+	GBEE_PORT_MEMORY_COPY(slot->frameData, frameData, length);
+	slot->length = length;
+	self->rx.queued[frameData->ident]++;
+	self->rx.queueCount++;
 }
 
 /******************************************************************************/
 
-GBeeError gbeeSendTxRequest16(GBee *self, uint8_t frameId, uint16_t dstAddr16,
-		uint8_t options, uint8_t *data, uint16_t length)
+static bool gbeeQueueTake(GBee *self, const GBeeFrameData **frameData,
+		uint16_t *length)
 {
-	// Error code returned by GBee.
-	GBeeError error = GBEE_NO_ERROR;
-	// 16bit address Tx request parameters.
-	GBeeTxRequest16 txRequest16;
+	// Oldest slot.
+	GBeeRxQueueSlot *slot;
 
-	// Check some pre-conditions.
-	if (self->lastError != GBEE_NO_ERROR)
+	if (self->rx.queueCount == 0)
 	{
-		error = GBEE_INHERITED_ERROR;
+		return false;
 	}
-	GBEE_THROW(error);	
-
-	// Assemble the AT command frame.
-	txRequest16.ident     = GBEE_TX_REQUEST_16;
-	txRequest16.frameId   = frameId;
-	txRequest16.dstAddr16 = GBEE_USHORT(dstAddr16);
-	txRequest16.options   = options;
-	GBEE_PORT_MEMORY_COPY(txRequest16.data, data, length);
 
-	// Send the AT command frame.
-	error = gbeeSend(self, (GBeeFrameData *)&txRequest16, length + GBEE_TX_REQUEST_16_HEADER_LENGTH);
-	return error;
+	slot = &self->rx.queue[self->rx.queueHead];
+	*frameData = (const GBeeFrameData *)slot->frameData;
+	*length    = slot->length;
+	self->rx.queued[(*frameData)->ident]--;
+	self->rx.queueHead = (self->rx.queueHead + 1) % GBEE_RX_QUEUE_SIZE;
+	self->rx.queueCount--;
+	return true;
 }
 
 /******************************************************************************/
 
-GBeeError gbeeSendTxRequest(GBee *self, uint8_t frameId, uint32_t dstAddr64h, 
-		uint32_t dstAddr64l, uint16_t dstAddr16, uint8_t bcastRadius,
-		uint8_t options, uint8_t *data, uint16_t length) {
-
-	// Error code returned by GBee.
-	GBeeError error = GBEE_NO_ERROR;
-	// 16bit address Tx request parameters.
-	GBeeTxRequest txRequest;
+static uint32_t gbeeRemaining(GBeeTime deadline)
+{
+	// Current time.
+	GBeeTime now;
+	// Time left in milliseconds, rounded up.
+	GBeeTime remaining;
 
-	// Check some pre-conditions.
-	if (self->lastError != GBEE_NO_ERROR)
+	if (deadline == GBEE_NO_DEADLINE)
 	{
-		error = GBEE_INHERITED_ERROR;
+		return GBEE_INFINITE_WAIT;
 	}
-	GBEE_THROW(error);
+	now = gbeeClockGet();
+	if (now >= deadline)
+	{
+		return GBEE_NO_WAIT;
+	}
+	remaining = (deadline - now + 999999) / 1000000;
+	if (remaining >= GBEE_INFINITE_WAIT)
+	{
+		return GBEE_INFINITE_WAIT - 1;
+	}
+	return (uint32_t)remaining;
+}
 
-	// Assemble the AT command frame.
-	txRequest.ident      = GBEE_TX_REQUEST;
-	txRequest.frameId    = frameId;
-	txRequest.dstAddr64h = GBEE_ULONG(dstAddr64h);
-	txRequest.dstAddr64l = GBEE_ULONG(dstAddr64l);
-	txRequest.dstAddr16  = GBEE_USHORT(dstAddr16);
-	txRequest.bcastRadius = bcastRadius;
-	txRequest.options    = options;
-	GBEE_PORT_MEMORY_COPY(txRequest.data, data, length);
+/******************************************************************************/
 
-	// Send the AT command frame.
-	error = gbeeSend(self, (GBeeFrameData *)&txRequest, length + GBEE_TX_REQUEST_HEADER_LENGTH);
-	return error;
+static GBeeTime gbeeResponseDeadline(GBeeTime deadline)
+{
+	// Deadline of the response on its own.
+	GBeeTime responseDeadline = gbeeDeadlineAfter(GBEE_AT_RESPONSE_TIMEOUT);
+
+	return (responseDeadline < deadline) ? responseDeadline : deadline;
 }
 
 /******************************************************************************/
 
-GBeeError gbeeXferAtCommand(GBee *self, const char *command, const char *args,
-		uint16_t argLength, char *response, uint16_t *responseLength)
+static GBeeError gbeeProbeApiMode(GBee *self, GBeeMode *mode)
 {
-	// Count bytes transferred.
-	uint16_t byteCount;
-	// Pointer to GBee response.
-	char *responsePtr;
-	// Pointer to GBee's scratch pad.
-	char *scratchPtr = (char*)self->scratch;
-	// Error code returned by XBee.
+	// Outcome of the probe.
+	GBeeProbe probe;
+	// Frame IDs claimed.
+	uint8_t frameIds[GBEE_PROBE_ATTEMPTS];
+	// Number of frame IDs claimed.
+	uint16_t count = 0;
+	// Index of the current frame ID.
+	uint16_t index;
+	// Frame ID of the probe, 0 if none found.
+	uint8_t frameId = 0;
+	// Time to wait for the response at the current baud rate.
+	uint32_t timeout = GBEE_PROBE_TIMEOUT(self->baudRate);
+	// GBee error code.
 	GBeeError error = GBEE_NO_ERROR;
-	
-	// Ensure no transmission for 1 second minimum.
-	gbeeWait(self, 1100);
-	
-	// Write the command sequence.
-	if (GBEE_PORT_UART_SEND_BUFFER(self->serialDevice, (uint8_t*)"+++", 3) != 0)
+
+	probe.done  = false;
+	probe.error = GBEE_NO_ERROR;
+
+	// Claim frame IDs until one needs no escaping.
+	while (count < GBEE_PROBE_ATTEMPTS)
 	{
-		error = GBEE_RS232_ERROR;
+		error = gbeeFrameIdClaim(self, GBEE_AT_COMMAND, timeout,
+				gbeeOnProbeResponse, &probe, &frameIds[count]);
+		if (error != GBEE_NO_ERROR)
+		{
+			break;
+		}
+		if (!gbeeProbeNeedsEscape(frameIds[count++]))
+		{
+			frameId = frameIds[count - 1];
+			break;
+		}
 	}
-	GBEE_THROW(error);	
-	
-	// Wait for the OK.
-	error = gbeeGetResponse(self, self->scratch, &byteCount, GBEE_MAX_FRAME_SIZE,
-			'\r', 2000);
-	GBEE_THROW(error);	
-	
-	if (byteCount >= 3)
+	for (index = 0; index < count; index++)
 	{
-		// command sequence must be answered with "OK\r"
-		if ((self->scratch[byteCount-3] != 'O') 
-				|| (self->scratch[byteCount-2] != 'K') 
-				|| (self->scratch[byteCount-1] != '\r'))
+		if (frameIds[index] != frameId)
 		{
-			GBEE_THROW(GBEE_RESPONSE_ERROR);
+			gbeeFrameIdRelease(self, frameIds[index]);
 		}
 	}
-	else
+	if (frameId == 0)
 	{
-		GBEE_THROW(GBEE_RESPONSE_ERROR);
+		GBEE_THROW((error != GBEE_NO_ERROR) ? error : GBEE_NO_FRAME_ID_ERROR);
 	}
-	
-	// Assemble the AT command.
-	*scratchPtr++ = 'A';
-	*scratchPtr++ = 'T';
-	*scratchPtr++ = command[0];
-	*scratchPtr++ = command[1];
-	if (args != NULL)
+
+	// Send the probe, its response (or timeout) completes it.
+	error = gbeeSendAtCommand(self, frameId, (uint8_t *)"AP", NULL, 0);
+	if (error != GBEE_NO_ERROR)
 	{
-		GBEE_PORT_MEMORY_COPY(scratchPtr, args, argLength);
-		scratchPtr += argLength;
+		gbeeFrameIdRelease(self, frameId);
+		return error;
 	}
-	*scratchPtr++ = '\r';
+	while (!probe.done)
+	{
+		error = gbeeWaitUntilDeadline(self, &probe.done,
+				gbeeDeadlineAfter(timeout));
+		if ((error != GBEE_NO_ERROR) && (error != GBEE_TIMEOUT_ERROR))
+		{
+			// Cancel the probe, the response would outlive us.
+			gbeeFrameIdRelease(self, frameId);
+			return error;
+		}
+	}
+	GBEE_THROW(probe.error);
 
-	// Write the AT command.
-	error = GBEE_PORT_UART_SEND_BUFFER(self->serialDevice, self->scratch,
-			scratchPtr - ((char*)self->scratch));
-	GBEE_THROW(error);
+	if ((probe.status != GBEE_AT_COMMAND_STATUS_OK) || (probe.length != 1)
+			|| ((probe.value != GBEE_MODE_API)
+					&& (probe.value != GBEE_MODE_API_ESCAPED)))
+	{
+		GBEE_THROW(GBEE_MODE_ERROR);
+	}
+	*mode = probe.value;
+	return GBEE_NO_ERROR;
+}
 
-	// Read the response.
-	if (response != NULL)
+/******************************************************************************/
+
+static bool gbeeProbeNeedsEscape(uint8_t frameId)
+{
+	// Bytes of the request and the responses (AP = 1 or 2) to check.
+	uint8_t bytes[4];
+
+	bytes[0] = frameId;
+	bytes[1] = 0xFF - (uint8_t)(GBEE_AT_COMMAND + frameId + 'A' + 'P');
+	bytes[2] = 0xFF - (uint8_t)(GBEE_AT_COMMAND_RESPONSE + frameId + 'A' + 'P'
+			+ GBEE_AT_COMMAND_STATUS_OK + GBEE_MODE_API);
+	bytes[3] = 0xFF - (uint8_t)(GBEE_AT_COMMAND_RESPONSE + frameId + 'A' + 'P'
+			+ GBEE_AT_COMMAND_STATUS_OK + GBEE_MODE_API_ESCAPED);
+	return gbeeKernelFindEscape(bytes, sizeof(bytes)) < sizeof(bytes);
+}
+
+/******************************************************************************/
+
+static void gbeeOnProbeResponse(GBee *self, uint8_t frameId, GBeeError error,
+		const GBeeFrameData *response, uint16_t length, void *context)
+{
+	// Outcome of the probe.
+	GBeeProbe *probe = (GBeeProbe *)context;
+
+	(void)self;
+	(void)frameId;
+	probe->done  = true;
+	probe->error = error;
+	if (error != GBEE_NO_ERROR)
 	{
-		responsePtr = response;
+		return;
 	}
-	else
+	if (length < GBEE_AT_COMMAND_RESPONSE_HEADER_LENGTH)
 	{
-		responsePtr = (char*)self->scratch;
+		probe->error = GBEE_RESPONSE_ERROR;
+		return;
 	}
-		
-	error = gbeeGetResponse(self, (uint8_t*)responsePtr, &byteCount, GBEE_MAX_FRAME_SIZE,
-			'\r', 2000);
-	GBEE_THROW(error);
-		
-	// Check the response and remove all control characters from it.
-	if (byteCount >= 6)
+	probe->status = response->atCommandResponse.status;
+	probe->length = length - GBEE_AT_COMMAND_RESPONSE_HEADER_LENGTH;
+	probe->value  = (probe->length > 0) ? response->atCommandResponse.value[0] : 0;
+}
+
+/******************************************************************************/
+
+static GBeeError gbeeSetBaudRate(GBee *self, uint32_t baudRate)
+{
+	// GBee error code.
+	GBeeError error = GBEE_NO_ERROR;
+
+	if (baudRate != self->baudRate)
 	{
-		if ((responsePtr[byteCount-6] == 'E')
-				&& (responsePtr[byteCount-5] == 'R') 
-				&& (responsePtr[byteCount-4] == 'R')
-				&& (responsePtr[byteCount-3] == 'O')
-				&& (responsePtr[byteCount-2] == 'R') 
-				&& (responsePtr[byteCount-1] == '\r'))
-		{
-			responsePtr[byteCount-6] = 
-			responsePtr[byteCount-5] = 
-			responsePtr[byteCount-4] = 
-			responsePtr[byteCount-3] = 
-			responsePtr[byteCount-2] = 
-			responsePtr[byteCount-1] = 0;
-			byteCount -= 6;
-			GBEE_THROW(GBEE_RESPONSE_ERROR);
-		}
+#ifdef GBEE_PORT_UART_SET_BAUD_RATE
+		error = GBEE_PORT_UART_SET_BAUD_RATE(self->serialDevice, baudRate);
+#else
+		error = GBEE_RS232_ERROR;
+#endif
+		GBEE_THROW(error);
+		self->baudRate = baudRate;
 	}
-	if (byteCount >= 3)
+
+	// Drop bytes possibly garbled by the change, without replaying them.
+	self->rx.head = self->rx.tail;
+	gbeeParserReset(&self->rx.parser);
+	return error;
+}
+
+/******************************************************************************/
+
+static GBeeRegisterCacheEntry *gbeeRegisterCacheFind(GBee *self,
+		const uint8_t *regName)
+{
+	// Index of the current register.
+	uint16_t index;
+
+	for (index = 0; index < GBEE_REGISTER_CACHE_SIZE; index++)
 	{
-		if ((responsePtr[byteCount-3] == 'O')
-				&& (responsePtr[byteCount-2] == 'K') 
-				&& (responsePtr[byteCount-1] == '\r'))
+		if ((gbeeCachedRegisters[index][0] == regName[0])
+				&& (gbeeCachedRegisters[index][1] == regName[1]))
 		{
-			responsePtr[byteCount-3] = 
-			responsePtr[byteCount-2] = 
-			responsePtr[byteCount-1] = 0;
-			byteCount -= 3;
+			return &self->registers[index];
 		}
 	}
+	return NULL;
+}
 
-	if (responseLength != NULL)
+/******************************************************************************/
+
+static uint32_t gbeeRegisterCacheLock(GBeeRegisterCacheEntry *entry)
+{
+	// Sequence number of the entry.
+	uint32_t sequence;
+
+	do
 	{
-		*responseLength = byteCount;
+		sequence = entry->sequence;
 	}
-	
-	// Exit command mode.
-	scratchPtr = (char *)self->scratch;
-	*scratchPtr++ = 'A';
-	*scratchPtr++ = 'T';
-	*scratchPtr++ = 'C';
-	*scratchPtr++ = 'N';
-	*scratchPtr++ = '\r';
-	error = GBEE_PORT_UART_SEND_BUFFER(self->serialDevice, self->scratch, 
-			scratchPtr - ((char *)self->scratch));
-	GBEE_THROW(error);
-	
-	error = gbeeGetResponse(self, self->scratch, &byteCount, GBEE_MAX_FRAME_SIZE,
-			'\r', 2000);
-	GBEE_THROW(error);
+	while ((sequence & 1)
+			|| !gbeeCompareAndSwap(&entry->sequence, sequence, sequence + 1));
+	GBEE_MEMORY_BARRIER();
+	return sequence + 1;
+}
 
-	if (byteCount >= 3)
+/******************************************************************************/
+
+static void gbeeRegisterCacheUnlock(GBeeRegisterCacheEntry *entry,
+		uint32_t sequence)
+{
+	GBEE_MEMORY_BARRIER();
+	entry->sequence = sequence + 1;
+}
+
+/******************************************************************************/
+
+static void gbeeRegisterCacheOnCommand(GBee *self, const uint8_t *atCmd,
+		uint16_t length, bool queued)
+{
+	// Cache entry of the register.
+	GBeeRegisterCacheEntry *entry;
+	// Sequence number of the entry while writing it.
+	uint32_t sequence;
+	// Index of the current entry.
+	uint16_t index;
+
+	// Any AT command frame (e.g. "AC") applies the values queued so far.
+	if (!queued)
 	{
-		// command sequence must be answered with "OK\r"
-		if ((self->scratch[byteCount-3] != 'O') 
-				|| (self->scratch[byteCount-2] != 'K') 
-				|| (self->scratch[byteCount-1] != '\r'))
+		for (index = 0; index < GBEE_REGISTER_CACHE_SIZE; index++)
 		{
-			GBEE_THROW(GBEE_RESPONSE_ERROR);
+			entry = &self->registers[index];
+			if (entry->pending)
+			{
+				sequence = gbeeRegisterCacheLock(entry);
+				entry->pending = false;
+				entry->valid   = false;
+				gbeeRegisterCacheUnlock(entry, sequence);
+			}
 		}
 	}
-	else
+
+	if ((atCmd[0] == 'R') && (atCmd[1] == 'E'))
 	{
-		GBEE_THROW(GBEE_RESPONSE_ERROR);
+		gbeeRegisterCacheInvalidate(self);
+	}
+	else if (length > 0)
+	{
+		entry = gbeeRegisterCacheFind(self, atCmd);
+		if (entry != NULL)
+		{
+			sequence = gbeeRegisterCacheLock(entry);
+			entry->valid   = false;
+			entry->pending = queued;
+			gbeeRegisterCacheUnlock(entry, sequence);
+		}
 	}
-
-	return GBEE_NO_ERROR;
 }
 
 /******************************************************************************/
 
-static GBeeError gbeeGetResponse(GBee *self, uint8_t *response, uint16_t *size,
-		uint16_t maxSize, char stopChar, uint32_t charTimeout)
+static void gbeeRegisterCacheOnFrame(GBee *self,
+		const GBeeFrameData *frameData, uint16_t length)
 {
-	// GBee error code.
-	GBeeError error = GBEE_NO_ERROR;
-	*size = 0;
-	
-	while (1)
+	// Cache entry of the register.
+	GBeeRegisterCacheEntry *entry;
+	// Sequence number of the entry while writing it.
+	uint32_t sequence;
+
+	if ((frameData->ident == GBEE_MODEM_STATUS)
+			&& (length >= sizeof(GBeeModemStatus))
+			&& ((frameData->modemStatus.status
+					== GBEE_MODEM_STATUS_HARDWARE_RESET)
+				|| (frameData->modemStatus.status
+					== GBEE_MODEM_STATUS_WATCHDOG_RESET)))
 	{
-		// Read a byte.
-		error = GBEE_PORT_UART_RECEIVE_BYTE(self->serialDevice, &response[*size],
-				charTimeout);
-		
-		if (error == GBEE_NO_ERROR)
+		gbeeRegisterCacheInvalidate(self);
+	}
+	else if ((frameData->ident == GBEE_AT_COMMAND_RESPONSE)
+			&& (length > GBEE_AT_COMMAND_RESPONSE_HEADER_LENGTH)
+			&& (frameData->atCommandResponse.status
+					== GBEE_AT_COMMAND_STATUS_OK))
+	{
+		// A register with a queued value still answers its old value.
+		entry = gbeeRegisterCacheFind(self,
+				frameData->atCommandResponse.atCommand);
+		length -= GBEE_AT_COMMAND_RESPONSE_HEADER_LENGTH;
+		if ((entry != NULL) && (length <= GBEE_REGISTER_CACHE_VALUE_LENGTH))
 		{
-			// Count the byte.
-			(*size)++;
-			
-			// Got a byte. Check if it is the stop character.
-			if (response[(*size)-1] == stopChar)
-			{
-				error = GBEE_NO_ERROR;
-				break;
-			}
-			
-			// Check if maximum number of bytes received.
-			if (*size >= maxSize)
+			sequence = gbeeRegisterCacheLock(entry);
+			if (!entry->pending)
 			{
-				error = GBEE_NO_ERROR;
-				break;
+				GBEE_PORT_MEMORY_COPY(entry->value,
+						frameData->atCommandResponse.value, length);
+				entry->length = length;
+				entry->valid  = true;
 			}
+			gbeeRegisterCacheUnlock(entry, sequence);
 		}
-		else
+	}
+	else if ((frameData->ident == GBEE_AT_COMMAND_RESPONSE)
+			&& (length == GBEE_AT_COMMAND_RESPONSE_HEADER_LENGTH))
+	{
+		entry = gbeeRegisterCacheFind(self,
+				frameData->atCommandResponse.atCommand);
+		if (entry != NULL)
 		{
-			// Either timeout or serial error.
-			break;
+			sequence = gbeeRegisterCacheLock(entry);
+			entry->valid = false;
+			gbeeRegisterCacheUnlock(entry, sequence);
 		}
 	}
+}
 
-	return error;
+/******************************************************************************/
+
+static bool gbeeIsOkResponse(const uint8_t *response, uint16_t length)
+{
+	// command sequence must be answered with "OK\r"
+	return (length >= 3) && (response[length-3] == 'O')
+			&& (response[length-2] == 'K') && (response[length-1] == '\r');
 }
 
 /******************************************************************************/
 
 static void gbeeWait(GBee *self, uint32_t milliseconds)
 {
-	uint32_t initial_time = GBEE_PORT_TIME_GET();
-	while (GBEE_PORT_TIME_GET() < (initial_time + milliseconds));
+	// End of the delay.
+	GBeeTime deadline = gbeeDeadlineAfter(milliseconds);
+	while (gbeeClockGet() < deadline)
+	{
+#ifdef GBEE_PORT_SLEEP
+		GBEE_PORT_SLEEP(gbeeRemaining(deadline));
+#endif
+	}
 }
 
 /******************************************************************************/
 
-static uint8_t gbeeCalculateChecksum(const uint8_t *frameData, uint8_t length)
+static uint8_t gbeeCalculateChecksum(const GBeeIoVector *fragments,
+		uint16_t count)
 {
 	// GBee 8-bit checksum.
 	uint8_t checksum = 0;
-	// Pointer to current byte.
-	const uint8_t *bytePtr;
+	// Index of the current block.
+	uint16_t index;
 
 	// Add all bytes keeping only the lowest 8 bits of the result and subtract
 	// from 0xFF.
-	for (bytePtr = frameData; bytePtr < (frameData + length); bytePtr++)
+	for (index = 0; index < count; index++)
 	{
-		checksum += *bytePtr;
+		checksum += gbeeKernelSum(fragments[index].data, fragments[index].length);
 	}
 	return 0xFF - checksum;
 }
 
 /******************************************************************************/
 
-static GBeeError gbeeVerifyChecksum(const uint8_t *frameData, uint8_t length, 
+static GBeeError gbeeVerifyChecksum(const uint8_t *frameData, uint16_t length, 
 		uint8_t checksum)
 {
-	// Pointer to current byte.
-	const uint8_t *bytePtr;
-
 	// Add all bytes (include checksum). If the checksum is correct, the sum
 	// will equal 0xFF.
-	for (bytePtr = frameData; bytePtr < (frameData + length); bytePtr++)
+	checksum += gbeeKernelSum(frameData, length);
+	return checksum == 0xFF ? GBEE_NO_ERROR : GBEE_CHECKSUM_ERROR;
+}
+
+/******************************************************************************/
+
+static uint32_t gbeeGetPayloadLength(const GBeeIoVector *fragments,
+		uint16_t count)
+{
+	// Total length of the fragments.
+	uint32_t length = 0;
+	// Index of the current fragment.
+	uint16_t index;
+
+	for (index = 0; index < count; index++)
 	{
-		checksum += *bytePtr;
+		length += fragments[index].length;
 	}
-	return checksum == 0xFF ? GBEE_NO_ERROR : GBEE_CHECKSUM_ERROR;
+	return length;
 }
@@ -13,7 +13,11 @@
  * See \ref build_instructions for building the libgbee from source code.
  *
  * To initialize a connection with the XBee module the gbeeCreate() function
- * has to be called.
+ * has to be called. XBee modules start at 9600 bps, which limits the host
+ * interface to less than 1000 bytes/s; gbeeCreateEx() opens the serial
+ * interface at another baud rate, or detects the baud rate of an XBee in API
+ * mode, and gbeeNegotiateBaud() raises the baud rate of the XBee (BD) and the
+ * serial interface in step.
  *
  * XBee modules provide two basic modes of operation:
  *
@@ -22,6 +26,10 @@
  * <li> API Mode
  * </ul>
  *
+ * API mode comes in two flavours: in API mode 2 (::GBEE_MODE_API_ESCAPED) the
+ * bytes 0x7E, 0x7D, 0x11 and 0x13 are escaped within API frames, so a start
+ * delimiter is never seen inside a frame. The driver supports both.
+ *
  * By default, XBee modules operate in transparent mode, where the XBee
  * operates as a transparent serial interface replacement. In API mode the host
  * communicates with the XBee using so-called API frames. This allows the host
@@ -34,7 +42,10 @@
  * If the XBee is operated in transparent mode, it is still possible to access
  * the configuration and status registers of the XBee module using so-called AT
  * commands. To send AT commands to the XBee module this driver provides the
- * gbeeXferAtCommand() function.
+ * gbeeXferAtCommand() function. Each call enters and leaves command mode,
+ * which takes more than a second due to the guard time. To send several AT
+ * commands, open a session with gbeeCommandModeBegin(), send the commands with
+ * gbeeCommandModeExec() and close the session with gbeeCommandModeEnd().
  *
  * However, the preferred way is to use the XBee module in API mode. In API
  * mode all communication with the module is contained in API frames. The XBee
@@ -56,13 +67,73 @@
  * </ul>
  *
  * To send API frames to the XBee this driver provides the gbeeSend() function.
+ * A queue of frames can be sent with a single write using gbeeSendBatch().
  * To receive API frames from the XBee this driver provides the gbeeReceive()
- * function.
+ * function, which copies the frame, and gbeeReceiveFrame(), which returns a
+ * pointer to the frame within the driver instead.
+ *
+ * Frames can also be received into reference-counted buffers taken from a
+ * pool (see gbee-pool.h and gbeePoolReceive()), which can be held, passed to
+ * another thread or sent again without copying them.
+ *
+ * The payload of a frame is limited by the XBee module (see the NP register).
+ * The driver checks Tx requests against the limit set with
+ * gbeeSetMaxPayloadLength(), gbeeUtilReadMaxPayloadLength() takes it from the
+ * XBee. The limit can never exceed GBEE_MAX_PAYLOAD_LENGTH, the capacity of
+ * the frame buffers chosen at build time.
+ *
+ * Instead of blocking in gbeeReceive(), an application may also watch the
+ * serial interface in its own event loop: gbeeGetFd() provides the handle to
+ * watch, gbeeProcessReadable() passes received frames to the handler set with
+ * gbeeSetFrameHandler(), and in non-blocking mode (see gbeeSetNonBlocking())
+ * gbeeProcessWritable() sends the frames queued by gbeeSend().
+ *
+ * Frames of a given type can also be routed straight to a handler of their
+ * own with gbeeRegisterHandler(), e.g. modem status frames to a status
+ * monitor and Rx packets to the application. Such frames are never returned
+ * by gbeeReceive(), so receive loops need not check for and skip them.
+ *
+ * Applications sending from several threads may leave the serial interface
+ * to the driver mode instead (see gbee-driver.h): gbeeDriverStart() starts an
+ * I/O thread owning the GBee device, gbeeDriverSend() queues frames for it
+ * without taking a lock, and received frames are passed to the consumers
+ * added with gbeeDriverAddConsumer().
+ *
+ * Received data is decoded by an API frame parser (see gbeeParserInit() and
+ * gbeeParserFeed()), which is independent of any I/O and can also be used to
+ * decode API frames from other sources, e.g. a file.
  *
  * For convenience there is also a dedicated send function for each API frame
  * type, namely: gbeeSendAtCommand(), gbeeSendAtCommandQueue(),
  * gbeeSendRemoteAtCommand(), gbeeSendTxRequest64(), gbeeSendTxRequest16()
- * gbeeSendTxRequest().
+ * gbeeSendTxRequest(). The Tx request functions are also available as
+ * scatter-gather variants gbeeSendTxRequest64v(), gbeeSendTxRequest16v() and
+ * gbeeSendTxRequestv(), which take the payload as a list of fragments (e.g.
+ * an application header and the user data), so it never has to be joined into
+ * one contiguous buffer.
+ *
+ * Requests that are answered by the XBee (AT commands, remote AT commands and
+ * Tx requests) should carry a frame ID taken from gbeeFrameIdAlloc(). The
+ * driver keeps them in an in-flight table, so many requests can be
+ * outstanding at once: gbeeFrameIdMatch() tells which request a received
+ * response belongs to, and gbeeFrameIdExpire() reports requests that were not
+ * answered in time.
+ *
+ * Instead of waiting for the response, gbeeSendTxRequestAsync(),
+ * gbeeSendAtCommandAsync() and gbeeSendAtCommandQueueAsync() return right
+ * after sending the request and call a completion handler later on, when the
+ * receiving thread gets the response (the frame is not returned by
+ * gbeeReceive() then) or when the request times out (see
+ * gbeeProcessTimeouts()).
+ *
+ * gbeeWaitUntil() waits for such a completion without losing other frames:
+ * frames received meanwhile are parked in bounded per-type receive queues and
+ * returned by the next receive call.
+ *
+ * Timeouts are kept as deadlines on a monotonic clock (see gbeeClockGet()),
+ * so they do not follow changes of the wall clock. The receive functions and
+ * gbeeXferAtCommand() also come as variants taking an absolute deadline, e.g.
+ * gbeeReceiveFrameDeadline(), for callers with an overall time budget.
  *
  * See section \ref utility_functions for additional utility functions provided
  * by the libgbee.
@@ -74,6 +145,52 @@
  * For more information on the XBee Tunnel Daemon, please refer to the "XBee
  * Tunnel Daemon Reference Manual".
  *
+ * See \ref concurrency for using a GBee device from several threads.
+ *
+ * \page concurrency Concurrency
+ * \section concurrency Concurrency
+ *
+ * The state of a GBee device is split into a receive context and a transmit
+ * context, so one thread may receive frames while another thread sends frames
+ * on the same device, without any locking:
+ *
+ * <ul>
+ * <li> The receiving thread may call gbeeReceive(), gbeeReceiveFrame(),
+ * gbeePoolReceive(), gbeeProcessReadable(), gbeeProcessTimeouts(),
+ * gbeeWaitUntil(), gbeeGetResyncCount() and gbeeGetQueueOverflowCount().
+ * <li> The sending thread may call gbeeSend(), gbeeSendBatch(),
+ * gbeePoolSend(), the gbeeSend...() functions for the API frame types
+ * (including gbeeSendTxRequestAsync() and gbeeSendAtCommandAsync()),
+ * gbeeProcessWritable() and gbeeWritePending().
+ * </ul>
+ *
+ * Each context must be used by one thread at a time: two threads sending on
+ * the same device still have to serialize their calls.
+ *
+ * The in-flight table is shared by both threads: gbeeFrameIdAlloc() and
+ * gbeeFrameIdRelease() may be called by any thread, gbeeFrameIdMatch() and
+ * gbeeFrameIdExpire() by the receiving thread. Completion handlers (see
+ * gbeeSendTxRequestAsync()) are called by the receiving thread. This requires
+ * GBEE_PORT_ATOMIC_CAS, without it the table must be used by a single thread.
+ * The same holds for the register cache: gbeeRegisterCacheGet(),
+ * gbeeRegisterCachePut() and gbeeRegisterCacheInvalidate() may be called by
+ * any thread.
+ *
+ * The following functions touch both contexts or the settings shared by them,
+ * and must not run concurrently with any other call on the device:
+ * gbeeSetMode(), gbeeGetMode(), gbeeXferAtCommand() (command mode uses both
+ * directions of the serial interface), gbeeSetNonBlocking(),
+ * gbeeSetEscaped(), gbeeSetMaxPayloadLength(), gbeeSetFrameHandler(),
+ * gbeeRegisterHandler(), gbeeSetQueueDepth() and
+ * gbeeDestroy(). Call them before starting the sending and receiving threads.
+ *
+ * The port must allow a read and a write on the same serial interface at the
+ * same time (as the Linux port does).
+ *
+ * In driver mode (see gbee-driver.h) the I/O thread is both the receiving and
+ * the sending thread; other threads only call gbeeDriverSend(), which is safe
+ * to call from any number of threads at once.
+ *
  * \page build_instructions Build Instructions
  * \section build_instructions Build Instructions
  *
@@ -160,12 +277,59 @@ extern "C"{
 #error "Must define either GBEE_PORT_LITTLE_ENDIAN or GBEE_PORT_BIG_ENDIAN"
 #endif
 
-/** Maximum length of XBee message payload. */
+#ifndef GBEE_MAX_PAYLOAD_LENGTH
+/** Maximum length of XBee message payload the frame buffers are sized for.
+ * Define it (e.g. -DGBEE_MAX_PAYLOAD_LENGTH=256) to support modules with a
+ * larger NP value (the library and the application must agree on it). The
+ * limit applied to each device is set at run time, see
+ * gbeeSetMaxPayloadLength(). */
 #define GBEE_MAX_PAYLOAD_LENGTH 100
+#endif
 /** Maximum length of XBee API frame. */
 #define GBEE_MAX_FRAME_SIZE     (GBEE_MAX_PAYLOAD_LENGTH + sizeof(GBeeFrameData))
 /** Maximum length of XBee API frame including frame header and trailer. */
 #define GBEE_TOTAL_FRAME_SIZE   (sizeof(GBeeFrameHeader) + GBEE_MAX_FRAME_SIZE + sizeof(GBeeFrameTrailer))
+#ifndef GBEE_RX_BUFFER_SIZE
+/** Size of the per-device receive buffer in bytes (must be a power of two).
+ * A port may define a smaller value in gbee-port.h to save memory. */
+#define GBEE_RX_BUFFER_SIZE     512
+#endif
+#ifndef GBEE_TX_BUFFER_SIZE
+/** Size of the per-device transmit buffer in bytes (must be a power of two).
+ * A port may define a smaller value in gbee-port.h to save memory. */
+#define GBEE_TX_BUFFER_SIZE     1024
+#endif
+
+#if (GBEE_RX_BUFFER_SIZE & (GBEE_RX_BUFFER_SIZE - 1)) || \
+		(GBEE_TX_BUFFER_SIZE & (GBEE_TX_BUFFER_SIZE - 1))
+#error "GBEE_RX_BUFFER_SIZE and GBEE_TX_BUFFER_SIZE must be powers of two"
+#endif
+/** Maximum number of payload fragments passed to gbeeSendTxRequest16v() etc. */
+#define GBEE_MAX_PAYLOAD_FRAGMENTS (GBEE_IO_VECTOR_MAX - 3)
+#ifndef GBEE_MAX_FRAME_IDS
+/** Number of frame IDs handed out by gbeeFrameIdAlloc(), i.e. the maximum
+ * number of requests in flight. IDs range from 1 to GBEE_MAX_FRAME_IDS (at
+ * most 255), define a lower value to save memory on small systems. */
+#define GBEE_MAX_FRAME_IDS 255
+#endif
+
+#if (GBEE_MAX_FRAME_IDS < 1) || (GBEE_MAX_FRAME_IDS > 255)
+#error "GBEE_MAX_FRAME_IDS must be between 1 and 255"
+#endif
+#ifndef GBEE_RX_QUEUE_SIZE
+/** Number of frames the receive queues of a device hold in total, see
+ * gbeeWaitUntil(). */
+#define GBEE_RX_QUEUE_SIZE 8
+#endif
+#ifndef GBEE_RX_QUEUE_DEPTH
+/** Default number of frames of one type the receive queues hold, see
+ * gbeeSetQueueDepth(). */
+#define GBEE_RX_QUEUE_DEPTH 4
+#endif
+
+#if (GBEE_RX_QUEUE_SIZE < 1) || (GBEE_RX_QUEUE_SIZE > 255)
+#error "GBEE_RX_QUEUE_SIZE must be between 1 and 255"
+#endif
 
 /**
  * Enumeration of XBee modes.
@@ -174,7 +338,9 @@ enum gbeeMode {
 	/** XBee operates in transparent mode (i.e. serial interface replacement) */
 	GBEE_MODE_TRANSPARENT = 0,
 	/** XBee operates in API mode. */
-	GBEE_MODE_API = 1
+	GBEE_MODE_API = 1,
+	/** XBee operates in API mode with escaped characters. */
+	GBEE_MODE_API_ESCAPED = 2
 };
 
 /** Type definition for ::gbeeMode. */
@@ -778,6 +944,11 @@ typedef struct gbeeFrame GBeeFrame;
 /** Transmit request broadcast PAN. */
 #define GBEE_TX_BROADCAST_PAN 0x04
 
+/** Modem status indicating a hardware reset. */
+#define GBEE_MODEM_STATUS_HARDWARE_RESET 0
+/** Modem status indicating a watchdog timer reset. */
+#define GBEE_MODEM_STATUS_WATCHDOG_RESET 1
+
 /** Transmission status indicating success. */
 #define GBEE_TX_STATUS_SUCCESS     0
 /** Transmission status indicating no ACK received from remote XBee. */
@@ -798,15 +969,329 @@ typedef struct gbeeFrame GBeeFrame;
 /** Received packet from end device (new protocol). */
 #define GBEE_RX_END_DEVICE 0x04
 
+/** API frame start delimiter. */
+#define GBEE_FRAME_START_DELIMITER 0x7E
+/** Escape character used in API mode 2. */
+#define GBEE_ESCAPE                0x7D
+/** XON character, escaped in API mode 2. */
+#define GBEE_XON                   0x11
+/** XOFF character, escaped in API mode 2. */
+#define GBEE_XOFF                  0x13
+/** Value an escaped character is XOR'ed with in API mode 2. */
+#define GBEE_ESCAPE_XOR            0x20
+
+/**
+ * Enumeration of API frame parser states.
+ */
+enum gbeeParserState {
+	/** Waiting for the frame start delimiter. */
+	GBEE_PARSER_STATE_START,
+	/** Waiting for the MSB of the frame length. */
+	GBEE_PARSER_STATE_LENGTH_MSB,
+	/** Waiting for the LSB of the frame length. */
+	GBEE_PARSER_STATE_LENGTH_LSB,
+	/** Receiving the frame data. */
+	GBEE_PARSER_STATE_DATA,
+	/** Waiting for the frame checksum. */
+	GBEE_PARSER_STATE_CHECKSUM
+};
+
+/** Type definition for ::gbeeParserState. */
+typedef enum gbeeParserState GBeeParserState;
+
+/**
+ * Callback invoked by the API frame parser for each frame parsed.
+ * 
+ * \param[in] context is the context pointer passed to gbeeParserInit().
+ * \param[in] error is GBEE_NO_ERROR for a valid frame, GBEE_FRAME_SIZE_ERROR
+ * if the frame length is zero or exceeds the maximum frame size, or
+ * GBEE_CHECKSUM_ERROR if the frame checksum is invalid.
+ * \param[in] frameData points to the frame data, or NULL in case of an error.
+ * The frame data is only valid until the callback returns.
+ * \param[in] length is the length of the frame data in bytes.
+ * 
+ * \return true to continue parsing, or false to make gbeeParserFeed() return
+ * right after this frame.
+ */
+typedef bool (*GBeeParserCallback)(void *context, GBeeError error,
+		const GBeeFrameData *frameData, uint16_t length);
+
+/** Size of the raw frame buffer of the API frame parser: frame length, frame
+ * data and checksum. */
+#define GBEE_PARSER_BUFFER_SIZE (GBEE_MAX_FRAME_SIZE + 3)
+
+/**
+ * The API frame parser. The parser is resumable: it may be fed with any number
+ * of bytes at a time, frames may span several calls to gbeeParserFeed() and
+ * a single call may contain several frames.
+ *
+ * If a frame turns out to be corrupt (invalid length or checksum), the parser
+ * does not drop the bytes received after its start delimiter. It rescans them
+ * for the next start delimiter and parses them again from there, so a frame
+ * hidden in a truncated one is not lost (see gbeeParserResync()).
+ */
+struct gbeeParser {
+	/** Current parser state. */
+	GBeeParserState state;
+	/** Length of the frame data, taken from the frame header. */
+	uint16_t length;
+	/** Number of bytes received after the start delimiter so far. */
+	uint16_t count;
+	/** Bytes received after the start delimiter: frame length (2 bytes), frame
+	 * data and checksum. */
+	uint8_t frame[GBEE_PARSER_BUFFER_SIZE];
+	/** Bytes of a corrupt frame, to be parsed again. */
+	uint8_t replay[GBEE_PARSER_BUFFER_SIZE];
+	/** Number of bytes in the replay buffer. */
+	uint16_t replayLength;
+	/** Offset of the next byte to parse in the replay buffer. */
+	uint16_t replayOffset;
+	/** Number of times the parser resynchronized within a corrupt frame. */
+	uint32_t resyncCount;
+	/** Tells if the frames are escaped (API mode 2). */
+	bool escaped;
+	/** Tells if the last byte received was the escape character. */
+	bool escapePending;
+	/** Callback invoked for each frame. */
+	GBeeParserCallback callback;
+	/** Context pointer passed to the callback. */
+	void *context;
+};
+
+/** Type definition for ::gbeeParser. */
+typedef struct gbeeParser GBeeParser;
+
+/** Forward declaration of the XBee device driver object. */
+struct gbee;
+
+/**
+ * Handler for API frames received by a GBee device, see gbeeSetFrameHandler()
+ * and gbeeRegisterHandler().
+ * 
+ * \param[in] self is the GBee device the frame was received from.
+ * \param[in] frameData points to the frame data. The frame data is only valid
+ * until the handler returns.
+ * \param[in] length is the length of the frame data in bytes.
+ * \param[in] context is the context pointer passed along with the handler.
+ */
+typedef void (*GBeeFrameHandler)(struct gbee *self, const GBeeFrameData *frameData,
+		uint16_t length, void *context);
+
+/**
+ * Handler called when an asynchronous request completes, see
+ * gbeeSendTxRequestAsync() and gbeeSendAtCommandAsync().
+ * 
+ * \param[in] self is the GBee device the request was sent to.
+ * \param[in] frameId is the frame ID of the request.
+ * \param[in] error is GBEE_NO_ERROR if the response was received, or
+ * GBEE_TIMEOUT_ERROR if the request timed out.
+ * \param[in] response points to the response (a Tx status or AT command
+ * response frame), NULL if the request timed out. The frame data is only valid
+ * until the handler returns.
+ * \param[in] length is the length of the response in bytes.
+ * \param[in] context is the context pointer passed along with the request.
+ */
+typedef void (*GBeeCompletionHandler)(struct gbee *self, uint8_t frameId,
+		GBeeError error, const GBeeFrameData *response, uint16_t length,
+		void *context);
+
+/**
+ * Entry of the dispatch table of a GBee device: the handler for one type of
+ * API frame, see gbeeRegisterHandler().
+ */
+struct gbeeFrameDispatch {
+	/** Handler for the frame type, NULL if none is registered. */
+	GBeeFrameHandler handler;
+	/** Context pointer passed to the handler. */
+	void *context;
+};
+
+/** Type definition for ::gbeeFrameDispatch. */
+typedef struct gbeeFrameDispatch GBeeFrameDispatch;
+
+/**
+ * A frame parked in the receive queues of a GBee device, see gbeeWaitUntil().
+ */
+struct gbeeRxQueueSlot {
+	/** Length of the frame data in bytes. */
+	uint16_t length;
+	/** The frame data. */
+	uint8_t frameData[GBEE_MAX_FRAME_SIZE];
+};
+
+/** Type definition for ::gbeeRxQueueSlot. */
+typedef struct gbeeRxQueueSlot GBeeRxQueueSlot;
+
+/** State of a free in-flight table entry. */
+#define GBEE_FRAME_ID_FREE 0
+/** State of an in-flight table entry holding a request in flight. */
+#define GBEE_FRAME_ID_IN_FLIGHT 1
+/** State of an in-flight table entry being filled in by gbeeFrameIdAlloc(). */
+#define GBEE_FRAME_ID_CLAIMED 2
+
+/**
+ * Entry of the in-flight table of a GBee device: a request waiting for its
+ * response, see gbeeFrameIdAlloc().
+ */
+struct gbeeFrameIdEntry {
+	/** State of the entry: GBEE_FRAME_ID_FREE, GBEE_FRAME_ID_CLAIMED or
+	 * GBEE_FRAME_ID_IN_FLIGHT. */
+	volatile uint32_t inUse;
+	/** API identifier of the request. */
+	uint8_t requestIdent;
+	/** Time (see gbeeClockGet()) the request expires at, GBEE_NO_DEADLINE if
+	 * it never expires. */
+	GBeeTime deadline;
+	/** Context pointer passed to gbeeFrameIdAlloc(). */
+	void *context;
+	/** Completion handler of an asynchronous request, NULL otherwise. */
+	GBeeCompletionHandler completion;
+};
+
+/** Type definition for ::gbeeFrameIdEntry. */
+typedef struct gbeeFrameIdEntry GBeeFrameIdEntry;
+
+/**
+ * In-flight table of a GBee device: the frame IDs in use, indexed by frame ID
+ * minus one.
+ */
+struct gbeeFrameIdTable {
+	/** The requests in flight. */
+	GBeeFrameIdEntry entries[GBEE_MAX_FRAME_IDS];
+	/** Frame ID to try first on the next allocation. */
+	volatile uint8_t nextFrameId;
+};
+
+/** Type definition for ::gbeeFrameIdTable. */
+typedef struct gbeeFrameIdTable GBeeFrameIdTable;
+
+/** Baud rate of the serial interface used by gbeeCreate(), the factory
+ * setting of the XBee (BD = 3). */
+#define GBEE_BAUD_RATE_DEFAULT 9600
+/** Tells gbeeCreateEx() to detect the baud rate of the XBee. */
+#define GBEE_BAUD_RATE_AUTO 0
+
+/** Number of registers kept in the register cache (MY, ID, CH, AP, NP, SH,
+ * SL, DH, DL, CE and BD), see gbeeRegisterCacheGet(). */
+#define GBEE_REGISTER_CACHE_SIZE 11
+
+/** Maximum length of a register value kept in the register cache. */
+#define GBEE_REGISTER_CACHE_VALUE_LENGTH 4
+
+/**
+ * Entry of the register cache of a GBee device: the last value of a register
+ * known to the GBee device. The entry is written by the sending and the
+ * receiving thread; writers take turns with the sequence number, readers use
+ * it to detect a concurrent write (see gbeeRegisterCacheGet()).
+ */
+struct gbeeRegisterCacheEntry {
+	/** Sequence number, odd while the entry is written. */
+	volatile uint32_t sequence;
+	/** Tells if the value is known. */
+	bool valid;
+	/** Tells if a queued value is not applied yet, see
+	 * gbeeSendAtCommandQueue(). */
+	bool pending;
+	/** Length of the value in bytes. */
+	uint8_t length;
+	/** The value, as sent by the XBee (big-endian, without leading zeros). */
+	uint8_t value[GBEE_REGISTER_CACHE_VALUE_LENGTH];
+};
+
+/** Type definition for ::gbeeRegisterCacheEntry. */
+typedef struct gbeeRegisterCacheEntry GBeeRegisterCacheEntry;
+
+/**
+ * Receive context of a GBee device: all state touched while receiving frames.
+ */
+struct gbeeRxContext {
+	/** Receive ring buffer - bytes read from the UART, not yet processed. */
+	uint8_t buffer[GBEE_RX_BUFFER_SIZE];
+	/** Free-running index of the next byte to take from the receive buffer. */
+	uint16_t head;
+	/** Free-running index of the next byte to put into the receive buffer. */
+	uint16_t tail;
+	/** API frame parser fed from the receive buffer. */
+	GBeeParser parser;
+	/** Tells if a gbeeReceiveFrame() call is pending. */
+	bool pending;
+	/** Frame data received by the pending gbeeReceiveFrame() call, points
+	 * into the parser. */
+	const GBeeFrameData *frameData;
+	/** Frame length of the pending gbeeReceiveFrame() call. */
+	uint16_t frameLength;
+	/** Result of the pending gbeeReceiveFrame() call. */
+	GBeeError frameError;
+	/** Tells if the pending gbeeReceiveFrame() call got its frame. */
+	bool frameDone;
+	/** Handler for frames not taken by a gbeeReceive() call. */
+	GBeeFrameHandler handler;
+	/** Context pointer passed to the frame handler. */
+	void *handlerContext;
+	/** Handlers for the frame types, indexed by API identifier. */
+	GBeeFrameDispatch dispatch[256];
+	/** Tells if a gbeeWaitUntil() call parks the frames received. */
+	bool parking;
+	/** Frames parked by gbeeWaitUntil(), in the order received. */
+	GBeeRxQueueSlot queue[GBEE_RX_QUEUE_SIZE];
+	/** Index of the oldest frame parked. */
+	uint8_t queueHead;
+	/** Number of frames parked. */
+	uint8_t queueCount;
+	/** Number of frames parked per type, indexed by API identifier. */
+	uint8_t queued[256];
+	/** Maximum number of frames parked per type, indexed by API identifier. */
+	uint8_t queueDepth[256];
+	/** Number of frames dropped per type because their queue was full. */
+	uint32_t queueOverflow[256];
+};
+
+/** Type definition for ::gbeeRxContext. */
+typedef struct gbeeRxContext GBeeRxContext;
+
+/**
+ * Transmit context of a GBee device: all state touched while sending frames.
+ */
+struct gbeeTxContext {
+	/** Scratch pad - used for gathering a frame if the port cannot send
+	 * vectors. */
+	uint8_t scratch[GBEE_TOTAL_FRAME_SIZE];
+	/** Transmit ring buffer - frames queued in non-blocking mode. */
+	uint8_t buffer[GBEE_TX_BUFFER_SIZE];
+	/** Free-running index of the next byte to take from the transmit buffer. */
+	uint16_t head;
+	/** Free-running index of the next byte to put into the transmit buffer. */
+	uint16_t tail;
+};
+
+/** Type definition for ::gbeeTxContext. */
+typedef struct gbeeTxContext GBeeTxContext;
+
 /**
  * This is the XBee device driver object returned by the gbeeCreate function.
+ * Receiving and sending work on separate contexts, see \ref concurrency.
  */
 struct gbee {
 	/** Serial device descriptor, returned by GBEE_PORT_SERIAL_OPEN. */
 	int serialDevice;
-	/** Scratch pad - used for preparing data transfered to/from XBee. */
-	uint8_t scratch[GBEE_TOTAL_FRAME_SIZE];
-	/** Last error that occurred. */
+	/** State of the receiving thread. */
+	GBeeRxContext rx;
+	/** State of the sending thread. */
+	GBeeTxContext tx;
+	/** Requests in flight, shared by the sending and the receiving thread. */
+	GBeeFrameIdTable frameIds;
+	/** Register cache, written by the sending and the receiving thread. */
+	GBeeRegisterCacheEntry registers[GBEE_REGISTER_CACHE_SIZE];
+	/** Tells if gbeeSend() queues frames instead of blocking. */
+	bool nonBlocking;
+	/** Tells if API frames are escaped (API mode 2). */
+	bool escaped;
+	/** Maximum payload length of Tx requests accepted by the XBee. */
+	uint16_t maxPayloadLength;
+	/** Baud rate of the serial interface. */
+	uint32_t baudRate;
+	/** Last error that occurred. Only set by gbeeCreate(), so it may be read
+	 * by the sending and the receiving thread. */
 	GBeeError lastError;
 };
 
@@ -826,7 +1311,82 @@ typedef struct gbee GBee;
 GBee* gbeeCreate(const char* serialName);
 
 /**
- * Sets the mode of the XBee to either API mode or transparent mode.
+ * Creates a new XBee device, like gbeeCreate(), with the serial interface
+ * running at the given baud rate. With ::GBEE_BAUD_RATE_AUTO, the baud rate is
+ * detected by asking the XBee with an API frame at each baud rate the XBee
+ * supports (see gbeeDetectBaudRate()); if no XBee answers (e.g. because it is
+ * in transparent mode), the serial interface stays at ::GBEE_BAUD_RATE_DEFAULT.
+ * Baud rates other than ::GBEE_BAUD_RATE_DEFAULT require a port supporting
+ * GBEE_PORT_UART_SET_BAUD_RATE.
+ *
+ * \param[in] serialName is the name of the interface (e.g. "/dev/ttyS0").
+ * \param[in] baudRate is the baud rate in bps, or ::GBEE_BAUD_RATE_AUTO.
+ *
+ * \return A pointer to the GBee device if successful, or NULL in case of any
+ * error.
+ */
+GBee* gbeeCreateEx(const char* serialName, uint32_t baudRate);
+
+/**
+ * Provides the baud rate of the serial interface.
+ *
+ * \param[in] self is the XBee device structure.
+ *
+ * \return The baud rate in bps.
+ */
+uint32_t gbeeGetBaudRate(const GBee *self);
+
+/**
+ * Detects the baud rate of an XBee in API mode. The XBee is asked for its
+ * mode with an API frame at each baud rate it supports (BD = 0 to 7), starting
+ * with the current baud rate of the serial interface, then from 115200 bps
+ * downwards. Each attempt takes up to the transfer time of the probe at that
+ * baud rate plus 80 milliseconds (about 230 milliseconds at 1200 bps, 100
+ * milliseconds at 9600 bps). The serial interface is left at the baud rate detected, and the GBee device is switched to
+ * escaped API frames if the XBee uses them (see gbeeSetEscaped()).
+ *
+ * \param[in,out] self is the XBee device structure.
+ * \param[out] baudRate is the baud rate detected.
+ *
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_INHERITED_ERROR to indicate that the call failed due to an
+ * error in an earlier libgbee call.
+ * \retval GBEE_RS232_ERROR to indicate that the port cannot change the baud
+ * rate, or a failure to establish communication with the XBee.
+ * \retval GBEE_MODE_ERROR to indicate that no XBee answered in API mode. The
+ * serial interface is then back at its former baud rate.
+ */
+GBeeError gbeeDetectBaudRate(GBee *self, uint32_t *baudRate);
+
+/**
+ * Changes the baud rate of the XBee (BD register) and the serial interface in
+ * step. The XBee must be in API mode: it answers the AT command at the old
+ * baud rate and switches right after. The new baud rate is then checked with
+ * an API frame; if the XBee does not answer, its baud rate is detected again
+ * (see gbeeDetectBaudRate()). The new baud rate is not written to the
+ * non-volatile memory of the XBee (see WR), so it is lost on reset.
+ *
+ * \param[in,out] self is the XBee device structure.
+ * \param[in] baudRate is the new baud rate: 1200, 2400, 4800, 9600, 19200,
+ * 38400, 57600 or 115200 bps.
+ *
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_INHERITED_ERROR to indicate that the call failed due to an
+ * error in an earlier libgbee call.
+ * \retval GBEE_RS232_ERROR to indicate that the baud rate is not supported
+ * by the XBee or the port, or a failure to establish communication with the
+ * XBee.
+ * \retval GBEE_RESPONSE_ERROR to indicate that the XBee refused the baud
+ * rate, or did not answer at the new baud rate.
+ * \retval GBEE_TIMEOUT_ERROR to indicate that the XBee did not answer the AT
+ * command.
+ */
+GBeeError gbeeNegotiateBaud(GBee *self, uint32_t baudRate);
+
+/**
+ * Sets the mode of the XBee to either API mode (escaped or not) or
+ * transparent mode. The GBee device is switched to escaped API frames
+ * accordingly (see gbeeSetEscaped()).
  * 
  * \param[in,out] self is the XBee device structure.
  * \param[in] mode specifies the mode to set.
@@ -842,7 +1402,13 @@ GBee* gbeeCreate(const char* serialName);
 GBeeError gbeeSetMode(GBee *self, GBeeMode mode);
 
 /**
- * Provides the mode the XBee is operating in.
+ * Provides the mode the XBee is operating in. The GBee device is switched to
+ * escaped API frames accordingly (see gbeeSetEscaped()). The mode is taken
+ * from the register cache if known (see gbeeRegisterCacheGet()). Otherwise
+ * the XBee is first asked with an API frame, which it answers within
+ * milliseconds if it is in API mode, and only if there is no answer the mode
+ * is queried in command mode. Note, that an XBee in transparent mode sends
+ * the bytes of that API frame to its destination address (see DH/DL).
  * 
  * \param[in] self is the XBee device structure.
  * \param[out] mode is the mode the GBee is operating in.
@@ -859,6 +1425,89 @@ GBeeError gbeeSetMode(GBee *self, GBeeMode mode);
  */
 GBeeError gbeeGetMode(GBee *self, GBeeMode *mode);
 
+/**
+ * Initializes an API frame parser.
+ * 
+ * \param[out] self is a pointer to the parser to initialize.
+ * \param[in] callback is invoked for each frame parsed.
+ * \param[in] context is passed to the callback.
+ */
+void gbeeParserInit(GBeeParser *self, GBeeParserCallback callback, void *context);
+
+/**
+ * Resets the API frame parser, i.e. discards any partially parsed frame.
+ * 
+ * \param[in,out] self is a pointer to the parser.
+ */
+void gbeeParserReset(GBeeParser *self);
+
+/**
+ * Discards the partially parsed frame, but keeps its bytes: they are scanned
+ * for the next start delimiter and parsed again from there by the next call
+ * to gbeeParserFeed(). The parser does this on its own for corrupt frames;
+ * call it directly e.g. after a serial communication error.
+ * 
+ * \param[in,out] self is a pointer to the parser.
+ */
+void gbeeParserResync(GBeeParser *self);
+
+/**
+ * Feeds the given bytes into the API frame parser. The callback is invoked for
+ * each complete frame (or frame error). Parsing stops early if the callback
+ * returns false.
+ * 
+ * Bytes kept by gbeeParserResync() are parsed before the given ones, so
+ * length may be 0 to parse just these.
+ * 
+ * \param[in,out] self is a pointer to the parser.
+ * \param[in] bytes points to the data to parse.
+ * \param[in] length is the number of bytes to parse.
+ * 
+ * \return The number of bytes consumed by the parser. This is less than
+ * length only if the callback returned false.
+ */
+uint32_t gbeeParserFeed(GBeeParser *self, const uint8_t *bytes, uint32_t length);
+
+/**
+ * Tells if the API frame parser is in between frames, i.e. if it has no
+ * partially parsed frame.
+ * 
+ * \param[in] self is a pointer to the parser.
+ * 
+ * \return true if the parser waits for a start delimiter and has no bytes to
+ * parse again, false otherwise.
+ */
+bool gbeeParserIdle(const GBeeParser *self);
+
+/**
+ * Enables or disables decoding of escaped API frames (API mode 2). In this
+ * mode a start delimiter within a frame always starts a new frame, the frame
+ * cut short is reported as GBEE_FRAME_INTEGRITY_ERROR.
+ * 
+ * \param[in,out] self is a pointer to the parser.
+ * \param[in] enable is true to decode escaped frames.
+ */
+void gbeeParserSetEscaped(GBeeParser *self, bool enable);
+
+/**
+ * Returns the current time of the monotonic clock all deadlines of the
+ * libgbee refer to (see GBEE_PORT_CLOCK_GET).
+ * 
+ * \return The current time in nanoseconds.
+ */
+GBeeTime gbeeClockGet(void);
+
+/**
+ * Converts a timeout into a deadline.
+ * 
+ * \param[in] timeout specifies a timeout in milliseconds, GBEE_INFINITE_WAIT
+ * for no timeout.
+ * 
+ * \return The point in time the timeout expires at, GBEE_NO_DEADLINE for
+ * GBEE_INFINITE_WAIT.
+ */
+GBeeTime gbeeDeadlineAfter(uint32_t timeout);
+
 /**
  * Read a frame from the XBee and check its validity. This operation calls
  * the serial interface receive operation provided by the port to access the
@@ -875,18 +1524,73 @@ GBeeError gbeeGetMode(GBee *self, GBeeMode *mode);
  * \retval GBEE_NO_ERROR to indicate success.
  * \retval GBEE_INHERITED_ERROR to indicate that the call failed due to an
  * error in an earlier libgbee call.
- * \retval GBEE_TIMEOUT_ERROR to indicate that the timeout expired without any
- * data was received.
+ * \retval GBEE_TIMEOUT_ERROR to indicate that the timeout expired without a
+ * complete frame being received. A partially received frame is kept and
+ * completed by the next call.
  * \retval GBEE_FRAME_INTEGRITY_ERROR to indicate that an incomplete frame was
- * received from the XBee.
+ * received from the XBee due to a serial communication error.
  * \retval GBEE_FRAME_SIZE_ERROR to indicate that the size of the frame
- * received from the XBee exceeds the maximum allowed frame size.
+ * received from the XBee is zero or exceeds the maximum allowed frame size.
  * \retval GBEE_CHECKSUM_ERROR to indicate that the checksum failed for the
  * received frame.
+ *
+ * After an error, the bytes received after the start delimiter of the corrupt
+ * frame are rescanned, so the next call still returns a valid frame contained
+ * in them.
  */
 GBeeError gbeeReceive(GBee *self, GBeeFrameData *frameData, uint16_t *length, 
 		uint32_t *timeout);
 
+/**
+ * Same as gbeeReceive(), but waits until the given deadline instead of for a
+ * timeout. The deadline holds however long the call is kept busy by frames
+ * passed to handlers, so repeated calls with the same deadline never wait
+ * longer in total.
+ * 
+ * \param[in] self is a pointer to the XBee device to read from.
+ * \param[out] frameData points to memory where to store received frame.
+ * \param[out] length is the length of the received frame in bytes.
+ * \param[in] deadline is the point in time (see gbeeClockGet()) to give up
+ * at, GBEE_NO_DEADLINE to wait forever.
+ * 
+ * \return The same error codes as gbeeReceive().
+ */
+GBeeError gbeeReceiveDeadline(GBee *self, GBeeFrameData *frameData,
+		uint16_t *length, GBeeTime deadline);
+
+/**
+ * Read a frame from the XBee without copying it. Works like gbeeReceive(), but
+ * provides a pointer to the frame data held by the driver, so the caller does
+ * not need to reserve a GBeeFrameData buffer.
+ * 
+ * \param[in] self is a pointer to the XBee device to read from.
+ * \param[out] frameData is set to point to the received frame data. The frame
+ * data is valid until the next call receiving data from the XBee (e.g.
+ * gbeeReceive(), gbeeReceiveFrame(), gbeeProcessReadable()).
+ * \param[out] length is the length of the received frame in bytes.
+ * \param[in,out] timeout specifies a timeout in milliseconds, see
+ * gbeeReceive().
+ * 
+ * \return The same error codes as gbeeReceive().
+ */
+GBeeError gbeeReceiveFrame(GBee *self, const GBeeFrameData **frameData,
+		uint16_t *length, uint32_t *timeout);
+
+/**
+ * Same as gbeeReceiveFrame(), but waits until the given deadline instead of
+ * for a timeout, see gbeeReceiveDeadline().
+ * 
+ * \param[in] self is a pointer to the XBee device to read from.
+ * \param[out] frameData is set to point to the received frame data.
+ * \param[out] length is the length of the received frame in bytes.
+ * \param[in] deadline is the point in time to give up at, GBEE_NO_DEADLINE
+ * to wait forever.
+ * 
+ * \return The same error codes as gbeeReceive().
+ */
+GBeeError gbeeReceiveFrameDeadline(GBee *self, const GBeeFrameData **frameData,
+		uint16_t *length, GBeeTime deadline);
+
 /**
  * Send a frame to the XBee. This operation calls the serial interface send
  * operation provided by the port to access the XBee. This operation requires
@@ -903,9 +1607,36 @@ GBeeError gbeeReceive(GBee *self, GBeeFrameData *frameData, uint16_t *length,
  * maximum allowed frame size.
  * \retval GBEE_RS232_ERROR to indicate a failure to establish serial
  * communication with the XBee.
+ * \retval GBEE_WOULD_BLOCK_ERROR to indicate that the transmit buffer is full
+ * (non-blocking mode only).
  */
 GBeeError gbeeSend(GBee *self, GBeeFrameData *frameData, uint16_t dataLength);
 
+/**
+ * Send several frames to the XBee at once. The frames are encoded back to back
+ * into the transmit buffer of the XBee device and sent with as few calls to
+ * the serial interface as possible - a single one, as long as the frames fit
+ * into GBEE_TX_BUFFER_SIZE bytes. This operation requires the XBee to be in
+ * API mode.
+ * 
+ * \param[in] self is a pointer to the XBee device to write to.
+ * \param[in] frames points to the frame data pointers of the frames to write.
+ * \param[in] lengths points to the sizes in bytes of the frame data.
+ * \param[in] count is the number of frames.
+ * 
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_INHERITED_ERROR to indicate that the call failed due to an
+ * error in an earlier libgbee call.
+ * \retval GBEE_FRAME_SIZE_ERROR to indicate that a frame exceeds the maximum
+ * allowed frame size.
+ * \retval GBEE_RS232_ERROR to indicate a failure to establish serial
+ * communication with the XBee.
+ * \retval GBEE_WOULD_BLOCK_ERROR to indicate that the transmit buffer cannot
+ * take all frames (non-blocking mode only). No frame is queued in this case.
+ */
+GBeeError gbeeSendBatch(GBee *self, GBeeFrameData * const *frames,
+		const uint16_t *lengths, uint16_t count);
+
 /**
  * Creates an AT command frame and sends it to the GBee. This operation calls
  * the serial interface send operation provided by the port to access the XBee.
@@ -996,13 +1727,39 @@ GBeeError gbeeSendRemoteAtCommand(GBee *self, uint8_t frameId, uint32_t dstAddr6
  * \retval GBEE_INHERITED_ERROR to indicate that the call failed due to an
  * error in an earlier libgbee call.
  * \retval GBEE_FRAME_SIZE_ERROR to indicate that dataLength exceeds the
- * maximum allowed frame size.
+ * maximum payload length (see gbeeSetMaxPayloadLength()).
  * \retval GBEE_RS232_ERROR to indicate a failure to establish serial
  * communication with the XBee.
  */
 GBeeError gbeeSendTxRequest64(GBee *self, uint8_t frameId, uint32_t dstAddr64h, 
 		uint32_t dstAddr64l, uint8_t options, uint8_t *data, uint16_t length);
 
+/**
+ * Same as gbeeSendTxRequest64(), but takes the data to send as a list of
+ * fragments. The fragments are sent in the given order and are not copied.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * \param[in] frameId is the 8-bit frame identifier.
+ * \param[in] dstAddr64h is the upper half of the 64 bit destination address.
+ * \param[in] dstAddr64l is the lower half of the 64 bit destination address.
+ * \param[in] options contains the transmission flags.
+ * \param[in] fragments points to the fragments of data to send.
+ * \param[in] count is the number of fragments (at most
+ * GBEE_MAX_PAYLOAD_FRAGMENTS).
+ * 
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_INHERITED_ERROR to indicate that the call failed due to an
+ * error in an earlier libgbee call.
+ * \retval GBEE_FRAME_SIZE_ERROR to indicate that the total length of the
+ * fragments exceeds the maximum payload length (see
+ * gbeeSetMaxPayloadLength()), or that there are too many fragments.
+ * \retval GBEE_RS232_ERROR to indicate a failure to establish serial
+ * communication with the XBee.
+ */
+GBeeError gbeeSendTxRequest64v(GBee *self, uint8_t frameId, uint32_t dstAddr64h,
+		uint32_t dstAddr64l, uint8_t options, const GBeeIoVector *fragments,
+		uint16_t count);
+
 /**
  * Creates a Tx Request frame using 16-bit addressing and sends it to the
  * GBee. This operation calls the serial interface send operation provided by
@@ -1020,12 +1777,37 @@ GBeeError gbeeSendTxRequest64(GBee *self, uint8_t frameId, uint32_t dstAddr64h,
  * \retval GBEE_INHERITED_ERROR to indicate that the call failed due to an
  * error in an earlier libgbee call.
  * \retval GBEE_FRAME_SIZE_ERROR to indicate that dataLength exceeds the
- * maximum allowed frame size.
+ * maximum payload length (see gbeeSetMaxPayloadLength()).
  * \retval GBEE_RS232_ERROR to indicate a failure to establish serial
  * communication with the XBee.
  */
 GBeeError gbeeSendTxRequest16(GBee *self, uint8_t frameId, uint16_t dstAddr16,
 		uint8_t options, uint8_t *data, uint16_t length);
+
+/**
+ * Same as gbeeSendTxRequest16(), but takes the data to send as a list of
+ * fragments. The fragments are sent in the given order and are not copied.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * \param[in] frameId is the 8-bit frame identifier.
+ * \param[in] dstAddr16 is the 16 bit destination address.
+ * \param[in] options contains the transmission flags.
+ * \param[in] fragments points to the fragments of data to send.
+ * \param[in] count is the number of fragments (at most
+ * GBEE_MAX_PAYLOAD_FRAGMENTS).
+ * 
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_INHERITED_ERROR to indicate that the call failed due to an
+ * error in an earlier libgbee call.
+ * \retval GBEE_FRAME_SIZE_ERROR to indicate that the total length of the
+ * fragments exceeds the maximum payload length (see
+ * gbeeSetMaxPayloadLength()), or that there are too many fragments.
+ * \retval GBEE_RS232_ERROR to indicate a failure to establish serial
+ * communication with the XBee.
+ */
+GBeeError gbeeSendTxRequest16v(GBee *self, uint8_t frameId, uint16_t dstAddr16,
+		uint8_t options, const GBeeIoVector *fragments, uint16_t count);
+
 /**
  * Creates a Tx Request frame using 64-bit and optional 16-bit addressing 
  * and sends it to the GBee. This operation calls the serial interface send 
@@ -1046,13 +1828,42 @@ GBeeError gbeeSendTxRequest16(GBee *self, uint8_t frameId, uint16_t dstAddr16,
  * \retval GBEE_INHERITED_ERROR to indicate that the call failed due to an
  * error in an earlier libgbee call.
  * \retval GBEE_FRAME_SIZE_ERROR to indicate that dataLength exceeds the
- * maximum allowed frame size.
+ * maximum payload length (see gbeeSetMaxPayloadLength()).
  * \retval GBEE_RS232_ERROR to indicate a failure to establish serial
  * communication with the XBee.
  */
 GBeeError gbeeSendTxRequest(GBee *self, uint8_t frameId, uint32_t dstAddr64h, 
 		uint32_t dstAddr64l, uint16_t dstAddr16, uint8_t bcastRadius,
 		uint8_t options, uint8_t *data, uint16_t length);
+
+/**
+ * Same as gbeeSendTxRequest(), but takes the data to send as a list of
+ * fragments. The fragments are sent in the given order and are not copied.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * \param[in] frameId is the 8-bit frame identifier.
+ * \param[in] dstAddr64h is the upper half of the 64 bit destination address.
+ * \param[in] dstAddr64l is the lower half of the 64 bit destination address.
+ * \param[in] dstAddr16 is the 16 bit destination address.
+ * \param[in] bcastRadius is the maximum number of hops for a broadcast transmission.
+ * \param[in] options contains the transmission flags.
+ * \param[in] fragments points to the fragments of data to send.
+ * \param[in] count is the number of fragments (at most
+ * GBEE_MAX_PAYLOAD_FRAGMENTS).
+ * 
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_INHERITED_ERROR to indicate that the call failed due to an
+ * error in an earlier libgbee call.
+ * \retval GBEE_FRAME_SIZE_ERROR to indicate that the total length of the
+ * fragments exceeds the maximum payload length (see
+ * gbeeSetMaxPayloadLength()), or that there are too many fragments.
+ * \retval GBEE_RS232_ERROR to indicate a failure to establish serial
+ * communication with the XBee.
+ */
+GBeeError gbeeSendTxRequestv(GBee *self, uint8_t frameId, uint32_t dstAddr64h,
+		uint32_t dstAddr64l, uint16_t dstAddr16, uint8_t bcastRadius,
+		uint8_t options, const GBeeIoVector *fragments, uint16_t count);
+
 /**
  * Transfers the given AT command to the XBee and provides the result. This
  * operation requires the XBee to be in transparent mode.
@@ -1076,6 +1887,487 @@ GBeeError gbeeSendTxRequest(GBee *self, uint8_t frameId, uint32_t dstAddr64h,
 GBeeError gbeeXferAtCommand(GBee *self, const char *command, const char *args, 
 		uint16_t argLength, char *response, uint16_t *responseLength);
 
+/**
+ * Same as gbeeXferAtCommand(), but the whole exchange (guard time, command
+ * sequence, AT command and exit from command mode) must complete by the given
+ * deadline, otherwise GBEE_TIMEOUT_ERROR is returned.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * \param[in] command is the command.
+ * \param[in] args are the command arguments as 0-terminated string.
+ * \param[in] argLength is the length of arguments.
+ * \param[out] response is the XBee response (up to GBEE_MAX_FRAME_SIZE bytes).
+ * \param[out] responseLength is the length of the XBee response.
+ * \param[in] deadline is the point in time (see gbeeClockGet()) to give up
+ * at, GBEE_NO_DEADLINE to apply the per-response timeouts only.
+ * 
+ * \return The same error codes as gbeeXferAtCommand(), or GBEE_TIMEOUT_ERROR.
+ */
+GBeeError gbeeXferAtCommandDeadline(GBee *self, const char *command,
+		const char *args, uint16_t argLength, char *response,
+		uint16_t *responseLength, GBeeTime deadline);
+
+/**
+ * Enters command mode, to send several AT commands in one session (see
+ * gbeeCommandModeExec()). This operation requires the XBee to be in
+ * transparent mode. Waits for the guard time, sends the command sequence and
+ * waits for the XBee to acknowledge it.
+ * Note, that the XBee leaves command mode on its own if it does not receive
+ * an AT command within its command mode timeout (see the CT register).
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * \param[in] deadline is the point in time (see gbeeClockGet()) to give up
+ * at, GBEE_NO_DEADLINE to apply the per-response timeout only.
+ * 
+ * \retval GBEE_NO_ERROR to indicate that the XBee is in command mode.
+ * \retval GBEE_RS232_ERROR to indicate a failure to establish serial
+ * communication with the XBee.
+ * \retval GBEE_RESPONSE_ERROR to indicate that the XBee did not acknowledge
+ * the command sequence.
+ * \retval GBEE_TIMEOUT_ERROR to indicate that the XBee did not respond in
+ * time.
+ */
+GBeeError gbeeCommandModeBegin(GBee *self, GBeeTime deadline);
+
+/**
+ * Sends an AT command within a session opened by gbeeCommandModeBegin() and
+ * provides the result. The session stays open if the XBee rejects the
+ * command.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * \param[in] command is the command.
+ * \param[in] args are the command arguments (may be NULL).
+ * \param[in] argLength is the length of arguments.
+ * \param[out] response is the XBee response (up to GBEE_MAX_FRAME_SIZE bytes,
+ * may be NULL).
+ * \param[out] responseLength is the length of the XBee response (may be NULL).
+ * \param[in] deadline is the point in time (see gbeeClockGet()) to give up
+ * at, GBEE_NO_DEADLINE to apply the per-response timeout only.
+ * 
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_FRAME_SIZE_ERROR to indicate that the arguments are too long.
+ * \retval GBEE_RS232_ERROR to indicate a failure to establish serial
+ * communication with the XBee.
+ * \retval GBEE_RESPONSE_ERROR to indicate that the XBee replied with an error
+ * code.
+ * \retval GBEE_TIMEOUT_ERROR to indicate that the XBee did not respond in
+ * time.
+ */
+GBeeError gbeeCommandModeExec(GBee *self, const char *command,
+		const char *args, uint16_t argLength, char *response,
+		uint16_t *responseLength, GBeeTime deadline);
+
+/**
+ * Leaves command mode, closing a session opened by gbeeCommandModeBegin().
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * \param[in] deadline is the point in time (see gbeeClockGet()) to give up
+ * at, GBEE_NO_DEADLINE to apply the per-response timeout only.
+ * 
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_RS232_ERROR to indicate a failure to establish serial
+ * communication with the XBee.
+ * \retval GBEE_RESPONSE_ERROR to indicate that the XBee did not acknowledge
+ * the command.
+ * \retval GBEE_TIMEOUT_ERROR to indicate that the XBee did not respond in
+ * time.
+ */
+GBeeError gbeeCommandModeEnd(GBee *self, GBeeTime deadline);
+
+/**
+ * Provides the handle of the serial interface the XBee is connected to, so the
+ * GBee device can be watched by an application's own event loop (e.g. using
+ * poll or epoll). On Linux this is the file descriptor of the TTY.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * 
+ * \return The port-dependent handle of the serial interface.
+ */
+int gbeeGetFd(GBee *self);
+
+/**
+ * Sets the handler for received API frames. The handler is called by
+ * gbeeProcessReadable() for each frame received. Frames received while a
+ * gbeeReceive() call is pending are returned by that call instead.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * \param[in] handler is the frame handler, or NULL to drop the frames.
+ * \param[in] context is passed to the frame handler.
+ */
+void gbeeSetFrameHandler(GBee *self, GBeeFrameHandler handler, void *context);
+
+/**
+ * Registers the handler for received API frames of the given type. Frames of
+ * that type are passed to the handler as soon as they are received, by
+ * whichever of gbeeReceive(), gbeeReceiveFrame(), gbeePoolReceive() or
+ * gbeeProcessReadable() is running, and are never returned by a receive
+ * call nor passed to the handler set with gbeeSetFrameHandler(). Responses to
+ * asynchronous requests (see gbeeSendTxRequestAsync()) still go to their
+ * completion handlers.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * \param[in] ident is the API identifier of the frame type, e.g.
+ * GBEE_MODEM_STATUS or GBEE_RX_PACKET_16.
+ * \param[in] handler is the frame handler, or NULL to unregister it.
+ * \param[in] context is passed to the frame handler.
+ */
+void gbeeRegisterHandler(GBee *self, uint8_t ident, GBeeFrameHandler handler,
+		void *context);
+
+/**
+ * Enables or disables non-blocking mode. In non-blocking mode gbeeSend() (and
+ * all functions sending API frames) queue the frame in the transmit buffer of
+ * the GBee device and return without waiting for the serial interface. Queued
+ * data is sent by gbeeProcessWritable(). Only disable non-blocking mode when
+ * gbeeWritePending() returns false.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * \param[in] enable is true to enable non-blocking mode.
+ */
+void gbeeSetNonBlocking(GBee *self, bool enable);
+
+/**
+ * Enables or disables escaped API frames (API mode 2) for sending and
+ * receiving. This is done by gbeeSetMode() and gbeeGetMode(), so it is only
+ * needed if the mode of the XBee is known by other means.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * \param[in] enable is true if the XBee operates in API mode 2.
+ */
+void gbeeSetEscaped(GBee *self, bool enable);
+
+/**
+ * Reads all data available from the serial interface without blocking and
+ * passes each complete API frame to the frame handler. Call this function
+ * whenever the handle returned by gbeeGetFd() becomes readable.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * 
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_INHERITED_ERROR to indicate that the call failed due to an
+ * error in an earlier libgbee call.
+ * \retval GBEE_RS232_ERROR to indicate a serial communication error.
+ */
+GBeeError gbeeProcessReadable(GBee *self);
+
+/**
+ * Sends as much of the queued data as possible without blocking. Call this
+ * function whenever the handle returned by gbeeGetFd() becomes writable and
+ * gbeeWritePending() returns true.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * 
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_INHERITED_ERROR to indicate that the call failed due to an
+ * error in an earlier libgbee call.
+ * \retval GBEE_RS232_ERROR to indicate a serial communication error.
+ */
+GBeeError gbeeProcessWritable(GBee *self);
+
+/**
+ * Tells if there is queued data waiting to be sent in non-blocking mode.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * 
+ * \return true if data is pending, i.e. the application should wait for the
+ * serial interface to become writable.
+ */
+bool gbeeWritePending(const GBee *self);
+
+/**
+ * Returns the number of times the XBee device resynchronized to a start
+ * delimiter found within a corrupt frame (see gbeeParserResync()).
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * 
+ * \return The number of resynchronizations since the device was created.
+ */
+uint32_t gbeeGetResyncCount(const GBee *self);
+
+/**
+ * Sets the maximum payload length of Tx requests accepted by the XBee (the
+ * value of its NP register). Larger Tx requests are rejected with
+ * GBEE_FRAME_SIZE_ERROR. The default is GBEE_MAX_PAYLOAD_LENGTH.
+ * 
+ * \param[in,out] self is a pointer to the XBee device.
+ * \param[in] length is the maximum payload length in bytes. It is limited to
+ * GBEE_MAX_PAYLOAD_LENGTH.
+ */
+void gbeeSetMaxPayloadLength(GBee *self, uint16_t length);
+
+/**
+ * Returns the maximum payload length of Tx requests sent to the XBee device.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * 
+ * \return The maximum payload length in bytes.
+ */
+uint16_t gbeeGetMaxPayloadLength(const GBee *self);
+
+/**
+ * Allocates a frame ID for a request and enters the request into the in-flight
+ * table of the XBee device. Frame IDs are handed out round-robin, so an ID is
+ * not reused right after it was released. Put the frame ID into the request
+ * frame, its response is then recognized by gbeeFrameIdMatch().
+ * 
+ * \param[in,out] self is a pointer to the XBee device.
+ * \param[in] requestIdent is the API identifier of the request, e.g.
+ * GBEE_AT_COMMAND or GBEE_TX_REQUEST_16.
+ * \param[in] timeout specifies the time in milliseconds after which the
+ * request is reported by gbeeFrameIdExpire(), GBEE_INFINITE_WAIT if it never
+ * expires.
+ * \param[in] context is returned by gbeeFrameIdMatch() for the response.
+ * \param[out] frameId is the frame ID allocated (1 to GBEE_MAX_FRAME_IDS).
+ * 
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_NO_FRAME_ID_ERROR to indicate that all frame IDs are in use.
+ */
+GBeeError gbeeFrameIdAlloc(GBee *self, uint8_t requestIdent, uint32_t timeout,
+		void *context, uint8_t *frameId);
+
+/**
+ * Releases a frame ID without waiting for the response, e.g. because the
+ * request could not be sent. Releasing the frame ID of an asynchronous
+ * request cancels it: its completion handler is not called.
+ * 
+ * \param[in,out] self is a pointer to the XBee device.
+ * \param[in] frameId is the frame ID returned by gbeeFrameIdAlloc().
+ */
+void gbeeFrameIdRelease(GBee *self, uint8_t frameId);
+
+/**
+ * Checks if the given frame is the response to a request in flight: a Tx
+ * status (to a Tx request), an AT command response (to an AT command or AT
+ * command queue frame) or a remote AT command response (to a remote AT
+ * command). If so, the frame ID is released. Responses to asynchronous
+ * requests are taken by the receiving thread before, so they never match.
+ * 
+ * \param[in,out] self is a pointer to the XBee device.
+ * \param[in] frameData points to the frame received.
+ * \param[in] length is the length of the frame data in bytes.
+ * \param[out] context is set to the context pointer of the request, may be
+ * NULL.
+ * 
+ * \return true if the frame is the response to a request in flight, false
+ * otherwise.
+ */
+bool gbeeFrameIdMatch(GBee *self, const GBeeFrameData *frameData,
+		uint16_t length, void **context);
+
+/**
+ * Takes a request from the in-flight table whose deadline has passed, and
+ * releases its frame ID. Call it repeatedly until it returns false.
+ * Asynchronous requests are not reported, see gbeeProcessTimeouts().
+ * 
+ * \param[in,out] self is a pointer to the XBee device.
+ * \param[out] frameId is the frame ID of the expired request.
+ * \param[out] context is set to the context pointer of the request, may be
+ * NULL.
+ * 
+ * \return true if an expired request was found, false otherwise.
+ */
+bool gbeeFrameIdExpire(GBee *self, uint8_t *frameId, void **context);
+
+/**
+ * Returns the number of requests in flight.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * 
+ * \return The number of frame IDs in use.
+ */
+uint16_t gbeeFrameIdGetInFlight(const GBee *self);
+
+/**
+ * Sends a Tx request without waiting for its Tx status. A frame ID is
+ * allocated and put into the request; when the Tx status arrives, the
+ * receiving thread calls the completion handler with it instead of returning
+ * it from gbeeReceive().
+ * 
+ * \param[in,out] self is a pointer to the XBee device.
+ * \param[in,out] frameData is a Tx request frame (GBEE_TX_REQUEST_64,
+ * GBEE_TX_REQUEST_16 or GBEE_TX_REQUEST), its frame ID is overwritten.
+ * \param[in] length is the size in bytes of the frame data.
+ * \param[in] timeout specifies the time in milliseconds after which the
+ * completion handler is called with GBEE_TIMEOUT_ERROR, GBEE_INFINITE_WAIT if
+ * the request never times out.
+ * \param[in] handler is called with the Tx status (GBeeTxStatus or
+ * GBeeTxStatusNew).
+ * \param[in] context is passed to the completion handler.
+ * \param[out] frameId is set to the frame ID of the request, may be NULL.
+ * 
+ * \retval GBEE_NO_ERROR to indicate that the request was sent.
+ * \retval GBEE_INHERITED_ERROR to indicate that gbeeCreate() failed.
+ * \retval GBEE_FRAME_SIZE_ERROR to indicate that the frame is too short or
+ * too long.
+ * \retval GBEE_NO_FRAME_ID_ERROR to indicate that all frame IDs are in use.
+ * \retval GBEE_RS232_ERROR to indicate that the request could not be sent.
+ * In case of an error the completion handler is never called.
+ */
+GBeeError gbeeSendTxRequestAsync(GBee *self, GBeeFrameData *frameData,
+		uint16_t length, uint32_t timeout, GBeeCompletionHandler handler,
+		void *context, uint8_t *frameId);
+
+/**
+ * Sends an AT command without waiting for the response. Works like
+ * gbeeSendTxRequestAsync(), the completion handler is called with the AT
+ * command response (GBeeAtCommandResponse).
+ * 
+ * \param[in,out] self is a pointer to the XBee device.
+ * \param[in] atCmd is the two-character AT command.
+ * \param[in] value is the AT command value, may be NULL to query a register.
+ * \param[in] length is the length of the AT command value.
+ * \param[in] timeout specifies the time in milliseconds after which the
+ * completion handler is called with GBEE_TIMEOUT_ERROR, GBEE_INFINITE_WAIT if
+ * the request never times out.
+ * \param[in] handler is called with the AT command response.
+ * \param[in] context is passed to the completion handler.
+ * \param[out] frameId is set to the frame ID of the request, may be NULL.
+ * 
+ * \return GBEE_NO_ERROR if successful, or dedicated error code in case of an
+ * error, see gbeeSendTxRequestAsync().
+ */
+GBeeError gbeeSendAtCommandAsync(GBee *self, uint8_t *atCmd, uint8_t *value,
+		uint16_t length, uint32_t timeout, GBeeCompletionHandler handler,
+		void *context, uint8_t *frameId);
+
+/**
+ * Sends an AT command - queue parameter value without waiting for the
+ * response. The value is only applied by a later AT command (e.g. "AC"), so
+ * several registers can be changed at once. Works like
+ * gbeeSendAtCommandAsync().
+ * 
+ * \param[in,out] self is a pointer to the XBee device.
+ * \param[in] atCmd is the two-character AT command.
+ * \param[in] value is the AT command value, may be NULL to query a register.
+ * \param[in] length is the length of the AT command value.
+ * \param[in] timeout specifies the time in milliseconds after which the
+ * completion handler is called with GBEE_TIMEOUT_ERROR, GBEE_INFINITE_WAIT if
+ * the request never times out.
+ * \param[in] handler is called with the AT command response.
+ * \param[in] context is passed to the completion handler.
+ * \param[out] frameId is set to the frame ID of the request, may be NULL.
+ * 
+ * \return GBEE_NO_ERROR if successful, or dedicated error code in case of an
+ * error, see gbeeSendTxRequestAsync().
+ */
+GBeeError gbeeSendAtCommandQueueAsync(GBee *self, uint8_t *atCmd,
+		uint8_t *value, uint16_t length, uint32_t timeout,
+		GBeeCompletionHandler handler, void *context, uint8_t *frameId);
+
+/**
+ * Receives frames until the given flag is set, typically by a completion
+ * handler (see gbeeSendAtCommandAsync()), or the timeout expires. Frames that
+ * would be returned by a receive call are not dropped meanwhile, but parked
+ * in the receive queues of the device: the next calls of gbeeReceive(),
+ * gbeeReceiveFrame() and gbeePoolReceive() return them in the order
+ * received, gbeeProcessReadable() passes them to the frame handler. Frames
+ * beyond the queue depth of their type (see gbeeSetQueueDepth()) or beyond
+ * GBEE_RX_QUEUE_SIZE in total are dropped and counted.
+ * 
+ * \param[in,out] self is a pointer to the XBee device.
+ * \param[in] done is the flag to wait for.
+ * \param[in,out] timeout specifies the time to wait in milliseconds, it is
+ * set to the remaining time on return.
+ * 
+ * \retval GBEE_NO_ERROR to indicate that the flag is set.
+ * \retval GBEE_INHERITED_ERROR to indicate that gbeeCreate() failed.
+ * \retval GBEE_TIMEOUT_ERROR to indicate that the flag was not set in time.
+ * \retval GBEE_RS232_ERROR to indicate a serial communication error.
+ */
+GBeeError gbeeWaitUntil(GBee *self, const volatile bool *done,
+		uint32_t *timeout);
+
+/**
+ * Same as gbeeWaitUntil(), but waits until the given deadline instead of for
+ * a timeout.
+ * 
+ * \param[in,out] self is a pointer to the XBee device.
+ * \param[in] done is the flag to wait for.
+ * \param[in] deadline is the point in time (see gbeeClockGet()) to give up
+ * at, GBEE_NO_DEADLINE to wait forever.
+ * 
+ * \return The same error codes as gbeeWaitUntil().
+ */
+GBeeError gbeeWaitUntilDeadline(GBee *self, const volatile bool *done,
+		GBeeTime deadline);
+
+/**
+ * Sets the number of frames of the given type the receive queues hold, see
+ * gbeeWaitUntil(). The default is GBEE_RX_QUEUE_DEPTH for all types.
+ * 
+ * \param[in,out] self is a pointer to the XBee device.
+ * \param[in] ident is the API identifier of the frame type.
+ * \param[in] depth is the number of frames, 0 to drop all frames of the type
+ * while waiting.
+ */
+void gbeeSetQueueDepth(GBee *self, uint8_t ident, uint8_t depth);
+
+/**
+ * Returns the number of frames of the given type dropped by gbeeWaitUntil()
+ * because the receive queues were full.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * \param[in] ident is the API identifier of the frame type.
+ * 
+ * \return The number of frames dropped.
+ */
+uint32_t gbeeGetQueueOverflowCount(const GBee *self, uint8_t ident);
+
+/**
+ * Provides the cached value of a register, so it need not be queried from the
+ * XBee. The cache holds configuration registers only (see
+ * GBEE_REGISTER_CACHE_SIZE). Values are cached when they are seen in AT
+ * command responses or set by gbeeRegisterCachePut(); sending an AT command
+ * that changes a register invalidates its value, and a modem status frame
+ * reporting a hardware or watchdog reset invalidates all values. A register
+ * with a queued value (see gbeeSendAtCommandQueue()) is not cached until the
+ * value is applied, by "AC" or any other AT command frame.
+ * Note, that the cache cannot notice changes made while the GBee device does
+ * not receive API frames, e.g. a reset in transparent mode; call
+ * gbeeRegisterCacheInvalidate() in such cases.
+ * 
+ * \param[in] self is a pointer to the XBee device.
+ * \param[in] regName is the name of the register.
+ * \param[out] value is set to the register value (big-endian, without leading
+ * zeros).
+ * \param[out] length is set to the length of the value.
+ * \param[in] maxLength is the size of the value buffer.
+ * 
+ * \return true if the value is cached (and fits into the buffer), false
+ * otherwise.
+ */
+bool gbeeRegisterCacheGet(GBee *self, const char *regName, uint8_t *value,
+		uint16_t *length, uint16_t maxLength);
+
+/**
+ * Stores a register value in the register cache, e.g. after writing it.
+ * Values of registers not held by the cache, or too long, are ignored.
+ * 
+ * \param[in,out] self is a pointer to the XBee device.
+ * \param[in] regName is the name of the register.
+ * \param[in] value is the register value (big-endian).
+ * \param[in] length is the length of the value.
+ */
+void gbeeRegisterCachePut(GBee *self, const char *regName,
+		const uint8_t *value, uint16_t length);
+
+/**
+ * Invalidates all values of the register cache.
+ * 
+ * \param[in,out] self is a pointer to the XBee device.
+ */
+void gbeeRegisterCacheInvalidate(GBee *self);
+
+/**
+ * Calls the completion handlers of the asynchronous requests that timed out.
+ * This is done by gbeeReceiveFrame() and gbeeProcessReadable() already;
+ * applications waiting for events themselves should call it when their wait
+ * times out.
+ * 
+ * \param[in,out] self is a pointer to the XBee device.
+ */
+void gbeeProcessTimeouts(GBee *self);
+
 /**
  * Closes the serial interface the XBee is connected to by calling the close
  * operation provided by the port.
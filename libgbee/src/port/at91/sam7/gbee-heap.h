@@ -39,8 +39,9 @@ extern "C"{
 #include <stdint.h>
 #include <stdbool.h>
 
-/** The size of the heap in bytes. */
-#define GBEE_HEAP_LENGTH 256
+/** The size of the heap in bytes, it must hold the GBee device structure
+ * (about 6 KB with the buffer sizes set in gbee-port.h). */
+#define GBEE_HEAP_LENGTH 8192
 
 /**
  * Allocate a block of memory from the heap.
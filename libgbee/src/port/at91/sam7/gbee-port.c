@@ -42,6 +42,14 @@ GBeeError gbeePortUsartSendBuffer(int deviceIndex, const uint8_t *buffer,
 
 /******************************************************************************/
 
+GBeeError gbeePortUsartSetBaudRate(int deviceIndex, uint32_t baudRate)
+{
+	gbeeUsartSetBaudRate(deviceIndex, baudRate);
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
 GBeeError gbeePortUsartReceiveByte(int deviceIndex, uint8_t *byte, uint32_t timeout)
 {
 	/* Wait until there is a byte available, or timeout elapsed. */
@@ -56,3 +64,24 @@ GBeeError gbeePortUsartReceiveByte(int deviceIndex, uint8_t *byte, uint32_t time
 	while (!gbeeTickTimeoutExpired(absTimeout) || (timeout == GBEE_INFINITE_WAIT));
 	return GBEE_TIMEOUT_ERROR;
 }
+
+/******************************************************************************/
+
+GBeeError gbeePortUsartReceiveBuffer(int deviceIndex, uint8_t *buffer,
+		uint32_t maxLength, uint32_t *length, uint32_t timeout)
+{
+	/* Wait for the first byte. */
+	*length = 0;
+	if (gbeePortUsartReceiveByte(deviceIndex, buffer, timeout) != GBEE_NO_ERROR)
+	{
+		return GBEE_TIMEOUT_ERROR;
+	}
+
+	/* Drain whatever else the DMA has already put into the queue. */
+	do
+	{
+		(*length)++;
+	}
+	while ((*length < maxLength) && gbeeUsartByteGet(deviceIndex, &buffer[*length]));
+	return GBEE_NO_ERROR;
+}
@@ -125,6 +125,19 @@ extern "C"{
 #define GBEE_PORT_LITTLE_ENDIAN
 #undef  GBEE_PORT_BIG_ENDIAN
 
+/** Receive buffer of the SAM7. The GBee device structure is allocated from
+ * the static heap (see GBEE_HEAP_LENGTH), so the buffers and tables are kept
+ * small. */
+#define GBEE_RX_BUFFER_SIZE 128
+/** Transmit buffer of the SAM7, holds one escaped frame. */
+#define GBEE_TX_BUFFER_SIZE 256
+/** Requests in flight on the SAM7. */
+#define GBEE_MAX_FRAME_IDS  8
+/** Frames parked by gbeeWaitUntil() on the SAM7. */
+#define GBEE_RX_QUEUE_SIZE  2
+/** Frames of one type parked by gbeeWaitUntil() on the SAM7. */
+#define GBEE_RX_QUEUE_DEPTH 1
+
 /**
  * Transmits the given buffer on the USART specified by the device index.
  * 
@@ -137,6 +150,16 @@ extern "C"{
 GBeeError gbeePortUsartSendBuffer(int deviceIndex, const uint8_t *buffer, 
 		uint16_t length);
 
+/**
+ * Changes the baud rate of the USART specified by the device index.
+ * 
+ * \param[in] deviceIndex is the GBee/USART connection index.
+ * \param[in] baudRate is the new baud rate.
+ * 
+ * \return GBEE_NO_ERROR.
+ */
+GBeeError gbeePortUsartSetBaudRate(int deviceIndex, uint32_t baudRate);
+
 /**
  * Receives a byte from the USART specified by the device index.
  * 
@@ -148,14 +171,35 @@ GBeeError gbeePortUsartSendBuffer(int deviceIndex, const uint8_t *buffer,
  */
 GBeeError gbeePortUsartReceiveByte(int deviceIndex, uint8_t *byte, uint32_t timeout);
 
+/**
+ * Receives all bytes available from the USART specified by the device index,
+ * up to the given maximum. Waits until at least one byte is available or the
+ * timeout expired.
+ * 
+ * \param[in] deviceIndex is the GBee/USART connection index.
+ * \param[out] buffer points to the received bytes.
+ * \param[in] maxLength is the maximum number of bytes to receive.
+ * \param[out] length is the number of bytes received.
+ * \param[in] timeout is a timeout in milliseconds.
+ * 
+ * \return GBEE_NO_ERROR or GBEE_TIMEOUT_ERROR.
+ */
+GBeeError gbeePortUsartReceiveBuffer(int deviceIndex, uint8_t *buffer,
+		uint32_t maxLength, uint32_t *length, uint32_t timeout);
+
 /** This macro is used by the GBee driver to connect to the UART. */
 #define GBEE_PORT_UART_CONNECT gbeeUsartEnable
 /** This macro is used by the GBee driver to disconnect from the UART. */
 #define GBEE_PORT_UART_DISCONNECT gbeeUsartDisable
+/** This macro is used by the GBee driver to change the baud rate of the UART. */
+#define GBEE_PORT_UART_SET_BAUD_RATE gbeePortUsartSetBaudRate
 /** This macro is used by the GBee driver to send a buffer via the UART. */
 #define GBEE_PORT_UART_SEND_BUFFER gbeePortUsartSendBuffer
 /** This macro is used by the GBee driver to receive a byte from the UART. */
 #define GBEE_PORT_UART_RECEIVE_BYTE gbeePortUsartReceiveByte
+/** This macro is used by the GBee driver to receive a block of data from the
+ * UART. */
+#define GBEE_PORT_UART_RECEIVE_BUFFER gbeePortUsartReceiveBuffer
 /** This macro is used by the GBee driver to allocate a block of memory. */
 #define GBEE_PORT_MEMORY_ALLOC gbeeHeapAllocate
 /** This macro is used by the GBee driver to free an allocated block of memory.
@@ -166,6 +210,8 @@ GBeeError gbeePortUsartReceiveByte(int deviceIndex, uint8_t *byte, uint32_t time
 #define GBEE_PORT_MEMORY_COPY memcpy
 /** This macro is used by the GBee driver to get current system time. */
 #define GBEE_PORT_TIME_GET gbeeTickGet
+/** This macro is used by the GBee driver to sleep without using the CPU. */
+#define GBEE_PORT_SLEEP gbeeTickSleep
 /** This macro is used by the GBee driver to print debug messages.
  * If this macro is undefined, the GBee driver will not try to print debug
  * messages. */
@@ -25,9 +25,10 @@
  */
 
 #include "gbee-tick.h"
+#include "board.h"
 
 /** This is our tick counter. */
-static uint32_t ticks = 0;
+static volatile uint32_t ticks = 0;
 
 /******************************************************************************/
 
@@ -63,3 +64,15 @@ bool gbeeTickTimeoutExpired(uint32_t timeout)
 		return false;
 	}
 }
+
+/******************************************************************************/
+
+void gbeeTickSleep(uint32_t period)
+{
+	uint32_t timeout = gbeeTickTimeoutCalculate(period);
+	while (!gbeeTickTimeoutExpired(timeout))
+	{
+		/* Idle until the next interrupt. */
+		AT91C_BASE_PMC->PMC_SCDR = AT91C_PMC_PCK;
+	}
+}
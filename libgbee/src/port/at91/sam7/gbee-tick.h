@@ -65,6 +65,14 @@ uint32_t gbeeTickTimeoutCalculate(uint32_t period);
  */
 bool gbeeTickTimeoutExpired(uint32_t timeout);
 
+/**
+ * Sleep for the given period. The processor clock is switched off until the
+ * next interrupt (at least the tick interrupt) in the meantime.
+ *
+ * \param[in] period is the time to sleep in milliseconds.
+ */
+void gbeeTickSleep(uint32_t period);
+
 #endif /* GBEE_TICK_H_INCLUDED */
 
 #ifdef __cplusplus
@@ -138,6 +138,24 @@ void gbeeUsartDisable(int deviceIndex)
 
 /******************************************************************************/
 
+void gbeeUsartSetBaudRate(int deviceIndex, uint32_t baudRate)
+{
+	/* Get a shortcut to the USART. */
+	GBeeUsart *usart = &usartTable[deviceIndex];
+
+	/* Wait until the DMA transfer and the last character are sent. */
+	while ((usart->device->base->US_TCR > 0)
+			|| !(usart->device->base->US_CSR & AT91C_US_TXEMPTY))
+	{
+		/* Keep waiting... */
+	}
+
+	/* Set the baud rate generator, the USART keeps running. */
+	usart->device->base->US_BRGR = (BOARD_MCK / baudRate) / 16;
+}
+
+/******************************************************************************/
+
 void gbeeUsartBufferPut(int deviceIndex, const uint8_t *buffer, uint16_t length)
 {
 	/* Get a shortcut to the USART. */
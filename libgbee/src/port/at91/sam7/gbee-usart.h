@@ -90,6 +90,15 @@ int gbeeUsartEnable(const char *deviceName);
  */
 void gbeeUsartDisable(int deviceIndex);
 
+/**
+ * Changes the baud rate of the given USART, after the data queued for sending
+ * is sent.
+ *
+ * \param[in] deviceIndex is the device index returned by gbeeUsartInit.
+ * \param[in] baudRate is the new baud rate.
+ */
+void gbeeUsartSetBaudRate(int deviceIndex, uint32_t baudRate);
+
 /**
  * Sets up a DMA transfer to transmit the given buffer via the USART. Returns
  * immediately if the DMA channel is available, otherwise the function waits
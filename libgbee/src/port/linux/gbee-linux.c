@@ -29,10 +29,15 @@
 #include <sys/stat.h>
 #include <sys/ioctl.h>
 #include <sys/time.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 #include <fcntl.h>
 #include <termios.h>
 #include <unistd.h>
+#include <errno.h>
 #include <stdio.h>
+#include <time.h>
 
 /******************************************************************************/
 
@@ -84,6 +89,46 @@ void gbeePortTTYDisconnect(int deviceIndex)
 
 /******************************************************************************/
 
+GBeeError gbeePortTTYSetBaudRate(int deviceIndex, uint32_t baudRate)
+{
+	// TTY options.
+	struct termios options;
+	// TTY speed matching the baud rate.
+	speed_t speed;
+
+	switch (baudRate)
+	{
+		case 1200:   speed = B1200;   break;
+		case 2400:   speed = B2400;   break;
+		case 4800:   speed = B4800;   break;
+		case 9600:   speed = B9600;   break;
+		case 19200:  speed = B19200;  break;
+		case 38400:  speed = B38400;  break;
+		case 57600:  speed = B57600;  break;
+		case 115200: speed = B115200; break;
+		case 230400: speed = B230400; break;
+		default:
+			return GBEE_RS232_ERROR;
+	}
+
+	// Send the data written so far at the old baud rate.
+	tcdrain(deviceIndex);
+
+	if (tcgetattr(deviceIndex, &options) != 0)
+	{
+		return GBEE_RS232_ERROR;
+	}
+	cfsetispeed(&options, speed);
+	cfsetospeed(&options, speed);
+	if (tcsetattr(deviceIndex, TCSANOW, &options) != 0)
+	{
+		return GBEE_RS232_ERROR;
+	}
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
 GBeeError gbeePortTTYSendBuffer(int deviceIndex, const uint8_t *buffer, uint32_t length)
 {
 	int result = write(deviceIndex, buffer, length);
@@ -92,6 +137,81 @@ GBeeError gbeePortTTYSendBuffer(int deviceIndex, const uint8_t *buffer, uint32_t
 
 /******************************************************************************/
 
+GBeeError gbeePortTTYSendVector(int deviceIndex, const GBeeIoVector *vector,
+		uint16_t count)
+{
+	// POSIX I/O vector.
+	struct iovec ioVector[GBEE_IO_VECTOR_MAX];
+	// Index of the first block not completely written.
+	uint16_t index;
+	// File descriptor set used for select call.
+	fd_set writeSet;
+	// POSIX result.
+	ssize_t result;
+
+	if (count > GBEE_IO_VECTOR_MAX)
+	{
+		return GBEE_RS232_ERROR;
+	}
+	for (index = 0; index < count; index++)
+	{
+		ioVector[index].iov_base = (void *)vector[index].data;
+		ioVector[index].iov_len  = vector[index].length;
+	}
+
+	index = 0;
+	while (index < count)
+	{
+		result = writev(deviceIndex, &ioVector[index], count - index);
+		if (result < 0)
+		{
+			if ((errno != EAGAIN) && (errno != EINTR))
+			{
+				return GBEE_RS232_ERROR;
+			}
+
+			// The TTY is opened non-blocking: wait until it accepts data.
+			FD_ZERO(&writeSet);
+			FD_SET(deviceIndex, &writeSet);
+			if (select(deviceIndex+1, NULL, &writeSet, NULL, NULL) < 0)
+			{
+				return GBEE_RS232_ERROR;
+			}
+			continue;
+		}
+
+		// Skip the blocks written completely, and adjust a partially written one.
+		while ((index < count) && ((size_t)result >= ioVector[index].iov_len))
+		{
+			result -= ioVector[index].iov_len;
+			index++;
+		}
+		if (index < count)
+		{
+			ioVector[index].iov_base  = (uint8_t *)ioVector[index].iov_base + result;
+			ioVector[index].iov_len  -= result;
+		}
+	}
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
+GBeeError gbeePortTTYWriteBuffer(int deviceIndex, const uint8_t *buffer,
+		uint32_t length, uint32_t *written)
+{
+	int result = write(deviceIndex, buffer, length);
+	if (result < 0)
+	{
+		*written = 0;
+		return ((errno == EAGAIN) || (errno == EINTR)) ? GBEE_NO_ERROR : GBEE_RS232_ERROR;
+	}
+	*written = result;
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
 GBeeError gbeePortTTYReceiveByte(int deviceIndex, uint8_t *byte, uint32_t timeout)
 {
 	// File descriptor set used for select call.
@@ -135,9 +255,217 @@ GBeeError gbeePortTTYReceiveByte(int deviceIndex, uint8_t *byte, uint32_t timeou
 
 /******************************************************************************/
 
-unsigned int gbeePortTimeGet(void)
+GBeeError gbeePortTTYReceiveBuffer(int deviceIndex, uint8_t *buffer,
+		uint32_t maxLength, uint32_t *length, uint32_t timeout)
 {
+	// File descriptor set used for select call.
+	fd_set readSet;
+	// Timeval for timeout calculation.
 	struct timeval timeVal;
-	gettimeofday(&timeVal, NULL);
-	return timeVal.tv_sec * 1000 + timeVal.tv_usec / 1000;
+	// Point in time the wait ends.
+	GBeeTime deadline;
+	// Time left until the deadline.
+	GBeeTime remaining;
+	// POSIX result.
+	int result;
+
+	*length = 0;
+
+	// The TTY is opened non-blocking, so try to read first: if data is
+	// already pending this saves the select call.
+	result = read(deviceIndex, buffer, maxLength);
+	if (result > 0)
+	{
+		*length = result;
+		return GBEE_NO_ERROR;
+	}
+	else if ((result < 0) && (errno != EAGAIN) && (errno != EINTR))
+	{
+		return GBEE_RS232_ERROR;
+	}
+	else if (timeout == GBEE_NO_WAIT)
+	{
+		return GBEE_TIMEOUT_ERROR;
+	}
+
+	deadline = gbeePortClockGet() + (GBeeTime)timeout * 1000000;
+	do
+	{
+		// Watch the serial device to see when it has input.
+		FD_ZERO(&readSet);
+		FD_SET(deviceIndex, &readSet);
+
+		// Calculate the time left in seconds and microseconds.
+		remaining = gbeePortClockGet();
+		remaining = (remaining < deadline) ? (deadline - remaining) : 0;
+		timeVal.tv_sec  = remaining / 1000000000;
+		timeVal.tv_usec = (remaining % 1000000000) / 1000;
+
+		// Wait for data, start over with the time left if interrupted.
+		result = select(deviceIndex+1, &readSet, NULL, NULL,
+				timeout == GBEE_INFINITE_WAIT ? NULL : &timeVal);
+	}
+	while ((result < 0) && (errno == EINTR));
+	if (result < 0)
+	{
+		return GBEE_RS232_ERROR;
+	}
+	else if (result > 0)
+	{
+		result = read(deviceIndex, buffer, maxLength);
+		if (result > 0)
+		{
+			*length = result;
+			return GBEE_NO_ERROR;
+		}
+		else
+		{
+			return GBEE_RS232_ERROR;
+		}
+	}
+	else
+	{
+		return GBEE_TIMEOUT_ERROR;
+	}
+}
+
+/******************************************************************************/
+
+uint32_t gbeePortTimeGet(void)
+{
+	return (uint32_t)(gbeePortClockGet() / 1000000);
+}
+
+/******************************************************************************/
+
+GBeeTime gbeePortClockGet(void)
+{
+	struct timespec timeSpec;
+	clock_gettime(CLOCK_MONOTONIC, &timeSpec);
+	return (GBeeTime)timeSpec.tv_sec * 1000000000 + timeSpec.tv_nsec;
+}
+
+/******************************************************************************/
+
+void gbeePortSleep(uint32_t milliseconds)
+{
+	struct timespec timeSpec;
+	clock_gettime(CLOCK_MONOTONIC, &timeSpec);
+	timeSpec.tv_sec  += milliseconds / 1000;
+	timeSpec.tv_nsec += (long)(milliseconds % 1000) * 1000000;
+	if (timeSpec.tv_nsec >= 1000000000)
+	{
+		timeSpec.tv_sec++;
+		timeSpec.tv_nsec -= 1000000000;
+	}
+	// Sleep until an absolute time, so signals do not stretch the sleep.
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &timeSpec, NULL)
+			== EINTR);
+}
+
+/******************************************************************************/
+
+GBeeError gbeePortTTYWait(int deviceIndex, int wakeup, uint8_t events,
+		uint8_t *occurred, uint32_t timeout)
+{
+	// Descriptors to watch: the TTY and the wakeup eventfd.
+	struct pollfd pollFds[2];
+	// Value read from the eventfd.
+	uint64_t value;
+	// POSIX result.
+	int result;
+
+	*occurred = 0;
+
+	pollFds[0].fd      = deviceIndex;
+	pollFds[0].events  = 0;
+	pollFds[0].revents = 0;
+	if (events & GBEE_PORT_EVENT_READABLE)
+	{
+		pollFds[0].events |= POLLIN;
+	}
+	if (events & GBEE_PORT_EVENT_WRITABLE)
+	{
+		pollFds[0].events |= POLLOUT;
+	}
+	pollFds[1].fd      = wakeup;
+	pollFds[1].events  = (events & GBEE_PORT_EVENT_WAKEUP) ? POLLIN : 0;
+	pollFds[1].revents = 0;
+
+	result = poll(pollFds, 2, timeout == GBEE_INFINITE_WAIT ? -1 : (int)timeout);
+	if (result < 0)
+	{
+		return (errno == EINTR) ? GBEE_TIMEOUT_ERROR : GBEE_RS232_ERROR;
+	}
+	else if (result == 0)
+	{
+		return GBEE_TIMEOUT_ERROR;
+	}
+
+	if (pollFds[0].revents & (POLLERR | POLLHUP | POLLNVAL))
+	{
+		return GBEE_RS232_ERROR;
+	}
+	if (pollFds[0].revents & POLLIN)
+	{
+		*occurred |= GBEE_PORT_EVENT_READABLE;
+	}
+	if (pollFds[0].revents & POLLOUT)
+	{
+		*occurred |= GBEE_PORT_EVENT_WRITABLE;
+	}
+	if (pollFds[1].revents & POLLIN)
+	{
+		// Consume the signal.
+		if (read(wakeup, &value, sizeof(value)) == sizeof(value))
+		{
+			*occurred |= GBEE_PORT_EVENT_WAKEUP;
+		}
+	}
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
+bool gbeePortThreadCreate(GBeePortThread *thread, void *(*entry)(void *),
+		void *argument)
+{
+	return pthread_create(thread, NULL, entry, argument) == 0;
+}
+
+/******************************************************************************/
+
+void gbeePortThreadJoin(GBeePortThread thread)
+{
+	pthread_join(thread, NULL);
+}
+
+/******************************************************************************/
+
+int gbeePortWakeupCreate(void)
+{
+	return eventfd(0, EFD_NONBLOCK);
+}
+
+/******************************************************************************/
+
+void gbeePortWakeupSignal(int wakeup)
+{
+	// Value added to the eventfd counter.
+	uint64_t value = 1;
+
+	if (write(wakeup, &value, sizeof(value)) != sizeof(value))
+	{
+		// The counter is saturated, the thread is woken up anyway.
+	}
+}
+
+/******************************************************************************/
+
+void gbeePortWakeupDestroy(int wakeup)
+{
+	if (wakeup >= 0)
+	{
+		close(wakeup);
+	}
 }
@@ -35,6 +35,11 @@ extern "C"{
 #include <string.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/** Thread type used by the GBee driver mode. */
+typedef pthread_t GBeePortThread;
 
 /**
  * Connect the GBee with the given TTY interface and perform port-specific
@@ -54,6 +59,18 @@ int gbeePortTTYConnect(const char *deviceName);
  */
 void gbeePortTTYDisconnect(int deviceIndex);
 
+/**
+ * Change the baud rate of the TTY interface, after the data written so far is
+ * sent.
+ * 
+ * \param[in] deviceIndex is the GBee/TTY connection index.
+ * \param[in] baudRate is the new baud rate (1200 to 230400 bps).
+ * 
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_RS232_ERROR to indicate an error or an unsupported baud rate.
+ */
+GBeeError gbeePortTTYSetBaudRate(int deviceIndex, uint32_t baudRate);
+
 /**
  * Write the given byte buffer to the TTY interface.
  * 
@@ -67,6 +84,35 @@ void gbeePortTTYDisconnect(int deviceIndex);
 GBeeError gbeePortTTYSendBuffer(int deviceIndex, const uint8_t *buffer, 
 		uint32_t length);
 
+/**
+ * Write the given blocks of data to the TTY interface with a single call to
+ * writev (as far as the TTY accepts the data).
+ * 
+ * \param[in] deviceIndex is the GBee/TTY connection index.
+ * \param[in] vector points to the blocks of data to send.
+ * \param[in] count is the number of blocks.
+ * 
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_RS232_ERROR to indicate an error.
+ */
+GBeeError gbeePortTTYSendVector(int deviceIndex, const GBeeIoVector *vector,
+		uint16_t count);
+
+/**
+ * Write as much of the given byte buffer to the TTY interface as possible
+ * without blocking.
+ * 
+ * \param[in] deviceIndex is the GBee/TTY connection index.
+ * \param[in] buffer is the byte buffer to send.
+ * \param[in] length is the number of bytes to send.
+ * \param[out] written is the number of bytes sent.
+ * 
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_RS232_ERROR to indicate an error.
+ */
+GBeeError gbeePortTTYWriteBuffer(int deviceIndex, const uint8_t *buffer, 
+		uint32_t length, uint32_t *written);
+
 /**
  * Read a byte from the serial buffer.
  * 
@@ -82,20 +128,121 @@ GBeeError gbeePortTTYSendBuffer(int deviceIndex, const uint8_t *buffer,
 GBeeError gbeePortTTYReceiveByte(int deviceIndex, uint8_t *byte, uint32_t timeout);
 
 /**
- * Return the current time in milliseconds.
+ * Read all bytes available from the serial buffer (up to the given maximum).
+ * Waits until at least one byte is available or the timeout expired.
+ *
+ * \param[in] deviceIndex is the handle returned by serialOpen.
+ * \param[out] buffer is where to store the bytes received.
+ * \param[in] maxLength is the maximum number of bytes to read.
+ * \param[out] length is the number of bytes received.
+ * \param[in] timeout specifies the timeout in milliseconds.
+ *
+ * \retval GBEE_NO_ERROR to indicate success.
+ * \retval GBEE_TIMEOUT_ERROR to indicate timeout expired without any data
+ * being received.
+ * \retval GBEE_RS232_ERROR to indicate a serial communication error.
+ */
+GBeeError gbeePortTTYReceiveBuffer(int deviceIndex, uint8_t *buffer,
+		uint32_t maxLength, uint32_t *length, uint32_t timeout);
+
+/**
+ * Wait until the TTY interface gets readable or writable, or the given wakeup
+ * handle is signalled.
+ *
+ * \param[in] deviceIndex is the GBee/TTY connection index.
+ * \param[in] wakeup is the wakeup handle (an eventfd).
+ * \param[in] events is the set of events to wait for.
+ * \param[out] occurred is the set of events occurred.
+ * \param[in] timeout specifies the timeout in milliseconds.
+ *
+ * \retval GBEE_NO_ERROR to indicate that an event occurred.
+ * \retval GBEE_TIMEOUT_ERROR to indicate timeout expired without any event.
+ * \retval GBEE_RS232_ERROR to indicate a serial communication error.
+ */
+GBeeError gbeePortTTYWait(int deviceIndex, int wakeup, uint8_t events,
+		uint8_t *occurred, uint32_t timeout);
+
+/**
+ * Start a thread.
+ *
+ * \param[out] thread is the thread started.
+ * \param[in] entry is the function run by the thread.
+ * \param[in] argument is passed to the function.
+ *
+ * \return true if successful, false otherwise.
+ */
+bool gbeePortThreadCreate(GBeePortThread *thread, void *(*entry)(void *),
+		void *argument);
+
+/**
+ * Wait until the given thread has finished.
+ *
+ * \param[in] thread is the thread to wait for.
+ */
+void gbeePortThreadJoin(GBeePortThread thread);
+
+/**
+ * Create a wakeup handle (an eventfd).
+ *
+ * \return The wakeup handle, or -1 in case of an error.
+ */
+int gbeePortWakeupCreate(void);
+
+/**
+ * Signal the given wakeup handle.
+ *
+ * \param[in] wakeup is the wakeup handle.
+ */
+void gbeePortWakeupSignal(int wakeup);
+
+/**
+ * Close the given wakeup handle.
+ *
+ * \param[in] wakeup is the wakeup handle.
+ */
+void gbeePortWakeupDestroy(int wakeup);
+
+/**
+ * Return the current time in milliseconds, taken from the monotonic clock.
  *
  * \return The current timestamp in milliseconds.
  */
 uint32_t gbeePortTimeGet(void);
 
+/**
+ * Return the current time in nanoseconds, taken from the monotonic clock.
+ *
+ * \return The current timestamp in nanoseconds.
+ */
+GBeeTime gbeePortClockGet(void);
+
+/**
+ * Suspend the calling thread for the given time, measured on the monotonic
+ * clock.
+ *
+ * \param[in] milliseconds is the time to sleep.
+ */
+void gbeePortSleep(uint32_t milliseconds);
+
 /** This macro is used by the GBee driver to connect to the UART. */
 #define GBEE_PORT_UART_CONNECT gbeePortTTYConnect
 /** This macro is used by the GBee driver to disconnect from the UART. */
 #define GBEE_PORT_UART_DISCONNECT gbeePortTTYDisconnect
+/** This macro is used by the GBee driver to change the baud rate of the UART. */
+#define GBEE_PORT_UART_SET_BAUD_RATE gbeePortTTYSetBaudRate
 /** This macro is used by the GBee driver to send a buffer via the UART. */
 #define GBEE_PORT_UART_RECEIVE_BYTE gbeePortTTYReceiveByte
+/** This macro is used by the GBee driver to receive a block of data from the
+ * UART. */
+#define GBEE_PORT_UART_RECEIVE_BUFFER gbeePortTTYReceiveBuffer
 /** This macro is used by the GBee driver to receive a byte from the UART. */
 #define GBEE_PORT_UART_SEND_BUFFER gbeePortTTYSendBuffer
+/** This macro is used by the GBee driver to send several buffers via the
+ * UART at once. */
+#define GBEE_PORT_UART_SEND_VECTOR gbeePortTTYSendVector
+/** This macro is used by the GBee driver to send a buffer via the UART
+ * without blocking. */
+#define GBEE_PORT_UART_WRITE_BUFFER gbeePortTTYWriteBuffer
 /** This macro is used by the GBee driver to allocate a block of memory. */
 #define GBEE_PORT_MEMORY_ALLOC malloc
 /** This macro is used by the GBee driver to free an allocated block of memory.
@@ -107,6 +254,27 @@ uint32_t gbeePortTimeGet(void);
 #define GBEE_PORT_MEMORY_COPY memcpy
 /** This macro is used by the GBee driver to get current system time. */
 #define GBEE_PORT_TIME_GET gbeePortTimeGet
+/** This macro is used by the GBee driver to get the monotonic clock. */
+#define GBEE_PORT_CLOCK_GET gbeePortClockGet
+/** This macro is used by the GBee driver to sleep without using the CPU. */
+#define GBEE_PORT_SLEEP gbeePortSleep
+/** This macro is used by the GBee driver to compare and swap a value
+ * atomically. */
+#define GBEE_PORT_ATOMIC_CAS __sync_bool_compare_and_swap
+/** This macro is used by the GBee driver to order memory accesses. */
+#define GBEE_PORT_MEMORY_BARRIER __sync_synchronize
+/** This macro is used by the GBee driver to start the I/O thread. */
+#define GBEE_PORT_THREAD_CREATE gbeePortThreadCreate
+/** This macro is used by the GBee driver to wait for the I/O thread. */
+#define GBEE_PORT_THREAD_JOIN gbeePortThreadJoin
+/** This macro is used by the GBee driver to create a wakeup handle. */
+#define GBEE_PORT_WAKEUP_CREATE gbeePortWakeupCreate
+/** This macro is used by the GBee driver to signal a wakeup handle. */
+#define GBEE_PORT_WAKEUP_SIGNAL gbeePortWakeupSignal
+/** This macro is used by the GBee driver to close a wakeup handle. */
+#define GBEE_PORT_WAKEUP_DESTROY gbeePortWakeupDestroy
+/** This macro is used by the GBee driver to wait for UART events. */
+#define GBEE_PORT_UART_WAIT gbeePortTTYWait
 /** This macro is used by the GBee driver to print debug messages.
  * If this macro is undefined, the GBee driver will not try to print debug
  * messages.
@@ -104,6 +104,32 @@ void gbeePortComDisconnect(int deviceIndex)
 
 /******************************************************************************/
 
+GBeeError gbeePortComSetBaudRate(int deviceIndex, uint32_t baudRate)
+{
+	/* COM port device control block. */
+	DCB deviceControl;
+
+	/* Send the data written so far at the old baud rate. */
+	FlushFileBuffers((HANDLE)deviceIndex);
+
+	if (!GetCommState((HANDLE)deviceIndex, &deviceControl))
+	{
+		GBEE_PORT_TRACE("gbeePortComSetBaudRate: Error getting COM port configuration: %d \r\n",
+				GetLastError());
+		return GBEE_RS232_ERROR;
+	}
+	deviceControl.BaudRate = baudRate;
+	if (!SetCommState((HANDLE)deviceIndex, &deviceControl))
+	{
+		GBEE_PORT_TRACE("gbeePortComSetBaudRate: Error setting COM port configuration: %d \r\n",
+				GetLastError());
+		return GBEE_RS232_ERROR;
+	}
+	return GBEE_NO_ERROR;
+}
+
+/******************************************************************************/
+
 GBeeError gbeePortComSendBuffer(int deviceIndex, const uint8_t *buffer, uint32_t length)
 {
 	/* Write result. */
@@ -164,3 +190,42 @@ GBeeError gbeePortComReceiveByte(int deviceIndex, uint8_t *byte, uint32_t timeou
 		return GBEE_TIMEOUT_ERROR;
 	}
 }
+
+/******************************************************************************/
+
+GBeeError gbeePortComReceiveBuffer(int deviceIndex, uint8_t *buffer,
+		uint32_t maxLength, uint32_t *length, uint32_t timeout)
+{
+	/* COM port timeout structure. */
+	COMMTIMEOUTS comTimeout;
+	/* Number of bytes read from COM port. */
+	DWORD bytesRead;
+
+	/* Set the timeout. With these settings ReadFile returns immediately with
+	 * the bytes already buffered, or waits for the first byte to arrive. */
+	comTimeout.ReadIntervalTimeout         = MAXDWORD;
+	comTimeout.ReadTotalTimeoutMultiplier  = MAXDWORD;
+	comTimeout.ReadTotalTimeoutConstant    = timeout;
+	comTimeout.WriteTotalTimeoutMultiplier = MAXDWORD;
+	comTimeout.WriteTotalTimeoutConstant   = MAXDWORD;
+	if (!SetCommTimeouts((HANDLE)deviceIndex, &comTimeout))
+	{
+		return GBEE_RS232_ERROR;
+	}
+
+	/* Wait for data received from COM port. */
+	if (!ReadFile((HANDLE)deviceIndex, buffer, maxLength, &bytesRead, NULL))
+	{
+		return GBEE_RS232_ERROR;
+	}
+
+	*length = bytesRead;
+	if (bytesRead > 0)
+	{
+		return GBEE_NO_ERROR;
+	}
+	else
+	{
+		return GBEE_TIMEOUT_ERROR;
+	}
+}
@@ -106,6 +106,17 @@ int gbeePortComConnect(const char *deviceName);
  */
 void gbeePortComDisconnect(int deviceIndex);
 
+/**
+ * Changes the baud rate of the COM port, after the data written so far is
+ * sent.
+ * 
+ * \param[in] deviceIndex is the GBee/COM port connection index.
+ * \param[in] baudRate is the new baud rate.
+ * 
+ * \return GBEE_NO_ERROR if successful; GBEE_RS232_ERROR in case of an error.
+ */
+GBeeError gbeePortComSetBaudRate(int deviceIndex, uint32_t baudRate);
+
 /**
  * Writes the given byte buffer to the COM port.
  * 
@@ -130,12 +141,33 @@ GBeeError gbeePortComSendBuffer(int deviceIndex, const uint8_t *buffer,
  */
 GBeeError gbeePortComReceiveByte(int deviceIndex, uint8_t *byte, uint32_t timeout);
 
+/**
+ * Reads all bytes available from the COM port (up to the given maximum).
+ * Waits until at least one byte is available or the timeout expired.
+ * 
+ * \param[in] deviceIndex is the handle returned by gbeePortComConnect.
+ * \param[out] buffer is where to store the bytes received.
+ * \param[in] maxLength is the maximum number of bytes to read.
+ * \param[out] length is the number of bytes received.
+ * \param[in] timeout specifies the timeout in milliseconds.
+ * 
+ * \returns GBEE_NO_ERROR if data was received, GBEE_TIMEOUT_ERROR if timed
+ * out, or GBEE_RS232_ERROR in case of an error.
+ */
+GBeeError gbeePortComReceiveBuffer(int deviceIndex, uint8_t *buffer,
+		uint32_t maxLength, uint32_t *length, uint32_t timeout);
+
 /** This macro is used by the GBee driver to connect to the UART. */
 #define GBEE_PORT_UART_CONNECT gbeePortComConnect
 /** This macro is used by the GBee driver to disconnect from the UART. */
 #define GBEE_PORT_UART_DISCONNECT gbeePortComDisconnect
+/** This macro is used by the GBee driver to change the baud rate of the UART. */
+#define GBEE_PORT_UART_SET_BAUD_RATE gbeePortComSetBaudRate
 /** This macro is used by the GBee driver to send a buffer via the UART. */
 #define GBEE_PORT_UART_RECEIVE_BYTE gbeePortComReceiveByte
+/** This macro is used by the GBee driver to receive a block of data from the
+ * UART. */
+#define GBEE_PORT_UART_RECEIVE_BUFFER gbeePortComReceiveBuffer
 /** This macro is used by the GBee driver to receive a byte from the UART. */
 #define GBEE_PORT_UART_SEND_BUFFER gbeePortComSendBuffer
 /** This macro is used by the GBee driver to allocate a block of memory. */
@@ -150,6 +182,11 @@ GBeeError gbeePortComReceiveByte(int deviceIndex, uint8_t *byte, uint32_t timeou
 #define GBEE_PORT_MEMORY_COPY memcpy
 /** This macro is used by the GBee driver to get current system time. */
 #define GBEE_PORT_TIME_GET GetTickCount
+/** This macro is used by the GBee driver to sleep without using the CPU. */
+#define GBEE_PORT_SLEEP Sleep
+/** This macro is used by the GBee driver to compare and swap a value
+ * atomically. */
+#define GBEE_PORT_ATOMIC_CAS __sync_bool_compare_and_swap
 /** 
  * This macro is used by the GBee driver to print debug messages.
  * If this macro is undefined, the GBee driver will not try to print debug
@@ -147,6 +147,18 @@ static const Pin pins[] = { PINS_DBGU };
  */
 static void serverStart(GBee *gbee);
 
+/**
+ * Handles a data packet using 16bit short address: sends back the UDP payload
+ * to the echo client.
+ *
+ * \param[in] gbee is a pointer to the GBee driver instance.
+ * \param[in] frameData points to the received packet.
+ * \param[in] length is the length of the received packet.
+ * \param[in] context is not used.
+ */
+static void serverOnRxPacket(GBee *gbee, const GBeeFrameData *frameData,
+		uint16_t length, void *context);
+
 /**
  * Stops the execution of the echo server in case of an error.
  */
@@ -223,10 +235,10 @@ static void serverStart(GBee *gbee)
 	GBeeMode mode;
 	/* Xbee error code. */
 	GBeeError error;
-	/* Data packet using 16bit short address. */
-	GBeeRxPacket16 rxPacket16;
-	/* Length of received packet. */
-	uint16_t packetLength;
+	/* Received frame not taken by a frame handler. */
+	const GBeeFrameData *frame;
+	/* Length of received frame. */
+	uint16_t frameLength;
 	/* Xbee receive timeout. */
 	uint32_t timeout;
 
@@ -271,62 +283,63 @@ static void serverStart(GBee *gbee)
 			ECHO_SERVER_ADDR, ECHO_SERVER_PAN);
 	printf("Ready \r\n");
 
+	/* Echo requests are handled as soon as they are received. */
+	gbeeRegisterHandler(gbee, GBEE_RX_PACKET_16, serverOnRxPacket, NULL);
+
 	while (1)
 	{
-		/* Payload of received packet. */
-		uint8_t *payload;
-		/* Payload length of received packet. */
-		uint16_t payloadLength;
-		/* Address of echo client. */
-		GBeeSockAddr clientAddr;
-		/* GBee transmission request. */
-		GBeeTxRequest16 txRequest16;
-		/* GBee transmission length. */
-		uint16_t txRequestLength;
-
-		LED_Clear(LED_DS1);
-
-		/* Wait for echo requests. */
+		/* Receive, any other frames are ignored. */
 		timeout = GBEE_INFINITE_WAIT;
-		do
-		{
-			error = gbeeReceive(gbee, (GBeeFrameData *)&rxPacket16, &packetLength,
-					&timeout);
-		}
-		while ((error == GBEE_NO_ERROR) 
-				&& (rxPacket16.ident != GBEE_RX_PACKET_16));
-
-		LED_Set(LED_DS1);
-
+		error = gbeeReceiveFrame(gbee, &frame, &frameLength, &timeout);
 		if (error != GBEE_NO_ERROR)
 		{
 			printf("Error receiving data: %s \r\n", gbeeUtilCodeToString(error));
-			continue;
-		}
-		else
-		{
-			printf("Received %d bytes from 0x%04x, signal strength = -%ddBm \r\n",
-					packetLength, GBEE_USHORT(rxPacket16.srcAddr16), rxPacket16.rssi);
 		}
+	}
+
+	serverStop();
+}
 
-		/* Check if received packet contains UDP data. */
-		if (gbeeUtilDecodeUdp(&rxPacket16, packetLength, &payload, &payloadLength,
-				&clientAddr))
+/******************************************************************************/
+
+static void serverOnRxPacket(GBee *gbee, const GBeeFrameData *frameData,
+		uint16_t length, void *context)
+{
+	/* Data packet using 16bit short address. */
+	GBeeRxPacket16 rxPacket16;
+	/* Payload of received packet. */
+	uint8_t *payload;
+	/* Payload length of received packet. */
+	uint16_t payloadLength;
+	/* Address of echo client. */
+	GBeeSockAddr clientAddr;
+	/* Xbee error code. */
+	GBeeError error;
+
+	/* The frame data is only valid until we return, take a copy. */
+	if (length > sizeof(rxPacket16))
+	{
+		return;
+	}
+	memcpy(&rxPacket16, &frameData->rxPacket16, length);
+
+	LED_Set(LED_DS1);
+	printf("Received %d bytes from 0x%04x, signal strength = -%ddBm \r\n",
+			length, GBEE_USHORT(rxPacket16.srcAddr16), rxPacket16.rssi);
+
+	/* Check if received packet contains UDP data. */
+	if (gbeeUtilDecodeUdp(&rxPacket16, length, &payload, &payloadLength,
+			&clientAddr))
+	{
+		/* Send back the echo (without copying the payload). */
+		error = gbeeUtilSendUdp(gbee, payload, payloadLength, ECHO_PORT_UDP,
+				&clientAddr);
+		if (error != GBEE_NO_ERROR)
 		{
-			/* Encode the UDP packet containing the echo. */
-			gbeeUtilEncodeUdp(payload, payloadLength, ECHO_PORT_UDP, &clientAddr,
-					&txRequest16, &txRequestLength);
-
-			/* Send back the echo. */
-			error = gbeeSend(gbee, (GBeeFrameData *)&txRequest16, txRequestLength);
-			if (error != GBEE_NO_ERROR)
-			{
-				printf("Error sending echo: %s \r\n", gbeeUtilCodeToString(error));
-			}
+			printf("Error sending echo: %s \r\n", gbeeUtilCodeToString(error));
 		}
 	}
-
-	serverStop();
+	LED_Clear(LED_DS1);
 }
 
 /******************************************************************************/
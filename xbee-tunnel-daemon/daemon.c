@@ -31,6 +31,24 @@
  * \a /dev/ttyUSB0. </td>
  * </tr>
  * <tr>
+ * <td>-p, --profile</td>
+ * <td>Optional. Name of the radio profile file, e.g.
+ * \a /var/lib/xbee-tunnel-daemon/ttyUSB0.profile. After configuring the XBee
+ * module, the XBee-Tunnel-Daemon records its settings in this file. On the
+ * next start, the XBee module is only checked against the profile (a single
+ * query) instead of being configured again, which shortens restarts from
+ * several seconds to milliseconds.</td>
+ * </tr>
+ * <tr>
+ * <td>-b, --baudrate</td>
+ * <td>Optional. Baud rate of the serial interface, one of 1200, 2400, 4800,
+ * 9600, 19200, 38400, 57600 or 115200 (default: 9600). The
+ * XBee-Tunnel-Daemon detects the baud rate the XBee module currently uses
+ * (e.g. left over from a former start) and changes it to the given one;
+ * 115200 lifts the serial interface well above the data rate of the
+ * radio.</td>
+ * </tr>
+ * <tr>
  * <td>-v, --verbose</td>
  * <td>Optional. Enables verbose output; note, that the XBee-Tunnel-Daemon logs
  * all output to the syslog.</td>
@@ -225,10 +243,13 @@
  * \param[in] serialDevice is the name of the serial device the XBee is
  * connected to.
  * \param[in] inetAddr is the IP address of the local device.
+ * \param[in] profile is the name of the radio profile file, NULL for none.
+ * \param[in] baudRate is the baud rate of the serial interface.
  *
  * \return true if successful, false in case of any error.
  */
-static bool daemonInit(const char *serialDevice, const char *inetAddr);
+static bool daemonInit(const char *serialDevice, const char *inetAddr,
+		const char *profile, uint32_t baudRate);
 
 /**
  * The transmitter sends data received from the TUN device via the Xbee.
@@ -269,6 +290,10 @@ int main(int argc, char* argv[])
 	static char serialDeviceName[80];
 	/* IP address for the Xbee */
 	static char inetAddrString[16];
+	/* Name of the radio profile file. */
+	static char profileName[256];
+	/* Baud rate of the serial interface. */
+	static uint32_t baudRate = GBEE_BAUD_RATE_DEFAULT;
 	/** VERBOSE flag, set to 1 to enable verbose mode */
 	static bool verbose = false;
 
@@ -285,12 +310,14 @@ int main(int argc, char* argv[])
 		static struct option options[] = {
 			{ "inet"   , required_argument, 0, 'i' },
 			{ "serial" , required_argument, 0, 's' },
-			{ "verbose", no_argument      , 0, 'v' },
-			{ 0        , 0                , 0, 0   }
+			{ "profile" , required_argument, 0, 'p' },
+			{ "baudrate", required_argument, 0, 'b' },
+			{ "verbose" , no_argument      , 0, 'v' },
+			{ 0         , 0                , 0, 0   }
 		};
 		int index, result;
 
-		result = getopt_long(argc, argv, "i:s:v", options, &index);
+		result = getopt_long(argc, argv, "i:s:p:b:v", options, &index);
 		if (result == -1)
 		{
 			break;	/* done */
@@ -304,6 +331,12 @@ int main(int argc, char* argv[])
 		case 'i':	/* IP address to use for the XBee */
 			strncpy(inetAddrString, optarg, sizeof(inetAddrString) - 1);
 			break;
+		case 'p':	/* name of the radio profile file */
+			strncpy(profileName, optarg, sizeof(profileName) - 1);
+			break;
+		case 'b':	/* baud rate of the serial interface */
+			baudRate = strtoul(optarg, NULL, 10);
+			break;
 		case 'v':	/* Enable VERBOSE mode */
 			verbose = true;
 			break;
@@ -328,7 +361,7 @@ int main(int argc, char* argv[])
 	if ((strlen(serialDeviceName) == 0) || (strlen(inetAddrString) == 0))
 	{
 		syslog(LOG_WARNING, "Don't know IP address or serial device name to use");
-		syslog(LOG_INFO, "Usage: %s --inet <internet address> --serial <serial device> [--verbose]",
+		syslog(LOG_INFO, "Usage: %s --inet <internet address> --serial <serial device> [--profile <profile file>] [--baudrate <baud rate>] [--verbose]",
 				PROJECT_NAME);
 		exit(EXIT_FAILURE);
 	}
@@ -338,7 +371,8 @@ int main(int argc, char* argv[])
 
 
 	/* Initialize the Tunnel. */
-	if (!daemonInit(serialDeviceName, inetAddrString))
+	if (!daemonInit(serialDeviceName, inetAddrString,
+			(strlen(profileName) > 0) ? profileName : NULL, baudRate))
 	{
 		syslog(LOG_ERR, "Error initializing the daemon");
 		exit(EXIT_FAILURE);
@@ -350,10 +384,11 @@ int main(int argc, char* argv[])
 
 /*************************************************************************/
 
-static bool daemonInit(const char *serialDevice, const char *inetAddr)
+static bool daemonInit(const char *serialDevice, const char *inetAddr,
+		const char *profile, uint32_t baudRate)
 {
 	/* Initialize the tunnel. */
-	theTunnel = tunnelInit(serialDevice, inetAddr);
+	theTunnel = tunnelInit(serialDevice, inetAddr, profile, baudRate);
 	if (!theTunnel)
 	{
 		syslog(LOG_ERR, "Error creating the tunnel");
@@ -425,30 +460,31 @@ static void *daemonTransmit(void *data)
 
 static void *daemonReceive(void *data)
 {
+	/* The buffer holding the packet received from the PAN. */
+	GBeeFrameBuffer *buffer;
 	/* The packet received from the PAN. */
-	GBeeRxPacket16 rxPacket;
-	/* Length of the packet received from the PAN. */
-	uint16_t rxPacketLength;
+	const GBeeRxPacket16 *rxPacket;
 
 	while (1)
 	{
 		/* Receive the packets from the PAN. */
-		if (!tunnelGBeeReceive(theTunnel, (GBeeFrameData *)&rxPacket, &rxPacketLength))
+		if (!tunnelGBeeReceive(theTunnel, &buffer))
 		{
 			syslog(LOG_WARNING, "Error reading XBee frame");
 			continue;
 		}
+		rxPacket = &GBEE_FRAME_BUFFER_DATA(buffer)->rxPacket16;
 
 		/* Dump the packet data if in verbose mode. */
 		syslog(LOG_DEBUG, "<--- %d bytes from 0x%04x at -%ddBm",
-				rxPacketLength, GBEE_USHORT(rxPacket.srcAddr16), rxPacket.rssi);
+				buffer->length, GBEE_USHORT(rxPacket->srcAddr16), rxPacket->rssi);
 
 		/* Write the packets to the TUN device. */
-		if (!tunnelInetSend(theTunnel, &rxPacket, rxPacketLength))
+		if (!tunnelInetSend(theTunnel, buffer))
 		{
 			syslog(LOG_WARNING, "Error sending IP packet");
-			continue;
 		}
+		gbeePoolRelease(buffer);
 	}
 
 	pthread_exit(0);
@@ -57,7 +57,7 @@ bool gbeeInetDecode(IpHeader *ipHeader, uint32_t packetLength,
 	/* Assemble the GBee Tx request. */
 	*txRequestLength     = packetLength - ipHeaderLength;
 	txRequest->ident     = GBEE_TX_REQUEST_16;
-	txRequest->frameId   = 0xAA;
+	txRequest->frameId   = 0; /* Assigned by tunnelGBeeSend(). */
 	txRequest->dstAddr16 = GBEE_USHORT(ntohl(ipHeader->destAddress) & 0xFFFF);
 	txRequest->options   = 0;
 	memcpy(txRequest->data, (uint8_t *)udpHeader, *txRequestLength);
@@ -94,12 +94,8 @@ bool gbeeInetEncode(uint32_t destAddr, const GBeeRxPacket16 *gbeePacket,
 			                   GBEE_USHORT(gbeePacket->srcAddr16));
 	ipHeader->destAddress   = htonl(destAddr);
 
-	/* Get the header checksum. */
+	/* Finally, get the header checksum and we're done. */
 	ipHeader->checksum = gbeeInetChecksumGet(ipHeader);
-
-	/* Finally, copy the data and we're done. */
-	memcpy(((uint8_t *)ipHeader) + sizeof(IpHeader), gbeePacket->data,
-			gbeePacketLength);
 	return true;
 }
 
@@ -78,13 +78,15 @@ bool gbeeInetDecode(IpHeader *ipHeader, uint32_t packetLength,
 		GBeeTxRequest16 *txRequest,	uint16_t *txRequestLength);
 
 /**
- * Encode an UDP/IP packet using the data given by the GBee Rx packet.
+ * Encode the IP header of an UDP/IP packet using the data given by the GBee Rx
+ * packet. The payload of the IP packet is the data of the Rx packet, it is not
+ * copied.
  *
  * \param[in] destAddr is the host where to send the packet to.
  * \param[in] gbeePacket is the GBee Rx packet.
  * \param[in] gbeePacketLength is the length of the packet in bytes.
  * \param[out] ipHeader points to a memory location where to store the IP
- * 		packet.
+ * 		header.
  *
  * \return true if successfull, false in case of any error.
  */
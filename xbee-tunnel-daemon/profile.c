@@ -0,0 +1,161 @@
+/**
+ * \file
+ * \author  d264
+ * \version $Rev$
+ *
+ * \section DESCRIPTION
+ *
+ * Implementation of the radio profile. The profile file holds one
+ * "key=value" line per field.
+ *
+ * \section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Number of fields of a profile file. */
+#define PROFILE_FIELD_COUNT 9
+
+/*****************************************************************************/
+
+bool profileLoad(Profile *self, const char *path)
+{
+	/* The profile file. */
+	FILE *file;
+	/* Current line of the file. */
+	char line[PROFILE_DEVICE_LENGTH + 16];
+	/* Value of the current line. */
+	char *value;
+	/* Value converted to a number. */
+	unsigned long number;
+	/* Number of fields read. */
+	int fields = 0;
+
+	file = fopen(path, "r");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	memset(self, 0, sizeof(*self));
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		/* Split the line into key and value, drop the newline. */
+		value = strchr(line, '=');
+		if (value == NULL)
+		{
+			continue;
+		}
+		*value++ = '\0';
+		value[strcspn(value, "\n")] = '\0';
+		number = strtoul(value, NULL, 0);
+
+		if (strcmp(line, "device") == 0)
+		{
+			strncpy(self->serialDevice, value, sizeof(self->serialDevice) - 1);
+		}
+		else if (strcmp(line, "sh") == 0)
+		{
+			self->serialHigh = number;
+		}
+		else if (strcmp(line, "sl") == 0)
+		{
+			self->serialLow = number;
+		}
+		else if (strcmp(line, "mode") == 0)
+		{
+			self->mode = number;
+		}
+		else if (strcmp(line, "address") == 0)
+		{
+			self->gbeeAddr = number;
+		}
+		else if (strcmp(line, "pan") == 0)
+		{
+			self->gbeePan = number;
+		}
+		else if (strcmp(line, "baudrate") == 0)
+		{
+			self->baudRate = number;
+		}
+		else if (strcmp(line, "firmware") == 0)
+		{
+			self->firmware = number;
+		}
+		else if (strcmp(line, "np") == 0)
+		{
+			self->maxPayloadLength = number;
+		}
+		else
+		{
+			continue;
+		}
+		fields++;
+	}
+
+	fclose(file);
+	return fields == PROFILE_FIELD_COUNT;
+}
+
+/*****************************************************************************/
+
+bool profileSave(const Profile *self, const char *path)
+{
+	/* The temporary profile file. */
+	FILE *file;
+	/* Name of the temporary profile file. */
+	char tempPath[256];
+	/* Result of writing the file. */
+	bool result;
+
+	if (snprintf(tempPath, sizeof(tempPath), "%s.tmp", path)
+			>= (int)sizeof(tempPath))
+	{
+		return false;
+	}
+	file = fopen(tempPath, "w");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	result = fprintf(file,
+			"device=%s\n"
+			"sh=0x%08x\n"
+			"sl=0x%08x\n"
+			"mode=%u\n"
+			"address=0x%04x\n"
+			"pan=0x%04x\n"
+			"baudrate=%u\n"
+			"firmware=0x%04x\n"
+			"np=%u\n",
+			self->serialDevice, self->serialHigh, self->serialLow, self->mode,
+			self->gbeeAddr, self->gbeePan, self->baudRate, self->firmware,
+			self->maxPayloadLength) > 0;
+	result = (fclose(file) == 0) && result;
+
+	/* Replace the old profile. */
+	if (!result || (rename(tempPath, path) != 0))
+	{
+		remove(tempPath);
+		return false;
+	}
+	return true;
+}
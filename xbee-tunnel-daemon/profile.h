@@ -0,0 +1,79 @@
+/**
+ * \file
+ * \author  d264
+ * \version $Rev$
+ *
+ * \section DESCRIPTION
+ *
+ * The radio profile records how the XBee was configured by the last successful
+ * initialization of the tunnel, so a restarted daemon can check the XBee with
+ * a single query instead of configuring it again. The profile is stored as a
+ * small text file, keyed by the serial device and the serial number (SH/SL)
+ * of the XBee.
+ *
+ * \section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef PROFILE_H_INCLUDED
+#define PROFILE_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Maximum length of the serial device name kept in a profile. */
+#define PROFILE_DEVICE_LENGTH 80
+
+/** Radio profile of an XBee. */
+struct Profile {
+	char     serialDevice[PROFILE_DEVICE_LENGTH]; /**< Serial device the XBee
+	                                                   is connected to. */
+	uint32_t serialHigh;       /**< Upper half of the serial number (SH). */
+	uint32_t serialLow;        /**< Lower half of the serial number (SL). */
+	uint8_t  mode;             /**< Mode the XBee operates in (AP). */
+	uint16_t gbeeAddr;         /**< XBee 16bit address (MY). */
+	uint16_t gbeePan;          /**< XBee PAN identifier (ID). */
+	uint32_t baudRate;         /**< Interface data rate (BD). */
+	uint16_t firmware;         /**< Firmware version (VR). */
+	uint16_t maxPayloadLength; /**< Maximum payload length (NP). */
+};
+
+/** Profile type definition. */
+typedef struct Profile Profile;
+
+/**
+ * Loads a radio profile.
+ *
+ * \param[out] self is the profile loaded.
+ * \param[in] path is the name of the profile file.
+ *
+ * \return true if successful, false if the file does not exist or is
+ * incomplete.
+ */
+bool profileLoad(Profile *self, const char *path);
+
+/**
+ * Saves a radio profile. The file is replaced atomically, so a daemon killed
+ * meanwhile leaves either the old or the new profile behind.
+ *
+ * \param[in] self is the profile to save.
+ * \param[in] path is the name of the profile file.
+ *
+ * \return true if successful, false in case of any error.
+ */
+bool profileSave(const Profile *self, const char *path);
+
+#endif /* PROFILE_H_INCLUDED */
@@ -25,6 +25,7 @@
  */
 
 #include "tunnel.h"
+#include "profile.h"
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <linux/if.h>
@@ -36,56 +37,128 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <syslog.h>
 
+/** Time to wait for the transmission status of a packet, in milliseconds. */
+#define TUNNEL_TX_STATUS_TIMEOUT 5000
+
+/**
+ * Completion handler of the Tx requests sent by tunnelGBeeSend(), logs failed
+ * transmissions.
+ */
+static void tunnelOnTxStatus(GBee *gbee, uint8_t frameId, GBeeError error,
+		const GBeeFrameData *response, uint16_t length, void *context);
+
+/**
+ * Frame handler for modem status frames, logs the status.
+ */
+static void tunnelOnModemStatus(GBee *gbee, const GBeeFrameData *frameData,
+		uint16_t length, void *context);
+
+/**
+ * Sets the XBee into API mode, takes its maximum payload length and sets its
+ * 16bit address and PAN identifier.
+ *
+ * \param[in] self is a pointer to the tunnel.
+ *
+ * \return true if successful, false in case of any error.
+ */
+static bool tunnelConfigure(Tunnel *self);
+
+/**
+ * Checks whether the XBee is still configured as recorded in the radio
+ * profile, with a single pipelined query of its serial number, mode, address
+ * and PAN (a power-cycled XBee loses settings not written with WR). If so,
+ * the GBee device is set up from the profile.
+ *
+ * \param[in] self is a pointer to the tunnel.
+ * \param[in] serialDevice is the name of the serial device.
+ * \param[in] path is the name of the profile file.
+ *
+ * \return true if the XBee matches the profile, false otherwise.
+ */
+static bool tunnelProfileCheck(Tunnel *self, const char *serialDevice,
+		const char *path);
+
+/**
+ * Records the configuration of the XBee in the radio profile.
+ *
+ * \param[in] self is a pointer to the tunnel.
+ * \param[in] serialDevice is the name of the serial device.
+ * \param[in] path is the name of the profile file.
+ */
+static void tunnelProfileSave(Tunnel *self, const char *serialDevice,
+		const char *path);
+
+/**
+ * Converts a register value (big-endian, without leading zeros) to a number.
+ *
+ * \param[in] entry is the register read.
+ *
+ * \return The register value.
+ */
+static uint32_t tunnelRegisterValue(const GBeeUtilRegister *entry);
+
 /*****************************************************************************/
 
-Tunnel *tunnelInit(const char *serialDevice, const char* inetAddr)
+Tunnel *tunnelInit(const char *serialDevice, const char* inetAddr,
+		const char *profile, uint32_t baudRate)
 {
 	/* This is our tunnel instance. */
 	static Tunnel tunnel;
-    /* Mode Xbee is operating in. */
-	GBeeMode mode;
-    /* Error code returned by Xbee. */
-	GBeeError error;
+	/* Tells if the XBee matches the radio profile. */
+	bool matched;
 
-	/* Create the Xbee driver instance. */
-	tunnel.gbeeDevice = gbeeCreate(serialDevice);
+	/* Create the Xbee driver instance. The XBee may still run at the baud rate
+	 * set by a former start, so look for it. */
+	tunnel.gbeeDevice = gbeeCreateEx(serialDevice, GBEE_BAUD_RATE_AUTO);
 	if (tunnel.gbeeDevice == NULL)
 	{
 		syslog(LOG_ERR, "XBee error: failed to connect to XBee");
 		return NULL;
 	}
 
-	/* Get Xbee mode. */
-	error = gbeeGetMode(tunnel.gbeeDevice, &mode);
-	if (error != GBEE_NO_ERROR)
+	/* Prepare the buffers for received frames. */
+	gbeePoolInit(&tunnel.rxPool);
+
+	/* Modem status frames are only logged. */
+	gbeeRegisterHandler(tunnel.gbeeDevice, GBEE_MODEM_STATUS,
+			tunnelOnModemStatus, &tunnel);
+
+	/* The XBee 16bit address and PAN are taken from the IP address. */
+	tunnel.inetAddr = ntohl(inet_addr(inetAddr));
+	tunnel.gbeeAddr = tunnel.inetAddr & 0xFFFF;
+	tunnel.gbeePan  = tunnel.inetAddr >> 16;
+
+	/* Configure the XBee, unless it is configured as on the last start. */
+	matched = (profile != NULL)
+			&& tunnelProfileCheck(&tunnel, serialDevice, profile);
+	if (matched)
+	{
+		syslog(LOG_INFO, "XBee matches profile %s, not configured again",
+				profile);
+	}
+	else if (!tunnelConfigure(&tunnel))
 	{
-		syslog(LOG_ERR, "XBee error: failed to get mode");
 		return NULL;
 	}
 
-	/* If XBee is not operating in API, then set API mode. */
-	if (mode != GBEE_MODE_API)
+	/* Raise the baud rate of the XBee and the serial interface. */
+	if (gbeeGetBaudRate(tunnel.gbeeDevice) != baudRate)
 	{
-		error = gbeeSetMode(tunnel.gbeeDevice, GBEE_MODE_API);
-		if (error != GBEE_NO_ERROR)
+		if (gbeeNegotiateBaud(tunnel.gbeeDevice, baudRate) != GBEE_NO_ERROR)
 		{
-			syslog(LOG_ERR, "XBee error: failed to set mode");
-			return NULL;
+			syslog(LOG_WARNING, "XBee warning: failed to set baud rate %u",
+					baudRate);
 		}
-
 	}
+	syslog(LOG_INFO, "XBee connected at %u bps",
+			gbeeGetBaudRate(tunnel.gbeeDevice));
 
-	/* Set the XBee 16bit address. */
-	tunnel.inetAddr = ntohl(inet_addr(inetAddr));
-	tunnel.gbeeAddr = tunnel.inetAddr & 0xFFFF;
-	tunnel.gbeePan  = tunnel.inetAddr >> 16;
-	error = gbeeUtilSetAddress16(tunnel.gbeeDevice, tunnel.gbeeAddr, tunnel.gbeePan);
-	if (error != GBEE_NO_ERROR)
+	if (!matched && (profile != NULL))
 	{
-		syslog(LOG_ERR, "XBee error: failed to set address");
-		return NULL;
+		tunnelProfileSave(&tunnel, serialDevice, profile);
 	}
 	
 	/* For configuring the TUN device. */
@@ -114,14 +187,155 @@ Tunnel *tunnelInit(const char *serialDevice, const char* inetAddr)
 	sprintf(shellCommand, "ifconfig tun0 inet %s netmask 255.255.0.0", inetAddr);
 	system(shellCommand);
 
-	/* Create the semaphore for getting transmission status. */
-	if (sem_init(&tunnel.txStatusLock, 0, 0) != 0)
+	return &tunnel;
+}
+
+/*****************************************************************************/
+
+static bool tunnelConfigure(Tunnel *self)
+{
+    /* Mode Xbee is operating in. */
+	GBeeMode mode;
+    /* Error code returned by Xbee. */
+	GBeeError error;
+
+	/* Get Xbee mode. */
+	error = gbeeGetMode(self->gbeeDevice, &mode);
+	if (error != GBEE_NO_ERROR)
 	{
-		syslog(LOG_ERR, "Internal error: failed to create semaphore");
-		return NULL;
+		syslog(LOG_ERR, "XBee error: failed to get mode");
+		return false;
 	}
 
-	return &tunnel;
+	/* If XBee is not operating in API, then set API mode. */
+	if (mode != GBEE_MODE_API)
+	{
+		error = gbeeSetMode(self->gbeeDevice, GBEE_MODE_API);
+		if (error != GBEE_NO_ERROR)
+		{
+			syslog(LOG_ERR, "XBee error: failed to set mode");
+			return false;
+		}
+
+	}
+
+	/* Take the maximum payload length from the XBee (if it knows NP). */
+	error = gbeeUtilReadMaxPayloadLength(self->gbeeDevice);
+	if (error != GBEE_NO_ERROR)
+	{
+		syslog(LOG_WARNING, "XBee warning: failed to read maximum payload length");
+	}
+
+	/* Set the XBee 16bit address. */
+	error = gbeeUtilSetAddress16(self->gbeeDevice, self->gbeeAddr, self->gbeePan);
+	if (error != GBEE_NO_ERROR)
+	{
+		syslog(LOG_ERR, "XBee error: failed to set address");
+		return false;
+	}
+	return true;
+}
+
+/*****************************************************************************/
+
+static bool tunnelProfileCheck(Tunnel *self, const char *serialDevice,
+		const char *path)
+{
+	/* The radio profile. */
+	Profile profile;
+	/* Register values. */
+	uint8_t sh[4], sl[4], ap[1], my[2], id[2];
+	/* Serial number and settings of the XBee. */
+	GBeeUtilRegister registers[5] = {
+		{ "SH", sh, 0, sizeof(sh) },
+		{ "SL", sl, 0, sizeof(sl) },
+		{ "AP", ap, 0, sizeof(ap) },
+		{ "MY", my, 0, sizeof(my) },
+		{ "ID", id, 0, sizeof(id) }
+	};
+
+	/* The profile must be for this device and this configuration. */
+	if (!profileLoad(&profile, path)
+			|| (strcmp(profile.serialDevice, serialDevice) != 0)
+			|| (profile.mode != GBEE_MODE_API)
+			|| (profile.gbeeAddr != self->gbeeAddr)
+			|| (profile.gbeePan != self->gbeePan))
+	{
+		return false;
+	}
+
+	/* Query the registers in API mode, a radio not in API mode, replaced or
+	 * reset meanwhile fails the check. The responses fill the register
+	 * cache. */
+	gbeeSetEscaped(self->gbeeDevice, false);
+	if ((gbeeUtilReadRegisters(self->gbeeDevice, registers, 5) != GBEE_NO_ERROR)
+			|| (tunnelRegisterValue(&registers[0]) != profile.serialHigh)
+			|| (tunnelRegisterValue(&registers[1]) != profile.serialLow)
+			|| (tunnelRegisterValue(&registers[2]) != profile.mode)
+			|| (tunnelRegisterValue(&registers[3]) != profile.gbeeAddr)
+			|| (tunnelRegisterValue(&registers[4]) != profile.gbeePan))
+	{
+		return false;
+	}
+
+	/* Set up the GBee device as tunnelConfigure() would have. */
+	gbeeSetMaxPayloadLength(self->gbeeDevice, profile.maxPayloadLength);
+	return true;
+}
+
+/*****************************************************************************/
+
+static void tunnelProfileSave(Tunnel *self, const char *serialDevice,
+		const char *path)
+{
+	/* The radio profile. */
+	Profile profile;
+	/* Register values. */
+	uint8_t sh[4], sl[4], bd[4], vr[2];
+	/* Registers not known yet. */
+	GBeeUtilRegister registers[4] = {
+		{ "SH", sh, 0, sizeof(sh) },
+		{ "SL", sl, 0, sizeof(sl) },
+		{ "BD", bd, 0, sizeof(bd) },
+		{ "VR", vr, 0, sizeof(vr) }
+	};
+
+	if (gbeeUtilReadRegisters(self->gbeeDevice, registers, 4) != GBEE_NO_ERROR)
+	{
+		syslog(LOG_WARNING, "XBee warning: failed to read profile registers");
+		return;
+	}
+
+	memset(&profile, 0, sizeof(profile));
+	strncpy(profile.serialDevice, serialDevice, sizeof(profile.serialDevice) - 1);
+	profile.serialHigh       = tunnelRegisterValue(&registers[0]);
+	profile.serialLow        = tunnelRegisterValue(&registers[1]);
+	profile.mode             = GBEE_MODE_API;
+	profile.gbeeAddr         = self->gbeeAddr;
+	profile.gbeePan          = self->gbeePan;
+	profile.baudRate         = tunnelRegisterValue(&registers[2]);
+	profile.firmware         = tunnelRegisterValue(&registers[3]);
+	profile.maxPayloadLength = gbeeGetMaxPayloadLength(self->gbeeDevice);
+	if (!profileSave(&profile, path))
+	{
+		syslog(LOG_WARNING, "Failed to save profile %s", path);
+	}
+}
+
+/*****************************************************************************/
+
+static uint32_t tunnelRegisterValue(const GBeeUtilRegister *entry)
+{
+	/* The register value. */
+	uint32_t value = 0;
+	/* Index of the current byte. */
+	uint16_t index;
+
+	for (index = 0; index < entry->length; index++)
+	{
+		value = (value << 8) | entry->value[index];
+	}
+	return value;
 }
 
 /*****************************************************************************/
@@ -161,17 +375,24 @@ bool tunnelInetReceive(Tunnel *self, GBeeTxRequest16 *txRequest, uint16_t *txReq
 
 /*****************************************************************************/
 
-bool tunnelInetSend(Tunnel *self, GBeeRxPacket16 *rxPacket, uint16_t rxPacketLength)
+bool tunnelInetSend(Tunnel *self, const GBeeFrameBuffer *buffer)
 {
-	/* The IP packet. */
-	static uint8_t buffer[576];
-	IpHeader *ipHeader = (IpHeader *)buffer;
+	/* The GBee Rx packet. */
+	const GBeeRxPacket16 *rxPacket = &GBEE_FRAME_BUFFER_DATA(buffer)->rxPacket16;
+	/* The IP header. */
+	IpHeader ipHeader;
+	/* IP header and payload, written at once. */
+	struct iovec vector[2];
 
-	/* Encode the IP packet. */
-	gbeeInetEncode(self->inetAddr, rxPacket, rxPacketLength, ipHeader);
+	/* Encode the IP header. */
+	gbeeInetEncode(self->inetAddr, rxPacket, buffer->length, &ipHeader);
 
 	/* Forward the packet data to the TUN device. */
-	ssize_t result = write(self->tunDevice, ipHeader, ntohs(ipHeader->totalLength));
+	vector[0].iov_base = &ipHeader;
+	vector[0].iov_len  = sizeof(ipHeader);
+	vector[1].iov_base = (void *)rxPacket->data;
+	vector[1].iov_len  = buffer->length - GBEE_RX_PACKET_16_HEADER_LENGTH;
+	ssize_t result = writev(self->tunDevice, vector, 2);
 	if (result < 0)
 	{
 		syslog(LOG_ERR, "TUN/TAP error: failed to write to /dev/net/tun");
@@ -182,36 +403,33 @@ bool tunnelInetSend(Tunnel *self, GBeeRxPacket16 *rxPacket, uint16_t rxPacketLen
 
 /*****************************************************************************/
 
-bool tunnelGBeeReceive(Tunnel *self, GBeeFrameData *frame, uint16_t *frameLength)
+bool tunnelGBeeReceive(Tunnel *self, GBeeFrameBuffer **buffer)
 {
 	/* Infinite loop for receiving data. */
 	while (1)
 	{
 		/* Wait until we receive a packet from the GBee device driver. */
 		uint32_t timeout = GBEE_INFINITE_WAIT;
-		GBeeError error = gbeeReceive(self->gbeeDevice, frame, frameLength, &timeout);
+		GBeeError error = gbeePoolReceive(self->gbeeDevice, &self->rxPool, buffer,
+				&timeout);
 		if (error != GBEE_NO_ERROR)
 		{
 			syslog(LOG_ERR, "XBee error: failed to receive data from XBee");
 			return false;
 		}
+		GBeeFrameData *frame = GBEE_FRAME_BUFFER_DATA(*buffer);
 
 		/* Process the packet. */
 		if (frame->ident == GBEE_RX_PACKET_16)
 		{
 			return true;
 		}
-		else if (frame->ident == GBEE_TX_STATUS)
-		{
-			/* Received a XBee transmission status packet. Signal "Tx Status
-			 * Received" to the transmitter. */
-			sem_post(&self->txStatusLock);
-		}
 		else
 		{
 			/* Received any other packet -> ignore it. */
 			syslog(LOG_WARNING, "Discarded XBee packet (ident=%d)", frame->ident);
 		}
+		gbeePoolRelease(*buffer);
 	}
 	return true;
 }
@@ -220,15 +438,53 @@ bool tunnelGBeeReceive(Tunnel *self, GBeeFrameData *frame, uint16_t *frameLength
 
 bool tunnelGBeeSend(Tunnel *self, GBeeTxRequest16 *txRequest, uint16_t txRequestLength)
 {
-	/* Send the IP packet to the remote XBee. */
-	uint32_t error = gbeeSend(self->gbeeDevice, (GBeeFrameData *)txRequest,	txRequestLength);
-	if (error != GBEE_NO_ERROR)
+	/* Send the IP packet to the remote XBee, the transmission status is
+	 * handled by tunnelOnTxStatus(). */
+	uint32_t error = gbeeSendTxRequestAsync(self->gbeeDevice,
+			(GBeeFrameData *)txRequest, txRequestLength, TUNNEL_TX_STATUS_TIMEOUT,
+			tunnelOnTxStatus, self, NULL);
+	if (error == GBEE_NO_FRAME_ID_ERROR)
+	{
+		/* Too many packets in flight - drop this one, like a full queue. */
+		syslog(LOG_WARNING, "XBee warning: too many packets in flight");
+		return true;
+	}
+	else if (error != GBEE_NO_ERROR)
 	{
 		syslog(LOG_ERR, "XBee error: failed to send data to XBee");
 		return false;
 	}
-
-	/* Wait for the transmission status. */
-	sem_wait(&self->txStatusLock);
 	return true;
 }
+
+/*****************************************************************************/
+
+static void tunnelOnTxStatus(GBee *gbee, uint8_t frameId, GBeeError error,
+		const GBeeFrameData *response, uint16_t length, void *context)
+{
+	(void)gbee;
+	(void)length;
+	(void)context;
+	if (error != GBEE_NO_ERROR)
+	{
+		syslog(LOG_WARNING, "XBee warning: no transmission status (frameId=%d)",
+				frameId);
+	}
+	else if ((response->ident == GBEE_TX_STATUS)
+			&& (response->txStatus.status != GBEE_TX_STATUS_SUCCESS))
+	{
+		syslog(LOG_WARNING, "XBee warning: transmission failed (status=%d)",
+				response->txStatus.status);
+	}
+}
+
+/*****************************************************************************/
+
+static void tunnelOnModemStatus(GBee *gbee, const GBeeFrameData *frameData,
+		uint16_t length, void *context)
+{
+	(void)gbee;
+	(void)length;
+	(void)context;
+	syslog(LOG_INFO, "XBee modem status %d", frameData->modemStatus.status);
+}
@@ -29,7 +29,7 @@
 #define TUNNEL_H_INCLUDED
 
 #include "gbee-inet.h"
-#include <semaphore.h>
+#include "gbee-pool.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -38,9 +38,9 @@ struct Tunnel {
 	GBee      *gbeeDevice;   /**< The GBee device driver instance. */
 	uint16_t   gbeeAddr;     /**< XBee address of the tunnel. */
 	uint16_t   gbeePan;      /**< XBee PAN identifier. */
-	sem_t      txStatusLock; /**< XBee transmission status flag. */
 	int        tunDevice;    /**< TUN device file descriptor. */
 	uint32_t   inetAddr;     /**< IP address of the tunnel. */
+	GBeeFramePool rxPool;    /**< Buffers for frames received from the XBee. */
 };
 
 /** Tunnel type definition. */
@@ -49,14 +49,21 @@ typedef struct Tunnel Tunnel;
 /**
  * Initializes the Xbee device driver and sets the Xbee into API mode.
  * Configures the TUN device with the desired IP address.
+ * If a radio profile is given and matches the XBee (see profile.h), the XBee
+ * is not configured again; otherwise the profile is written after configuring
+ * the XBee.
  *
  * \param[in] serialDevice is the name of the serial device the Xbee is
  * 		connected to, e.g. ``/dev/ttyS0''.
  * \param[in] inetAddr is a string with the IP address.
+ * \param[in] profile is the name of the radio profile file, NULL for none.
+ * \param[in] baudRate is the baud rate of the serial interface. The baud rate
+ * of the XBee is detected and changed to this one (see gbeeNegotiateBaud()).
  *
  * \return A pointer to the Tunnel if successful, NULL in case of any error.
  */
-Tunnel *tunnelInit(const char* serialDevice, const char* inetAddr);
+Tunnel *tunnelInit(const char* serialDevice, const char* inetAddr,
+		const char *profile, uint32_t baudRate);
 
 /**
  * Closes the tunnel by destroying the GBee device and closing the TUN/TAP 
@@ -80,30 +87,31 @@ bool tunnelInetReceive(Tunnel *self, GBeeTxRequest16 *txRequest, uint16_t *txReq
 
 /**
  * Encodes a GBee Rx packet into an appropriate UDP/IP packet and writes it to
- * the TUN device.
+ * the TUN device. The payload is written straight from the frame buffer.
  *
  * \param[in] self is a pointer to the tunnel.
- * \param[in] rxPacket is a pointer to the GBee Rx packet.
- * \param[in] rxPacketLength is the length of the packet in bytes.
+ * \param[in] buffer is the frame buffer holding the GBee Rx packet.
  *
  * \return true to indicate success, false in case of any error.
  */
-bool tunnelInetSend(Tunnel *self, GBeeRxPacket16 *rxPacket, uint16_t rxPacketLength);
+bool tunnelInetSend(Tunnel *self, const GBeeFrameBuffer *buffer);
 
 /**
  * Receives data from the GBee device driver. Blocks until a GBee Rx packet
  * with 16bit address is available.
  *
  * \param[in] self is a pointer to the tunnel.
- * \param[out] frame is the received packet.
- * \param[out] frameLength is the length of the received frame in bytes.
+ * \param[out] buffer is set to the frame buffer holding the received packet,
+ * 		taken from the receive pool. Release it with gbeePoolRelease().
  *
  * \return true to indicate success, false in case of any error.
  */
-bool tunnelGBeeReceive(Tunnel *self, GBeeFrameData *frame, uint16_t *frameLength);
+bool tunnelGBeeReceive(Tunnel *self, GBeeFrameBuffer **buffer);
 
 /**
- * Sends the given GBee Tx request to the XBee device.
+ * Sends the given GBee Tx request to the XBee device. Does not wait for the
+ * transmission status: it is checked by the receiving thread, failures are
+ * logged.
  *
  * \param[in] self is a pointer to the tunnel device.
  * \param[in] txRequest is a pointer to the Tx request.